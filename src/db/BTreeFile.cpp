@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cstring>
+#include <limits>
 #include <db/BTreeFile.hpp>
 #include <db/Database.hpp>
 #include <db/IndexPage.hpp>
@@ -7,37 +9,52 @@
 
 using namespace db;
 
-BTreeFile::BTreeFile(const std::string &name, const TupleDesc &td, size_t key_index)
-    : DbFile(name, td), key_index(key_index) {}
+BTreeFile::BTreeFile(const std::string &name, const TupleDesc &td, size_t key_index, size_t key_width)
+    : DbFile(name, td), key_index(key_index), key_width(key_width) {
+  if (key_width == 0 || key_width > MAX_KEY_WIDTH || key_index + key_width > td.size()) {
+    throw std::logic_error("Invalid key width");
+  }
+}
+
+Key BTreeFile::bound(int key, int fill) const {
+  Key result{};
+  result[0] = key;
+  std::fill(result.begin() + 1, result.begin() + key_width, fill);
+  return result;
+}
 
 void BTreeFile::insertTuple(const Tuple &t) {
-  std::vector<size_t> path;
+  // (index page, child slot) pairs from the root down to the parent of the leaf
+  std::vector<std::pair<size_t, size_t>> path;
   BufferPool &bufferPool = getDatabase().getBufferPool();
+  std::lock_guard latch(bufferPool.getLatch());
   PageId pid{name, root_id};
+  Key key = keyOf(t, key_index, key_width);
 
   Page &root_page = bufferPool.getPage(pid);
-  IndexPage root(root_page);
+  IndexPage root(root_page, key_width);
   if (root.header->size == 0 && root.children[0] != 1) {
     bufferPool.markDirty({name, root_id});
     pid.page = numPages++;
     root.children[0] = pid.page;
+    path.emplace_back(root_id, 0);
   } else {
     while (true) {
       Page &page = bufferPool.getPage(pid);
-      IndexPage node(page);
-      auto pos = std::lower_bound(node.keys, node.keys + node.header->size, std::get<int>(t.get_field(key_index)));
-      auto slot = pos - node.keys;
+      IndexPage node(page, key_width);
+      // Equal keys go right so that a new duplicate lands after the existing ones
+      auto slot = node.upperBound(key);
+      path.emplace_back(pid.page, slot);
       pid.page = node.children[slot];
       if (!node.header->index_children) {
         break;
       }
-      path.push_back(pid.page);
     }
   }
 
   Page &page = bufferPool.getPage(pid);
   bufferPool.markDirty(pid);
-  LeafPage leaf(page, td, key_index);
+  LeafPage leaf(page, td, key_index, key_width);
   if (!leaf.insertTuple(t)) {
     return;
   }
@@ -45,56 +62,64 @@ void BTreeFile::insertTuple(const Tuple &t) {
   pid.page = numPages++;
   Page &new_leaf_page = bufferPool.getPage(pid);
   bufferPool.markDirty(pid);
-  LeafPage new_leaf(new_leaf_page, td, key_index);
-  int new_key = leaf.split(new_leaf);
+  LeafPage new_leaf(new_leaf_page, td, key_index, key_width);
+  Key new_key = leaf.split(new_leaf);
   leaf.header->next_leaf = pid.page;
   size_t new_child = pid.page;
 
-  while (!path.empty()) {
-    size_t parent_id = path.back();
+  while (true) {
+    auto [parent_id, slot] = path.back();
     path.pop_back();
     pid.page = parent_id;
     Page &parent_page = bufferPool.getPage(pid);
     bufferPool.markDirty(pid);
-    IndexPage parent(parent_page);
-    if (!parent.insert(new_key, new_child)) {
+    IndexPage parent(parent_page, key_width);
+    if (!parent.insert(slot, new_key, new_child)) {
       return;
     }
+    if (path.empty()) {
+      break;
+    }
 
     pid.page = numPages++;
     Page &new_internal_page = bufferPool.getPage(pid);
     bufferPool.markDirty(pid);
-    IndexPage new_internal(new_internal_page);
+    IndexPage new_internal(new_internal_page, key_width);
     new_key = parent.split(new_internal);
     new_child = pid.page;
   }
 
-  bufferPool.markDirty({name, root_id});
-  if (!root.insert(new_key, new_child)) {
-    return;
-  }
+  // The root is full: move its contents to two new children and make it their parent
+  Page &full_root_page = bufferPool.getPage({name, root_id});
+  IndexPage full_root(full_root_page, key_width);
   pid.page = numPages++;
   Page &new_child1 = bufferPool.getPage(pid);
   bufferPool.markDirty(pid);
   size_t child1 = pid.page;
-  new_child1 = root_page;
-  IndexPage child1_page(new_child1);
+  new_child1 = full_root_page;
+  IndexPage child1_page(new_child1, key_width);
 
   pid.page = numPages++;
   Page &new_child2 = bufferPool.getPage(pid);
   bufferPool.markDirty(pid);
   size_t child2 = pid.page;
-  IndexPage child2_page(new_child2);
-
-  int key = child1_page.split(child2_page);
-  root.header->size = 1;
-  root.header->index_children = true;
-  root.keys[0] = key;
-  root.children[0] = child1;
-  root.children[1] = child2;
+  IndexPage child2_page(new_child2, key_width);
+
+  Key split_key = child1_page.split(child2_page);
+  full_root.header->size = 0;
+  full_root.header->index_children = true;
+  full_root.children[0] = child1;
+  full_root.insert(0, split_key, child2);
 }
 
 void BTreeFile::deleteTuple(const Iterator &it) {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  std::lock_guard latch(bufferPool.getLatch());
+  PageId pid{name, it.page};
+  Page &page = bufferPool.getPage(pid);
+  bufferPool.markDirty(pid);
+  LeafPage leaf(page, td, key_index);
+  leaf.deleteTuple(it.slot);
 }
 
 Tuple BTreeFile::getTuple(const Iterator &it) const {
@@ -105,33 +130,162 @@ Tuple BTreeFile::getTuple(const Iterator &it) const {
   return leaf.getTuple(it.slot);
 }
 
-void BTreeFile::next(Iterator &it) const {
+Tuple BTreeFile::getTuple(const Iterator &it, const std::vector<size_t> &fields) const {
   BufferPool &bufferPool = getDatabase().getBufferPool();
   PageId pid{name, it.page};
   Page &page = bufferPool.getPage(pid);
   LeafPage leaf(page, td, key_index);
-  if (it.slot + 1 < leaf.header->size) {
-    it.slot++;
-  } else {
+  return leaf.getTuple(it.slot, fields);
+}
+
+void BTreeFile::seekTuple(Iterator &it) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  while (it.page != root_id) {
+    Page &page = bufferPool.getPage({name, it.page});
+    LeafPage leaf(page, td, key_index);
+    if (it.slot < leaf.header->size) {
+      return;
+    }
     it.page = leaf.header->next_leaf;
     it.slot = 0;
   }
 }
 
+void BTreeFile::next(Iterator &it) const {
+  it.slot++;
+  seekTuple(it);
+}
+
 Iterator BTreeFile::begin() const {
   BufferPool &bufferPool = getDatabase().getBufferPool();
   PageId pid{name, root_id};
   while (true) {
     Page &page = bufferPool.getPage(pid);
-    IndexPage node(page);
+    IndexPage node(page, key_width);
     pid.page = node.children[0];
     if (!node.header->index_children) {
       break;
     }
   }
-  return {*this, pid.page, 0};
+  Iterator it{*this, pid.page, 0};
+  seekTuple(it);
+  return it;
 }
 
+Iterator BTreeFile::lowerBound(int key) const { return lowerBound(bound(key, std::numeric_limits<int>::min())); }
+
+Iterator BTreeFile::lowerBound(const Key &key) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  PageId pid{name, root_id};
+  while (true) {
+    Page &page = bufferPool.getPage(pid);
+    IndexPage node(page, key_width);
+    // Equal keys go left: duplicates of a separator may remain at the end of the left subtree
+    pid.page = node.children[node.lowerBound(key)];
+    if (!node.header->index_children) {
+      break;
+    }
+  }
+  if (pid.page == root_id) {
+    return end();
+  }
+  Page &page = bufferPool.getPage(pid);
+  LeafPage leaf(page, td, key_index, key_width);
+  Iterator it{*this, pid.page, leaf.lowerBound(key)};
+  seekTuple(it);
+  return it;
+}
+
+void BTreeFile::reverseScan(const std::function<bool(const Tuple &)> &visit) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  // (page, whether it is a leaf) of the nodes still to visit; the rightmost one is at the back
+  std::vector<std::pair<size_t, bool>> stack{{root_id, false}};
+  std::vector<Tuple> tuples;
+  while (!stack.empty()) {
+    auto [id, is_leaf] = stack.back();
+    stack.pop_back();
+    Page &page = bufferPool.getPage({name, id});
+    if (!is_leaf) {
+      IndexPage node(page, key_width);
+      for (size_t i = 0; i <= node.header->size; i++) {
+        // An empty tree has no leaf yet
+        if (node.children[i] != root_id) {
+          stack.emplace_back(node.children[i], !node.header->index_children);
+        }
+      }
+      continue;
+    }
+    // The visitor may use the buffer pool, so the tuples are copied out of the page first
+    LeafPage leaf(page, td, key_index);
+    tuples.clear();
+    for (size_t slot = 0; slot < leaf.header->size; slot++) {
+      tuples.push_back(leaf.getTuple(slot));
+    }
+    for (auto t = tuples.rbegin(); t != tuples.rend(); ++t) {
+      if (!visit(*t)) {
+        return;
+      }
+    }
+  }
+}
+
+std::vector<size_t> BTreeFile::leafPages() const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  std::vector<size_t> level{root_id};
+  while (true) {
+    std::vector<size_t> children;
+    bool leaves = false;
+    for (size_t id : level) {
+      IndexPage node(bufferPool.getPage({name, id}), key_width);
+      leaves = !node.header->index_children;
+      for (size_t i = 0; i <= node.header->size; i++) {
+        // An empty tree has no leaf yet
+        if (node.children[i] != root_id) {
+          children.push_back(node.children[i]);
+        }
+      }
+    }
+    if (leaves) {
+      return children;
+    }
+    level = std::move(children);
+  }
+}
+
+Iterator BTreeFile::upperBound(int key) const { return upperBound(bound(key, std::numeric_limits<int>::max())); }
+
+Iterator BTreeFile::upperBound(const Key &key) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  PageId pid{name, root_id};
+  while (true) {
+    Page &page = bufferPool.getPage(pid);
+    IndexPage node(page, key_width);
+    pid.page = node.children[node.upperBound(key)];
+    if (!node.header->index_children) {
+      break;
+    }
+  }
+  if (pid.page == root_id) {
+    return end();
+  }
+  Page &page = bufferPool.getPage(pid);
+  LeafPage leaf(page, td, key_index, key_width);
+  Iterator it{*this, pid.page, leaf.upperBound(key)};
+  seekTuple(it);
+  return it;
+}
+
+int BTreeFile::getKey(const Iterator &it) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  Page &page = bufferPool.getPage({name, it.page});
+  LeafPage leaf(page, td, key_index);
+  return leaf.getKey(it.slot);
+}
+
+size_t BTreeFile::getKeyIndex() const { return key_index; }
+
+size_t BTreeFile::getKeyWidth() const { return key_width; }
+
 Iterator BTreeFile::end() const {
   return {*this, 0, 0};
 }
@@ -1,28 +1,46 @@
+#include <algorithm>
+#include <chrono>
 #include <db/BufferPool.hpp>
 #include <db/Database.hpp>
 #include <numeric>
 
 using namespace db;
 
-BufferPool::BufferPool() : available(DEFAULT_NUM_PAGES) { std::iota(available.rbegin(), available.rend(), 0); }
+BufferPool::BufferPool() : available(DEFAULT_NUM_PAGES) {
+  std::iota(available.rbegin(), available.rend(), 0);
+  rec_lsn.fill(NO_LSN);
+}
 
 BufferPool::~BufferPool() {
+  std::vector<PageId> to_flush;
   for (const size_t &pos : dirty) {
-    const Page &page = pages[pos];
-    const PageId &pid = pos_to_pid[pos];
-    getDatabase().get(pid.file).writePage(page, pid.page);
+    to_flush.push_back(pos_to_pid[pos]);
+  }
+  // With a log, flushPage logs the changes and forces the log before it writes a page
+  try {
+    for (const auto &pid : to_flush) {
+      flushPage(pid);
+    }
+  } catch (const std::exception &) {
+    // The pages that are left are not written: recovery brings their files back to the last commit of the log
   }
 }
 
 Page &BufferPool::getPage(const PageId &pid) {
   // If already in buffer pool, make it the most recent page and return it
   if (contains(pid)) {
+    metrics.hits.fetch_add(1, std::memory_order_relaxed);
+    getMetrics().pool_hits.fetch_add(1, std::memory_order_relaxed);
     size_t pos = pid_to_pos.at(pid);
     lru_list.splice(lru_list.begin(), lru_list, pos_to_lru[pos]);
     pos_to_lru[pos] = lru_list.begin();
     return pages[pos];
   }
 
+  auto start = std::chrono::steady_clock::now();
+  metrics.misses.fetch_add(1, std::memory_order_relaxed);
+  getMetrics().pool_misses.fetch_add(1, std::memory_order_relaxed);
+
   // If there are no available pages, evict the least recently used page. If the page is dirty, flush it to disk
   if (available.empty()) {
     size_t pos = lru_list.back();
@@ -31,6 +49,7 @@ Page &BufferPool::getPage(const PageId &pid) {
       flushPage(old_pid);
     }
     discardPage(old_pid);
+    metrics.evictions.fetch_add(1, std::memory_order_relaxed);
   }
 
   // Read the page from disk to one of the available slots, make it the most recent page
@@ -39,17 +58,28 @@ Page &BufferPool::getPage(const PageId &pid) {
 
   Page &page = pages[pos];
   getDatabase().get(pid.file).readPage(page, pid.page);
+  if (log) {
+    logged[pos] = page;
+    page_lsn[pos] = 0;
+    rec_lsn[pos] = NO_LSN;
+  }
   pid_to_pos[pid] = pos;
   pos_to_pid[pos] = pid;
 
   lru_list.push_front(pos);
   pos_to_lru[pos] = lru_list.begin();
 
+  metrics.miss_latency.record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
   return page;
 }
 
 void BufferPool::markDirty(const PageId &pid) {
+  std::lock_guard lock(latch);
   size_t pos = pid_to_pos.at(pid);
+  if (!snapshots.empty()) {
+    keepVersion(pos);
+  }
   dirty.insert(pos);
 }
 
@@ -72,14 +102,31 @@ void BufferPool::discardPage(const PageId &pid) {
 }
 
 void BufferPool::flushPage(const PageId &pid) {
+  std::lock_guard lock(latch);
   size_t pos = pid_to_pos.at(pid);
-  if (dirty.erase(pos) == 0)
+  if (!dirty.contains(pos))
     return;
+  auto start = std::chrono::steady_clock::now();
   const Page &page = pages[pos];
+  if (log) {
+    // Write ahead: the page is logged, with the other dirty pages, and the log is on disk before the page
+    if (page != logged[pos]) {
+      logChanges();
+    }
+    if (page_lsn[pos] > log->getDurableLsn()) {
+      log->flush(log->getEndLsn());
+    }
+  }
+  dirty.erase(pos);
+  rec_lsn[pos] = NO_LSN;
   getDatabase().get(pid.file).writePage(page, pid.page);
+  metrics.flushes.fetch_add(1, std::memory_order_relaxed);
+  metrics.flush_latency.record(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
 }
 
 void BufferPool::flushFile(const std::string &file) {
+  std::lock_guard lock(latch);
   std::vector<size_t> to_flush;
   for (const size_t &pos : dirty) {
     const PageId &pid = pos_to_pid[pos];
@@ -91,3 +138,150 @@ void BufferPool::flushFile(const std::string &file) {
     flushPage({file, page});
   }
 }
+
+void BufferPool::setLog(WriteAheadLog *log) {
+  std::lock_guard lock(latch);
+  this->log = log;
+  if (log) {
+    for (const auto &[pid, pos] : pid_to_pos) {
+      logged[pos] = pages[pos];
+      page_lsn[pos] = 0;
+      rec_lsn[pos] = NO_LSN;
+    }
+  }
+}
+
+void BufferPool::logPage(size_t pos) {
+  // The end of the log before the record is its start, or the start of a record appended concurrently before it
+  Lsn start = log->getEndLsn();
+  if (auto lsn = log->logPage(pos_to_pid[pos], logged[pos], pages[pos])) {
+    logged[pos] = pages[pos];
+    page_lsn[pos] = *lsn;
+    rec_lsn[pos] = std::min(rec_lsn[pos], start);
+  }
+}
+
+Lsn BufferPool::logChanges() {
+  std::lock_guard lock(latch);
+  if (!log) {
+    return 0;
+  }
+  for (const size_t &pos : dirty) {
+    logPage(pos);
+  }
+  return log->getEndLsn();
+}
+
+size_t BufferPool::writeBack(size_t max_pages) {
+  std::lock_guard lock(latch);
+  // The dirty pages from the least recently used, then stably by their first record
+  std::vector<size_t> order;
+  for (auto it = lru_list.rbegin(); it != lru_list.rend(); ++it) {
+    if (dirty.contains(*it)) {
+      order.push_back(*it);
+    }
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return rec_lsn[a] < rec_lsn[b]; });
+  order.resize(std::min(order.size(), max_pages));
+  for (const size_t &pos : order) {
+    flushPage(pos_to_pid[pos]);
+  }
+  return order.size();
+}
+
+Lsn BufferPool::getRecoveryLsn() const {
+  std::lock_guard lock(latch);
+  Lsn lsn = NO_LSN;
+  for (const size_t &pos : dirty) {
+    lsn = std::min(lsn, rec_lsn[pos]);
+  }
+  return lsn;
+}
+
+std::recursive_mutex &BufferPool::getLatch() const { return latch; }
+
+void BufferPool::keepVersion(size_t pos) {
+  const PageId &pid = pos_to_pid[pos];
+  // Only the last snapshot that sees the page matters: if it has a version of the page, the earlier snapshots do too
+  for (auto it = snapshots.rbegin(); it != snapshots.rend(); ++it) {
+    auto num_pages = it->second.find(pid.file);
+    if (num_pages == it->second.end() || pid.page >= num_pages->second) {
+      continue;
+    }
+    auto &chain = versions[pid];
+    if (chain.empty() || chain.back().time <= it->first) {
+      chain.push_back({clock, std::make_shared<const Page>(pages[pos])});
+    }
+    return;
+  }
+}
+
+const Page *BufferPool::findVersion(const PageId &pid, Timestamp time) const {
+  auto it = versions.find(pid);
+  if (it == versions.end()) {
+    return nullptr;
+  }
+  const auto &chain = it->second;
+  auto version = std::upper_bound(chain.begin(), chain.end(), time,
+                                  [](Timestamp t, const Version &v) { return t < v.time; });
+  return version == chain.end() ? nullptr : version->page.get();
+}
+
+Timestamp BufferPool::openSnapshot(const std::unordered_map<std::string, size_t> &num_pages) {
+  std::lock_guard lock(latch);
+  Timestamp time = clock++;
+  snapshots.emplace(time, num_pages);
+  return time;
+}
+
+void BufferPool::closeSnapshot(Timestamp time) {
+  std::lock_guard lock(latch);
+  snapshots.erase(time);
+  // A snapshot reads the first version after it, so the other versions are dropped
+  for (auto it = versions.begin(); it != versions.end();) {
+    auto &chain = it->second;
+    std::vector<Version> kept;
+    for (const auto &[snapshot, num_pages] : snapshots) {
+      auto version = std::upper_bound(chain.begin(), chain.end(), snapshot,
+                                      [](Timestamp t, const Version &v) { return t < v.time; });
+      if (version != chain.end() && (kept.empty() || kept.back().time != version->time)) {
+        kept.push_back(*version);
+      }
+    }
+    if (kept.empty()) {
+      it = versions.erase(it);
+    } else {
+      chain = std::move(kept);
+      ++it;
+    }
+  }
+}
+
+void BufferPool::readVersion(const DbFile &file, size_t id, Timestamp time, Page &page) {
+  PageId pid{file.getName(), id};
+  {
+    std::lock_guard lock(latch);
+    if (const Page *version = findVersion(pid, time)) {
+      page = *version;
+      return;
+    }
+  }
+  // Without a version, the page has not changed since the snapshot, which wrote it to its file
+  file.readPage(page, id);
+  // A writer may have changed the page meanwhile, and evicted it while it was read, but then it kept its version first
+  std::lock_guard lock(latch);
+  if (const Page *version = findVersion(pid, time)) {
+    page = *version;
+  }
+}
+
+size_t BufferPool::getNumVersions() const {
+  std::lock_guard lock(latch);
+  size_t count = 0;
+  for (const auto &[pid, chain] : versions) {
+    count += chain.size();
+  }
+  return count;
+}
+
+const PoolMetrics &BufferPool::getPoolMetrics() const { return metrics; }
@@ -0,0 +1,374 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <db/ColumnEncoding.hpp>
+#include <db/Kernels.hpp>
+#include <limits>
+#include <string_view>
+
+using namespace db;
+
+namespace {
+constexpr size_t DESCRIPTOR_SIZE = 16;
+//Packed values are read and written 8 bytes at a time, so packed data is followed by 8 bytes of padding.
+constexpr size_t PACKING_PADDING = 8;
+
+size_t alignUp(size_t offset) { return (offset + 7) / 8 * 8; }
+
+template <typename T> T load(const uint8_t *data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+template <typename T> void store(uint8_t *data, T value) { std::memcpy(data, &value, sizeof(T)); }
+
+size_t packedSize(size_t n, size_t bits) { return (n * bits + 7) / 8 + PACKING_PADDING; }
+
+uint64_t unpack(const uint8_t *packed, size_t i, size_t bits) {
+  if (bits == 0) {
+    return 0;
+  }
+  size_t bit = i * bits;
+  return (load<uint64_t>(packed + bit / 8) >> (bit % 8)) & ((uint64_t{1} << bits) - 1);
+}
+
+void pack(uint8_t *packed, size_t i, size_t bits, uint64_t value) {
+  if (bits == 0) {
+    return;
+  }
+  size_t bit = i * bits;
+  store(packed + bit / 8, load<uint64_t>(packed + bit / 8) | value << (bit % 8));
+}
+
+std::string_view charValue(const uint8_t *data) {
+  return {reinterpret_cast<const char *>(data), strnlen(reinterpret_cast<const char *>(data), CHAR_SIZE)};
+}
+
+size_t bitsFor(uint64_t max) { return std::bit_width(max); }
+
+//The values in [lo, hi), or outside of it if negate is set.
+struct Range {
+  int64_t lo, hi;
+  bool negate = false;
+
+  bool contains(int64_t value) const { return (lo <= value && value < hi) != negate; }
+};
+
+//The range of the values v such that "v op operand" holds, given the values equal to the operand as [first, last):
+//a single integer, or a position in a dictionary which is empty if the operand is not in it.
+Range rangeOf(PredicateOp op, int64_t first, int64_t last) {
+  constexpr int64_t MIN = std::numeric_limits<int64_t>::min(), MAX = std::numeric_limits<int64_t>::max();
+  switch (op) {
+  case PredicateOp::EQ:
+    return {first, last};
+  case PredicateOp::NE:
+    return {first, last, true};
+  case PredicateOp::LT:
+    return {MIN, first};
+  case PredicateOp::LE:
+    return {MIN, last};
+  case PredicateOp::GT:
+    return {last, MAX};
+  case PredicateOp::GE:
+    return {first, MAX};
+  }
+  return {MIN, MAX};
+}
+} // namespace
+
+ColumnEncoder::ColumnEncoder(const TupleDesc &td)
+    : td(td), widths(td.size()), columns(td.size()), strings(td.size()) {
+  for (size_t i = 0; i < td.size(); i++) {
+    widths[i] = (i + 1 < td.size() ? td.offset_of(i + 1) : td.length()) - td.offset_of(i);
+  }
+}
+
+size_t ColumnEncoder::sizeOf(size_t field, const ColumnState &state, size_t n, ColumnEncoding &encoding) const {
+  size_t size = n * widths[field];
+  encoding = ColumnEncoding::RAW;
+  auto consider = [&](ColumnEncoding candidate, size_t candidate_size) {
+    if (candidate_size < size) {
+      size = candidate_size;
+      encoding = candidate;
+    }
+  };
+  switch (td.type_of(field)) {
+  case type_t::INT:
+    consider(ColumnEncoding::FOR, packedSize(n, bitsFor(state.max - state.min)));
+    consider(ColumnEncoding::RLE, state.runs * (sizeof(uint32_t) + INT_SIZE));
+    break;
+  case type_t::CHAR:
+    consider(ColumnEncoding::DICT, alignUp(sizeof(uint16_t) * (state.distinct + 1) + state.bytes) +
+                                       packedSize(n, bitsFor(state.distinct - 1)));
+    break;
+  case type_t::DOUBLE:
+    break;
+  }
+  return alignUp(size);
+}
+
+bool ColumnEncoder::add(const uint8_t *data) {
+  std::vector<ColumnState> next = columns;
+  size_t n = count + 1;
+  size_t size = alignUp(COLUMN_PAGE_HEADER + (n + 7) / 8) + DESCRIPTOR_SIZE * td.size();
+  std::vector<bool> added(td.size());
+  for (size_t i = 0; i < td.size(); i++) {
+    const uint8_t *value = data + td.offset_of(i);
+    ColumnState &state = next[i];
+    if (td.type_of(i) == type_t::INT) {
+      int64_t v = load<int>(value);
+      if (count == 0) {
+        state.min = state.max = v;
+        state.runs = 1;
+      } else {
+        state.min = std::min(state.min, v);
+        state.max = std::max(state.max, v);
+        state.runs += v != load<int>(rows.data() + (count - 1) * td.length() + td.offset_of(i));
+      }
+    } else if (td.type_of(i) == type_t::CHAR) {
+      std::string_view s = charValue(value);
+      if (!strings[i].contains(std::string(s))) {
+        added[i] = true;
+        state.distinct++;
+        state.bytes += s.size();
+      }
+    }
+    ColumnEncoding encoding;
+    size += sizeOf(i, state, n, encoding);
+  }
+  if (size > DEFAULT_PAGE_SIZE) {
+    return false;
+  }
+  for (size_t i = 0; i < td.size(); i++) {
+    if (added[i]) {
+      strings[i].emplace(charValue(data + td.offset_of(i)));
+    }
+  }
+  columns = std::move(next);
+  rows.insert(rows.end(), data, data + td.length());
+  count = n;
+  return true;
+}
+
+size_t ColumnEncoder::size() const { return count; }
+
+void ColumnEncoder::write(Page &page, bool full) const {
+  std::fill(page.begin(), page.end(), 0);
+  page[0] = static_cast<uint8_t>(PageFormat::ENCODED);
+  page[1] = full ? COLUMN_PAGE_FULL : 0;
+  store<uint32_t>(page.data() + 4, count);
+  for (size_t slot = 0; slot < count; slot++) {
+    page[COLUMN_PAGE_HEADER + slot / 8] |= 1 << (7 - slot % 8);
+  }
+  uint8_t *descriptors = page.data() + alignUp(COLUMN_PAGE_HEADER + (count + 7) / 8);
+  size_t offset = descriptors - page.data() + DESCRIPTOR_SIZE * td.size();
+  const size_t length = td.length();
+
+  for (size_t field = 0; field < td.size(); field++) {
+    const ColumnState &state = columns[field];
+    const size_t field_offset = td.offset_of(field), width = widths[field];
+    ColumnEncoding encoding;
+    size_t size = sizeOf(field, state, count, encoding);
+    uint8_t *data = page.data() + offset;
+    uint8_t bits = 0;
+    int32_t base = 0;
+    uint32_t entries = 0;
+    auto value = [&](size_t slot) { return rows.data() + slot * length + field_offset; };
+
+    switch (encoding) {
+    case ColumnEncoding::RAW:
+      for (size_t slot = 0; slot < count; slot++) {
+        std::memcpy(data + slot * width, value(slot), width);
+      }
+      break;
+    case ColumnEncoding::FOR:
+      base = static_cast<int32_t>(state.min);
+      bits = bitsFor(state.max - state.min);
+      for (size_t slot = 0; slot < count; slot++) {
+        pack(data, slot, bits, load<int>(value(slot)) - state.min);
+      }
+      break;
+    case ColumnEncoding::RLE:
+      //The slots where the runs end, followed by their values.
+      entries = state.runs;
+      for (size_t slot = 0, run = 0; slot < count; slot++) {
+        int v = load<int>(value(slot));
+        if (slot + 1 == count || load<int>(value(slot + 1)) != v) {
+          store<uint32_t>(data + run * sizeof(uint32_t), slot + 1);
+          store<int>(data + entries * sizeof(uint32_t) + run * INT_SIZE, v);
+          run++;
+        }
+      }
+      break;
+    case ColumnEncoding::DICT: {
+      //The offsets of the strings, the strings, and the packed codes.
+      std::vector<std::string_view> dictionary(strings[field].begin(), strings[field].end());
+      std::sort(dictionary.begin(), dictionary.end());
+      entries = dictionary.size();
+      bits = bitsFor(entries - 1);
+      uint8_t *chars = data + sizeof(uint16_t) * (entries + 1);
+      uint16_t position = 0;
+      for (size_t code = 0; code < entries; code++) {
+        store(data + sizeof(uint16_t) * code, position);
+        std::memcpy(chars + position, dictionary[code].data(), dictionary[code].size());
+        position += dictionary[code].size();
+      }
+      store(data + sizeof(uint16_t) * entries, position);
+      uint8_t *codes = data + alignUp(sizeof(uint16_t) * (entries + 1) + position);
+      for (size_t slot = 0; slot < count; slot++) {
+        auto it = std::lower_bound(dictionary.begin(), dictionary.end(), charValue(value(slot)));
+        pack(codes, slot, bits, it - dictionary.begin());
+      }
+      break;
+    }
+    }
+
+    uint8_t *descriptor = descriptors + field * DESCRIPTOR_SIZE;
+    descriptor[0] = static_cast<uint8_t>(encoding);
+    descriptor[1] = bits;
+    store<uint32_t>(descriptor + 4, offset);
+    store<int32_t>(descriptor + 8, base);
+    store<uint32_t>(descriptor + 12, entries);
+    offset += size;
+  }
+}
+
+EncodedColumns::EncodedColumns(const uint8_t *page, const TupleDesc &td)
+    : td(td), page(page), count(load<uint32_t>(page + 4)),
+      descriptors(page + alignUp(COLUMN_PAGE_HEADER + (count + 7) / 8)) {}
+
+EncodedColumns::Descriptor EncodedColumns::descriptor(size_t field) const {
+  const uint8_t *data = descriptors + field * DESCRIPTOR_SIZE;
+  return {static_cast<ColumnEncoding>(data[0]), data[1], load<uint32_t>(data + 4), load<int32_t>(data + 8),
+          load<uint32_t>(data + 12)};
+}
+
+ColumnEncoding EncodedColumns::encodingOf(size_t field) const { return descriptor(field).encoding; }
+
+void EncodedColumns::decode(size_t slot, size_t field, uint8_t *data) const {
+  Descriptor d = descriptor(field);
+  const uint8_t *column = page + d.offset;
+  switch (d.encoding) {
+  case ColumnEncoding::RAW: {
+    size_t width = (field + 1 < td.size() ? td.offset_of(field + 1) : td.length()) - td.offset_of(field);
+    std::memcpy(data, column + slot * width, width);
+    break;
+  }
+  case ColumnEncoding::FOR:
+    store<int>(data, static_cast<int>(d.base + static_cast<int64_t>(unpack(column, slot, d.bits))));
+    break;
+  case ColumnEncoding::RLE: {
+    //The first run that ends after the slot.
+    size_t lo = 0, hi = d.entries;
+    while (lo < hi) {
+      size_t mid = (lo + hi) / 2;
+      if (load<uint32_t>(column + mid * sizeof(uint32_t)) <= slot) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    std::memcpy(data, column + d.entries * sizeof(uint32_t) + lo * INT_SIZE, INT_SIZE);
+    break;
+  }
+  case ColumnEncoding::DICT: {
+    const uint8_t *chars = column + sizeof(uint16_t) * (d.entries + 1);
+    const uint8_t *codes = column + alignUp(sizeof(uint16_t) * (d.entries + 1) +
+                                            load<uint16_t>(column + sizeof(uint16_t) * d.entries));
+    size_t code = unpack(codes, slot, d.bits);
+    uint16_t begin = load<uint16_t>(column + sizeof(uint16_t) * code);
+    uint16_t end = load<uint16_t>(column + sizeof(uint16_t) * (code + 1));
+    std::memset(data, 0, CHAR_SIZE);
+    std::memcpy(data, chars + begin, end - begin);
+    break;
+  }
+  }
+}
+
+const uint8_t *EncodedColumns::rawColumn(size_t field) const {
+  Descriptor d = descriptor(field);
+  return d.encoding == ColumnEncoding::RAW ? page + d.offset : nullptr;
+}
+
+bool EncodedColumns::match(size_t field, PredicateOp op, const field_t &operand,
+                           std::vector<uint8_t> &selected) const {
+  Descriptor d = descriptor(field);
+  const uint8_t *column = page + d.offset;
+  type_t type = td.type_of(field);
+
+  if (d.encoding == ColumnEncoding::RAW) {
+    return selectValues(type, column, count, op, operand, selected.data());
+  }
+
+  if (type == type_t::INT && std::holds_alternative<int>(operand)) {
+    int64_t value = std::get<int>(operand);
+    Range range = rangeOf(op, value, value + 1);
+    switch (d.encoding) {
+    case ColumnEncoding::FOR: {
+      //The range is moved to the differences to the frame of reference, which are compared without adding it back.
+      Range packed = range;
+      if (packed.lo != std::numeric_limits<int64_t>::min()) {
+        packed.lo -= d.base;
+      }
+      if (packed.hi != std::numeric_limits<int64_t>::max()) {
+        packed.hi -= d.base;
+      }
+      for (size_t slot = 0; slot < count; slot++) {
+        selected[slot] &= packed.contains(static_cast<int64_t>(unpack(column, slot, d.bits)));
+      }
+      return true;
+    }
+    case ColumnEncoding::RLE: {
+      //Every run is compared once.
+      size_t start = 0;
+      for (size_t run = 0; run < d.entries; run++) {
+        size_t end = load<uint32_t>(column + run * sizeof(uint32_t));
+        if (!range.contains(load<int>(column + d.entries * sizeof(uint32_t) + run * INT_SIZE))) {
+          std::fill(selected.begin() + start, selected.begin() + end, 0);
+        }
+        start = end;
+      }
+      return true;
+    }
+    default:
+      return false;
+    }
+  }
+
+  if (type == type_t::CHAR && std::holds_alternative<std::string>(operand) && d.encoding == ColumnEncoding::DICT) {
+    const std::string &value = std::get<std::string>(operand);
+    //A longer operand would be truncated to a stored value, which it does not equal and sorts after: only the exact
+    //check compares it correctly.
+    if (value.size() > CHAR_SIZE) {
+      return false;
+    }
+    //The operand is located in the sorted dictionary, and the comparison is made on the codes.
+    const uint8_t *chars = column + sizeof(uint16_t) * (d.entries + 1);
+    auto entry = [&](size_t code) {
+      uint16_t begin = load<uint16_t>(column + sizeof(uint16_t) * code);
+      uint16_t end = load<uint16_t>(column + sizeof(uint16_t) * (code + 1));
+      return std::string_view(reinterpret_cast<const char *>(chars + begin), end - begin);
+    };
+    std::string_view key(value);
+    size_t lower = 0, upper = d.entries;
+    while (lower < upper) {
+      size_t mid = (lower + upper) / 2;
+      if (entry(mid) < key) {
+        lower = mid + 1;
+      } else {
+        upper = mid;
+      }
+    }
+    //The codes below lower hold smaller strings, the code lower holds the operand if it is in the dictionary.
+    bool found = lower < d.entries && entry(lower) == key;
+    Range range = rangeOf(op, lower, lower + found);
+    const uint8_t *codes = column + alignUp(sizeof(uint16_t) * (d.entries + 1) +
+                                            load<uint16_t>(column + sizeof(uint16_t) * d.entries));
+    for (size_t slot = 0; slot < count; slot++) {
+      selected[slot] &= range.contains(static_cast<int64_t>(unpack(codes, slot, d.bits)));
+    }
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,128 @@
+#include <db/BufferPool.hpp>
+#include <db/ColumnFile.hpp>
+#include <numeric>
+#include <stdexcept>
+
+using namespace db;
+
+ColumnFile::ColumnFile(const std::string &name, const TupleDesc &td) : DbFile(name, td), layout(td) {}
+
+const ColumnLayout &ColumnFile::getLayout() const { return layout; }
+
+void ColumnFile::insertTuple(const Tuple &t) {
+  if (!td.compatible(t)) {
+    throw std::runtime_error("Tuple not compatible with TupleDesc");
+  }
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  size_t slot;
+  if (!getPage(numPages - 1).insertTuple(t, slot)) {
+    seal();
+    getPage(numPages - 1).insertTuple(t, slot);
+  }
+  bufferPool.markDirty({name, numPages - 1});
+}
+
+void ColumnFile::seal() {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  const size_t last = numPages - 1;
+  //The tuples of a page are copied out first, since reading another page may evict it.
+  auto rowsOf = [&](size_t page) {
+    std::vector<uint8_t> rows;
+    Page row{};
+    std::vector<size_t> fields(td.size());
+    std::iota(fields.begin(), fields.end(), 0);
+    const ColumnPage cp = getPage(page);
+    for (size_t slot = cp.begin(); slot != cp.end(); cp.next(slot)) {
+      cp.gather(slot, fields, row.data());
+      rows.insert(rows.end(), row.begin(), row.begin() + td.length());
+    }
+    return rows;
+  };
+  const size_t length = td.length();
+
+  if (last > 0 && getPage(last - 1).isEncoded() && !getPage(last - 1).isFull()) {
+    std::vector<uint8_t> previous = rowsOf(last - 1), rows = rowsOf(last);
+    ColumnEncoder encoder(td);
+    for (size_t i = 0; i < previous.size(); i += length) {
+      encoder.add(previous.data() + i);
+    }
+    size_t moved = 0;
+    while (moved < rows.size() && encoder.add(rows.data() + moved)) {
+      moved += length;
+    }
+    encoder.write(bufferPool.getPage({name, last - 1}), moved < rows.size());
+    bufferPool.markDirty({name, last - 1});
+    if (moved > 0) {
+      //The tuples that did not fit are written back to the emptied last page.
+      Page &p = bufferPool.getPage({name, last});
+      std::fill(p.begin(), p.end(), 0);
+      ColumnPage cp(p, td, layout);
+      size_t slot;
+      for (size_t i = moved; i < rows.size(); i += length) {
+        cp.insertTuple(td.deserialize(rows.data() + i), slot);
+      }
+      bufferPool.markDirty({name, last});
+      return;
+    }
+  }
+
+  //The last page is encoded into itself if its tuples all fit, which they do unless encoding does not help.
+  std::vector<uint8_t> rows = rowsOf(last);
+  ColumnEncoder encoder(td);
+  bool fits = true;
+  for (size_t i = 0; i < rows.size() && fits; i += length) {
+    fits = encoder.add(rows.data() + i);
+  }
+  if (fits) {
+    encoder.write(bufferPool.getPage({name, last}), false);
+    bufferPool.markDirty({name, last});
+  }
+  numPages++;
+}
+
+void ColumnFile::deleteTuple(const Iterator &it) {
+  getPage(it.page).deleteTuple(it.slot);
+  getDatabase().getBufferPool().markDirty({name, it.page});
+}
+
+ColumnPage ColumnFile::getPage(size_t page) const {
+  return {getDatabase().getBufferPool().getPage({name, page}), td, layout};
+}
+
+Tuple ColumnFile::getTuple(const Iterator &it) const {
+  return getPage(it.page).getTuple(it.slot);
+}
+
+Tuple ColumnFile::getTuple(const Iterator &it, const std::vector<size_t> &fields) const {
+  return getPage(it.page).getTuple(it.slot, fields);
+}
+
+void ColumnFile::next(Iterator &it) const {
+  if (it.page < numPages) {
+    const ColumnPage cp = getPage(it.page);
+    cp.next(it.slot);
+    if (it.slot != cp.end()) {
+      return;
+    }
+    it.page++;
+  }
+  Iterator found = seek(it.page);
+  it.page = found.page;
+  it.slot = found.slot;
+}
+
+Iterator ColumnFile::seek(size_t page) const {
+  while (page < numPages) {
+    const ColumnPage cp = getPage(page);
+    size_t slot = cp.begin();
+    if (slot != cp.end()) {
+      return {*this, page, slot};
+    }
+    page++;
+  }
+  return end();
+}
+
+Iterator ColumnFile::begin() const { return seek(0); }
+
+Iterator ColumnFile::end() const { return {*this, numPages, 0}; }
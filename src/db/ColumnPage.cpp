@@ -0,0 +1,175 @@
+#include <cstring>
+#include <db/ColumnPage.hpp>
+#include <db/Kernels.hpp>
+#include <stdexcept>
+
+using namespace db;
+
+namespace {
+size_t alignUp(size_t offset) { return (offset + 7) / 8 * 8; }
+} // namespace
+
+ColumnLayout::ColumnLayout(const TupleDesc &td) : offsets(td.size()), widths(td.size()) {
+  for (size_t i = 0; i < td.size(); i++) {
+    widths[i] = (i + 1 < td.size() ? td.offset_of(i + 1) : td.length()) - td.offset_of(i);
+  }
+  //Start from the capacity of a heap page and give up slots until the header and the padding of the minipages fit.
+  capacity = DEFAULT_PAGE_SIZE * 8 / (td.length() * 8 + 1);
+  while (true) {
+    size_t offset = alignUp(COLUMN_PAGE_HEADER + (capacity + 7) / 8);
+    for (size_t i = 0; i < td.size(); i++) {
+      offsets[i] = offset;
+      offset = alignUp(offset + capacity * widths[i]);
+    }
+    if (offset <= DEFAULT_PAGE_SIZE || capacity == 0) {
+      break;
+    }
+    capacity--;
+  }
+  if (capacity == 0) {
+    throw std::logic_error("Tuple does not fit in a column page");
+  }
+}
+
+size_t ColumnLayout::getCapacity() const { return capacity; }
+
+size_t ColumnLayout::offsetOf(size_t field) const { return offsets[field]; }
+
+size_t ColumnLayout::widthOf(size_t field) const { return widths[field]; }
+
+ColumnPage::ColumnPage(Page &page, const TupleDesc &td, const ColumnLayout &layout)
+    : td(td), layout(layout), header(page.data()), bitmap(page.data() + COLUMN_PAGE_HEADER) {
+  if (header[0] == static_cast<uint8_t>(PageFormat::ENCODED)) {
+    encoded.emplace(header, td);
+  }
+}
+
+size_t ColumnPage::begin() const {
+  size_t slot = 0;
+  while (slot < end() && empty(slot)) {
+    slot++;
+  }
+  return slot;
+}
+
+size_t ColumnPage::end() const {
+  if (encoded) {
+    uint32_t count;
+    std::memcpy(&count, header + 4, sizeof(count));
+    return count;
+  }
+  return layout.getCapacity();
+}
+
+bool ColumnPage::isEncoded() const { return encoded.has_value(); }
+
+bool ColumnPage::isFull() const { return encoded && (header[1] & COLUMN_PAGE_FULL); }
+
+ColumnEncoding ColumnPage::encodingOf(size_t field) const {
+  return encoded ? encoded->encodingOf(field) : ColumnEncoding::RAW;
+}
+
+bool ColumnPage::insertTuple(const Tuple &t, size_t &slot) {
+  if (encoded) {
+    return false;
+  }
+  slot = 0;
+  while (slot < end() && !empty(slot)) {
+    slot++;
+  }
+  if (slot == end()) {
+    return false;
+  }
+  bitmap[slot / 8] |= 1 << (7 - slot % 8);
+  //The tuple is serialized once and its fields are copied to their minipages.
+  Page row;
+  td.serialize(row.data(), t);
+  for (size_t i = 0; i < td.size(); i++) {
+    size_t width = layout.widthOf(i);
+    std::memcpy(header + layout.offsetOf(i) + slot * width, row.data() + td.offset_of(i), width);
+  }
+  return true;
+}
+
+void ColumnPage::deleteTuple(size_t slot) {
+  if (slot >= end()) {
+    throw std::runtime_error("Out of index");
+  }
+  if (empty(slot)) {
+    throw std::runtime_error("Slot not occupied");
+  }
+  bitmap[slot / 8] &= ~(1 << (7 - slot % 8));
+}
+
+bool ColumnPage::empty(size_t slot) const { return !(bitmap[slot / 8] & (1 << (7 - slot % 8))); }
+
+Tuple ColumnPage::getTuple(size_t slot) const {
+  if (empty(slot)) {
+    throw std::runtime_error("Slot not occupied");
+  }
+  Page row;
+  for (size_t i = 0; i < td.size(); i++) {
+    if (encoded) {
+      encoded->decode(slot, i, row.data() + td.offset_of(i));
+    } else {
+      size_t width = layout.widthOf(i);
+      std::memcpy(row.data() + td.offset_of(i), header + layout.offsetOf(i) + slot * width, width);
+    }
+  }
+  return td.deserialize(row.data());
+}
+
+Tuple ColumnPage::getTuple(size_t slot, const std::vector<size_t> &fields) const {
+  if (empty(slot)) {
+    throw std::runtime_error("Slot not occupied");
+  }
+  Page row;
+  gather(slot, fields, row.data());
+  return td.deserialize(row.data(), fields);
+}
+
+void ColumnPage::gather(size_t slot, const std::vector<size_t> &fields, uint8_t *data) const {
+  for (size_t field : fields) {
+    if (encoded) {
+      encoded->decode(slot, field, data + td.offset_of(field));
+    } else {
+      size_t width = layout.widthOf(field);
+      std::memcpy(data + td.offset_of(field), header + layout.offsetOf(field) + slot * width, width);
+    }
+  }
+}
+
+const uint8_t *ColumnPage::column(size_t field) const {
+  return encoded ? encoded->rawColumn(field) : header + layout.offsetOf(field);
+}
+
+const uint8_t *ColumnPage::values(size_t field, std::vector<uint8_t> &buffer) const {
+  if (const uint8_t *values = column(field)) {
+    return values;
+  }
+  size_t width = layout.widthOf(field);
+  buffer.resize(end() * width);
+  for (size_t slot = 0; slot < end(); slot++) {
+    encoded->decode(slot, field, buffer.data() + slot * width);
+  }
+  return buffer.data();
+}
+
+void ColumnPage::occupancy(std::vector<uint8_t> &selected) const {
+  selected.resize(end());
+  for (size_t slot = 0; slot < end(); slot++) {
+    selected[slot] = !empty(slot);
+  }
+}
+
+bool ColumnPage::match(size_t field, PredicateOp op, const field_t &operand, std::vector<uint8_t> &selected) const {
+  if (encoded) {
+    return encoded->match(field, op, operand, selected);
+  }
+  return selectValues(td.type_of(field), column(field), end(), op, operand, selected.data());
+}
+
+void ColumnPage::next(size_t &slot) const {
+  while (++slot < end() && empty(slot))
+    ;
+}
@@ -1,9 +1,32 @@
 #include <db/Database.hpp>
+#include <filesystem>
 
 using namespace db;
 
 BufferPool &Database::getBufferPool() { return bufferPool; }
 
+Database::~Database() {
+  try {
+    close();
+  } catch (const std::exception &) {
+    // The log is left as it is, and the next openLog recovers the files from it
+  }
+}
+
+void Database::close() {
+  if (!log) {
+    return;
+  }
+  commit();
+  for (const auto &[name, file] : files) {
+    bufferPool.flushFile(name);
+    file->sync();
+  }
+  log->truncate();
+  bufferPool.setLog(nullptr);
+  log.reset();
+}
+
 Database &db::getDatabase() {
   static Database instance;
   return instance;
@@ -18,12 +41,99 @@ void Database::add(std::unique_ptr<DbFile> file) {
 }
 
 std::unique_ptr<DbFile> Database::remove(const std::string &name) {
-  auto nh = files.extract(name);
-  if (nh.empty()) {
+  if (!files.contains(name)) {
     throw std::logic_error("File does not exist");
   }
-  Database::getBufferPool().flushFile(nh.key());
+  // flush while the file is still in the catalog, since flushing looks it up
+  Database::getBufferPool().flushFile(name);
+  if (log) {
+    // checkpoints only sync the files in the catalog
+    files.at(name)->sync();
+  }
+  // the file may come back with other contents, which its old statistics would not describe
+  stats.erase(name);
+  std::error_code ec;
+  std::filesystem::remove(name + ".stats", ec);
+  auto nh = files.extract(name);
   return std::move(nh.mapped());
 }
 
 DbFile &Database::get(const std::string &name) const { return *files.at(name); }
+
+const TableStats &Database::analyze(const std::string &name) {
+  const DbFile &file = get(name);
+  TableStats &table = stats[name] = db::analyze(file);
+  table.save(name + ".stats", file.getTupleDesc());
+  return table;
+}
+
+const TableStats *Database::getStats(const std::string &name) const {
+  const DbFile &file = get(name);
+  if (auto it = stats.find(name); it != stats.end()) {
+    return &it->second;
+  }
+  TableStats table;
+  if (!table.load(name + ".stats", file.getTupleDesc())) {
+    return nullptr;
+  }
+  return &(stats[name] = std::move(table));
+}
+
+void Database::openLog(const std::string &path) {
+  if (log) {
+    throw std::logic_error("A log is already open");
+  }
+  if (!files.empty()) {
+    throw std::logic_error("The log must be opened before the files are added");
+  }
+  auto wal = std::make_unique<WriteAheadLog>(path);
+  wal->recover();
+  log = std::move(wal);
+  bufferPool.setLog(log.get());
+}
+
+WriteAheadLog *Database::getLog() const { return log.get(); }
+
+void Database::commit() {
+  if (!log) {
+    throw std::logic_error("No log is open");
+  }
+  Lsn lsn;
+  {
+    std::lock_guard lock(commit_mutex);
+    bufferPool.logChanges();
+    lsn = log->logCommit();
+  }
+  log->flush(lsn);
+  if (log->getEndLsn() - log->getBaseLsn() >= CHECKPOINT_LOG_SIZE) {
+    checkpoint();
+  }
+}
+
+size_t Database::checkpoint(size_t max_pages) {
+  std::lock_guard lock(commit_mutex);
+  size_t written = bufferPool.writeBack(max_pages);
+  if (!log) {
+    return written;
+  }
+  for (const auto &[name, file] : files) {
+    file->sync();
+  }
+  Lsn base = log->getBaseLsn();
+  Lsn lsn = std::min(bufferPool.getRecoveryLsn(), log->getCommitLsn());
+  if (lsn > base && lsn - base >= (log->getEndLsn() - base) / 2) {
+    log->truncate(lsn);
+  }
+  return written;
+}
+
+std::shared_ptr<const Snapshot> Database::snapshot() {
+  std::lock_guard latch(bufferPool.getLatch());
+  std::unordered_map<std::string, size_t> num_pages;
+  for (const auto &[name, file] : files) {
+    // The snapshot reads the pages that do not change afterwards from the files
+    bufferPool.flushFile(name);
+    num_pages[name] = file->getNumPages();
+  }
+  return std::make_shared<const Snapshot>(std::move(num_pages));
+}
@@ -1,3 +1,4 @@
+#include <chrono>
 #include <db/DbFile.hpp>
 #include <stdexcept>
 #include <fcntl.h>
@@ -29,20 +30,43 @@ DbFile::~DbFile() {
 
 const std::string &DbFile::getName() const { return name; }
 
+namespace {
+uint64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+} // namespace
+
 void DbFile::readPage(Page &page, const size_t id) const {
-  reads.push_back(id);
+  auto start = std::chrono::steady_clock::now();
   std::fill(page.begin(), page.end(), 0);
   pread(fd, page.data(), DEFAULT_PAGE_SIZE, id * DEFAULT_PAGE_SIZE);
+  metrics.recordRead(elapsedNs(start));
+  reads.record(id);
 }
 
 void DbFile::writePage(const Page &page, const size_t id) const {
-  writes.push_back(id);
+  auto start = std::chrono::steady_clock::now();
   pwrite(fd, page.data(), DEFAULT_PAGE_SIZE, id * DEFAULT_PAGE_SIZE);
+  metrics.recordWrite(elapsedNs(start));
+  writes.record(id);
 }
 
-const std::vector<size_t> &DbFile::getReads() const { return reads; }
+void DbFile::sync() const {
+  if (fdatasync(fd) == -1) {
+    throw std::runtime_error("fdatasync");
+  }
+}
 
-const std::vector<size_t> &DbFile::getWrites() const { return writes; }
+std::vector<size_t> DbFile::getReads() const { return reads.get(); }
+
+std::vector<size_t> DbFile::getWrites() const { return writes.get(); }
+
+void DbFile::setTraceCapacity(size_t capacity) {
+  reads.reset(capacity);
+  writes.reset(capacity);
+}
+
+const FileMetrics &DbFile::getIoMetrics() const { return metrics; }
 
 void DbFile::insertTuple(const Tuple &t) { throw std::runtime_error("Not implemented"); }
 
@@ -50,10 +74,26 @@ void DbFile::deleteTuple(const Iterator &it) { throw std::runtime_error("Not imp
 
 Tuple DbFile::getTuple(const Iterator &it) const { throw std::runtime_error("Not implemented"); }
 
+Tuple DbFile::getTuple(const Iterator &it, const std::vector<size_t> &fields) const {
+  Tuple t = getTuple(it);
+  std::vector<field_t> values;
+  values.reserve(fields.size());
+  for (size_t field : fields) {
+    values.push_back(t.get_field(field));
+  }
+  return {values};
+}
+
 void DbFile::next(Iterator &it) const { throw std::runtime_error("Not implemented"); }
 
 Iterator DbFile::begin() const { throw std::runtime_error("Not implemented"); }
 
+Iterator DbFile::begin(const std::vector<size_t> &fields) const {
+  Iterator it = begin();
+  it.fields = &fields;
+  return it;
+}
+
 Iterator DbFile::end() const { throw std::runtime_error("Not implemented"); }
 
 size_t DbFile::getNumPages() const { return numPages; }
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <db/ExternalSort.hpp>
+#include <stdexcept>
+
+using namespace db;
+
+ExternalSort::ExternalSort(const TupleDesc &td, Less less, size_t memory_pages)
+    : td(td), less(std::move(less)), memory_pages(std::max<size_t>(memory_pages, 3)),
+      capacity(std::max<size_t>(1, this->memory_pages * DEFAULT_PAGE_SIZE / td.length())),
+      heap(EntryGreater{&this->less}), merge(CursorGreater{this}) {}
+
+ExternalSort::Less ExternalSort::byFields(const std::vector<std::pair<size_t, bool>> &order) {
+  return [order](const Tuple &a, const Tuple &b) {
+    for (const auto &[idx, descending] : order) {
+      const field_t &x = a.get_field(idx), &y = b.get_field(idx);
+      if (x != y) {
+        return descending ? y < x : x < y;
+      }
+    }
+    return false;
+  };
+}
+
+void ExternalSort::write(size_t run, const Tuple &t) {
+  while (runs.size() <= run) {
+    runs.push_back(std::make_unique<SpillFile>(td));
+  }
+  runs[run]->append(t);
+}
+
+void ExternalSort::add(const Tuple &t) {
+  if (finished) {
+    throw std::logic_error("Sort input already finished");
+  }
+  if (heap.size() < capacity) {
+    heap.push({0, t});
+    return;
+  }
+  Entry smallest = heap.top();
+  heap.pop();
+  write(smallest.run, smallest.tuple);
+  // A tuple that sorts before the one just written cannot extend the current run
+  size_t run = less(t, smallest.tuple) ? smallest.run + 1 : smallest.run;
+  heap.push({run, t});
+}
+
+std::unique_ptr<SpillFile> ExternalSort::mergeRuns(size_t first, size_t last) {
+  if (last - first == 1) {
+    return std::move(runs[first]);
+  }
+  std::vector<std::unique_ptr<SpillFile::Cursor>> group;
+  std::vector<Tuple> group_heads;
+  for (size_t i = first; i < last; i++) {
+    group.push_back(std::make_unique<SpillFile::Cursor>(*runs[i]));
+    group_heads.push_back(group.back()->next());
+  }
+  auto greater = [&](size_t a, size_t b) { return less(group_heads[b], group_heads[a]); };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> queue(greater);
+  for (size_t i = 0; i < group.size(); i++) {
+    queue.push(i);
+  }
+  auto merged = std::make_unique<SpillFile>(td);
+  while (!queue.empty()) {
+    size_t i = queue.top();
+    queue.pop();
+    merged->append(group_heads[i]);
+    if (!group[i]->done()) {
+      group_heads[i] = group[i]->next();
+      queue.push(i);
+    }
+  }
+  return merged;
+}
+
+void ExternalSort::finish() {
+  if (finished) {
+    return;
+  }
+  finished = true;
+  if (runs.empty()) {
+    // Everything fits in memory: the heap pops the tuples in order
+    return;
+  }
+  while (!heap.empty()) {
+    write(heap.top().run, heap.top().tuple);
+    heap.pop();
+  }
+  generated_runs = runs.size();
+
+  // One page per run plus one page for the output of an intermediate merge
+  size_t fan_in = memory_pages - 1;
+  while (runs.size() > fan_in) {
+    std::vector<std::unique_ptr<SpillFile>> merged;
+    for (size_t first = 0; first < runs.size(); first += fan_in) {
+      merged.push_back(mergeRuns(first, std::min(first + fan_in, runs.size())));
+    }
+    runs = std::move(merged);
+  }
+
+  for (const auto &run : runs) {
+    cursors.push_back(std::make_unique<SpillFile::Cursor>(*run));
+    heads.emplace_back(cursors.back()->next());
+    merge.push(heads.size() - 1);
+  }
+}
+
+std::optional<Tuple> ExternalSort::next() {
+  finish();
+  if (runs.empty()) {
+    if (heap.empty()) {
+      return std::nullopt;
+    }
+    Tuple t = heap.top().tuple;
+    heap.pop();
+    return t;
+  }
+  if (merge.empty()) {
+    return std::nullopt;
+  }
+  size_t i = merge.top();
+  merge.pop();
+  Tuple t = std::move(*heads[i]);
+  if (cursors[i]->done()) {
+    heads[i].reset();
+  } else {
+    heads[i] = cursors[i]->next();
+    merge.push(i);
+  }
+  return t;
+}
+
+size_t ExternalSort::getNumRuns() const { return generated_runs; }
+
+TopKHeap::TopKHeap(ExternalSort::Less less, size_t k) : less(std::move(less)), k(k) {}
+
+bool TopKHeap::add(const Tuple &t) {
+  if (heap.size() < k) {
+    heap.push_back(t);
+    std::push_heap(heap.begin(), heap.end(), less);
+    return true;
+  }
+  if (k == 0 || !less(t, heap.front())) {
+    return false;
+  }
+  std::pop_heap(heap.begin(), heap.end(), less);
+  heap.back() = t;
+  std::push_heap(heap.begin(), heap.end(), less);
+  return true;
+}
+
+bool TopKHeap::full() const { return heap.size() == k; }
+
+const Tuple &TopKHeap::largest() const { return heap.front(); }
+
+void TopKHeap::merge(const TopKHeap &other) {
+  for (const auto &t : other.heap) {
+    add(t);
+  }
+}
+
+std::vector<Tuple> TopKHeap::finish() {
+  std::sort_heap(heap.begin(), heap.end(), less);
+  std::vector<Tuple> sorted = std::move(heap);
+  heap.clear();
+  return sorted;
+}
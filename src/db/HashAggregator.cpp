@@ -0,0 +1,571 @@
+#include <algorithm>
+#include <cstring>
+#include <db/Hash.hpp>
+#include <db/HashAggregator.hpp>
+#include <db/Kernels.hpp>
+#include <db/Operator.hpp>
+#include <limits>
+#include <stdexcept>
+
+using namespace db;
+
+namespace {
+template <typename T> T load(const uint8_t *p) {
+  T value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+template <typename T> void store(uint8_t *p, T value) { std::memcpy(p, &value, sizeof(value)); }
+
+size_t widthOf(type_t type) {
+  switch (type) {
+  case type_t::INT:
+    return INT_SIZE;
+  case type_t::DOUBLE:
+    return DOUBLE_SIZE;
+  case type_t::CHAR:
+    return CHAR_SIZE;
+  }
+  throw std::logic_error("Unknown field type");
+}
+
+//Copy a field value into a key. Doubles are copied as +0.0 when they are zero so that 0.0 and -0.0, which are equal,
+//have the same bytes.
+void copyKey(uint8_t *key, const uint8_t *data, size_t width, type_t type) {
+  if (type == type_t::DOUBLE && load<double>(data) == 0) {
+    store(key, 0.0);
+  } else {
+    std::memcpy(key, data, width);
+  }
+}
+
+//Hash a fixed-width key 8 bytes at a time.
+uint64_t hashBytes(const uint8_t *key, size_t width) {
+  uint64_t h = width;
+  size_t i = 0;
+  for (; i + 8 <= width; i += 8) {
+    h = (h ^ load<uint64_t>(key + i)) * 0x9e3779b97f4a7c15ULL;
+    h ^= h >> 32;
+  }
+  if (i < width) {
+    uint64_t tail = 0;
+    std::memcpy(&tail, key + i, width - i);
+    h = (h ^ tail) * 0x9e3779b97f4a7c15ULL;
+  }
+  return mix(h);
+}
+} // namespace
+
+//An open addressing hash table that numbers distinct fixed-width keys densely in insertion order.
+//The keys are stored back to back, and the table is kept at most half full and probed linearly.
+class HashAggregator::KeyTable {
+  struct Slot {
+    uint64_t hash;
+    /// 1 + the number of the key, 0 for an empty slot
+    uint32_t id;
+  };
+
+  size_t width;
+  std::vector<uint8_t> keys;
+  std::vector<Slot> slots;
+  uint64_t mask;
+  size_t count = 0;
+
+  void grow() {
+    std::vector<Slot> old(slots.size() * 2, {0, 0});
+    old.swap(slots);
+    mask = slots.size() - 1;
+    for (const auto &slot : old) {
+      if (slot.id != 0) {
+        uint64_t pos = slot.hash & mask;
+        while (slots[pos].id != 0) {
+          pos = (pos + 1) & mask;
+        }
+        slots[pos] = slot;
+      }
+    }
+  }
+
+public:
+  explicit KeyTable(size_t width) : width(width), slots(16, {0, 0}), mask(15) {}
+
+  //Find the number of a key, adding the key if it is new. Returns the number and whether the key was added.
+  //Without group-by fields every key is the empty key of the single group, and there are no bytes to compare or copy.
+  std::pair<uint32_t, bool> insert(const uint8_t *key) {
+    if (width == 0) {
+      if (count == 0) {
+        count = 1;
+        return {0, true};
+      }
+      return {0, false};
+    }
+    if (2 * (count + 1) > slots.size()) {
+      grow();
+    }
+    uint64_t hash = hashBytes(key, width);
+    uint64_t pos = hash & mask;
+    for (; slots[pos].id != 0; pos = (pos + 1) & mask) {
+      uint32_t id = slots[pos].id - 1;
+      if (slots[pos].hash == hash && std::memcmp(keys.data() + id * width, key, width) == 0) {
+        return {id, false};
+      }
+    }
+    keys.insert(keys.end(), key, key + width);
+    slots[pos] = {hash, static_cast<uint32_t>(count + 1)};
+    return {count++, true};
+  }
+
+  size_t size() const { return count; }
+
+  const uint8_t *keyOf(uint32_t id) const { return keys.data() + id * width; }
+};
+
+HashAggregator::HashAggregator(const TupleDesc &input, const std::vector<std::string> &group_by,
+                               const std::vector<AggregateTerm> &terms)
+    : input_td(input) {
+  std::vector<type_t> types;
+  std::vector<std::string> names;
+  for (const auto &name : group_by) {
+    size_t idx = input.index_of(name);
+    type_t type = input.type_of(idx);
+    group_fields.push_back({input.offset_of(idx), widthOf(type), type});
+    key_width += widthOf(type);
+    types.push_back(type);
+    names.push_back(name);
+  }
+  group_td = TupleDesc(types, names);
+
+  for (const auto &term : terms) {
+    size_t idx = input.index_of(term.field);
+    type_t type = input.type_of(idx);
+    Accumulator acc{Kind::COUNT, type, input.offset_of(idx), widthOf(type), state_width, 0};
+    type_t result_type = type;
+    size_t size = sizeof(int64_t);
+    switch (term.op) {
+    case AggregateOp::COUNT:
+      result_type = type_t::INT;
+      break;
+    case AggregateOp::COUNT_DISTINCT:
+      acc.kind = Kind::COUNT_DISTINCT;
+      acc.distinct = distinct.size();
+      distinct.push_back(std::make_unique<KeyTable>(sizeof(uint32_t) + acc.width));
+      result_type = type_t::INT;
+      break;
+    case AggregateOp::SUM:
+    case AggregateOp::AVG:
+      if (type == type_t::CHAR) {
+        throw std::logic_error("Cannot sum a CHAR field");
+      }
+      if (term.op == AggregateOp::SUM) {
+        acc.kind = type == type_t::INT ? Kind::SUM_INT : Kind::SUM_DOUBLE;
+      } else {
+        acc.kind = type == type_t::INT ? Kind::AVG_INT : Kind::AVG_DOUBLE;
+        result_type = type_t::DOUBLE;
+        size = 2 * sizeof(int64_t);//The sum, then the count
+      }
+      break;
+    case AggregateOp::MIN:
+    case AggregateOp::MAX: {
+      bool is_min = term.op == AggregateOp::MIN;
+      switch (type) {
+      case type_t::INT:
+        acc.kind = is_min ? Kind::MIN_INT : Kind::MAX_INT;
+        break;
+      case type_t::DOUBLE:
+        acc.kind = is_min ? Kind::MIN_DOUBLE : Kind::MAX_DOUBLE;
+        break;
+      case type_t::CHAR:
+        acc.kind = is_min ? Kind::MIN_CHAR : Kind::MAX_CHAR;
+        break;
+      }
+      size = acc.width;
+      break;
+    }
+    default:
+      throw std::logic_error("Unsupported aggregation operation");
+    }
+    accumulators.push_back(acc);
+    state_width += size;
+    types.push_back(result_type);
+    names.push_back(nameOf(term));
+  }
+  td = TupleDesc(types, names);
+
+  groups = std::make_unique<KeyTable>(key_width);
+  key.resize(key_width);
+  buffer.resize(input.length());
+}
+
+HashAggregator::~HashAggregator() = default;
+
+std::string HashAggregator::nameOf(const AggregateTerm &term) {
+  switch (term.op) {
+  case AggregateOp::SUM:
+    return "SUM(" + term.field + ")";
+  case AggregateOp::AVG:
+    return "AVG(" + term.field + ")";
+  case AggregateOp::MIN:
+    return "MIN(" + term.field + ")";
+  case AggregateOp::MAX:
+    return "MAX(" + term.field + ")";
+  case AggregateOp::COUNT:
+    return "COUNT(" + term.field + ")";
+  case AggregateOp::COUNT_DISTINCT:
+    return "COUNT(DISTINCT " + term.field + ")";
+  default:
+    throw std::logic_error("Unsupported aggregation operation");
+  }
+}
+
+const TupleDesc &HashAggregator::getTupleDesc() const { return td; }
+
+void HashAggregator::add(const uint8_t *data) {
+  uint8_t *k = key.data();
+  for (const auto &field : group_fields) {
+    copyKey(k, data + field.input_offset, field.width, field.type);
+    k += field.width;
+  }
+  auto [group, added] = groups->insert(key.data());
+  if (added) {
+    //MIN and MAX start from the first value of the group, the other accumulators from zero.
+    states.resize(states.size() + state_width, 0);
+    uint8_t *state = states.data() + group * state_width;
+    for (const auto &acc : accumulators) {
+      switch (acc.kind) {
+      case Kind::MIN_INT:
+      case Kind::MAX_INT:
+      case Kind::MIN_DOUBLE:
+      case Kind::MAX_DOUBLE:
+      case Kind::MIN_CHAR:
+      case Kind::MAX_CHAR:
+        std::memcpy(state + acc.offset, data + acc.input_offset, acc.width);
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  uint8_t *state = states.data() + group * state_width;
+  for (const auto &acc : accumulators) {
+    uint8_t *s = state + acc.offset;
+    const uint8_t *value = data + acc.input_offset;
+    switch (acc.kind) {
+    case Kind::COUNT:
+      store(s, load<int64_t>(s) + 1);
+      break;
+    case Kind::SUM_INT:
+      store(s, load<int64_t>(s) + load<int>(value));
+      break;
+    case Kind::SUM_DOUBLE:
+      store(s, load<double>(s) + load<double>(value));
+      break;
+    case Kind::AVG_INT:
+      store(s, load<int64_t>(s) + load<int>(value));
+      store(s + sizeof(int64_t), load<int64_t>(s + sizeof(int64_t)) + 1);
+      break;
+    case Kind::AVG_DOUBLE:
+      store(s, load<double>(s) + load<double>(value));
+      store(s + sizeof(int64_t), load<int64_t>(s + sizeof(int64_t)) + 1);
+      break;
+    case Kind::MIN_INT:
+      store(s, std::min(load<int>(s), load<int>(value)));
+      break;
+    case Kind::MAX_INT:
+      store(s, std::max(load<int>(s), load<int>(value)));
+      break;
+    case Kind::MIN_DOUBLE:
+      store(s, std::min(load<double>(s), load<double>(value)));
+      break;
+    case Kind::MAX_DOUBLE:
+      store(s, std::max(load<double>(s), load<double>(value)));
+      break;
+    case Kind::MIN_CHAR:
+      if (strncmp(reinterpret_cast<const char *>(value), reinterpret_cast<const char *>(s), CHAR_SIZE) < 0) {
+        std::memcpy(s, value, CHAR_SIZE);
+      }
+      break;
+    case Kind::MAX_CHAR:
+      if (strncmp(reinterpret_cast<const char *>(value), reinterpret_cast<const char *>(s), CHAR_SIZE) > 0) {
+        std::memcpy(s, value, CHAR_SIZE);
+      }
+      break;
+    case Kind::COUNT_DISTINCT: {
+      //The distinct sets are shared by all groups, so the values are keyed by (group, value).
+      uint8_t pair[sizeof(uint32_t) + CHAR_SIZE];
+      store(pair, group);
+      copyKey(pair + sizeof(uint32_t), value, acc.width, acc.type);
+      if (distinct[acc.distinct]->insert(pair).second) {
+        store(s, load<int64_t>(s) + 1);
+      }
+      break;
+    }
+    }
+  }
+}
+
+bool HashAggregator::canAddColumns() const {
+  return group_fields.empty() && std::all_of(accumulators.begin(), accumulators.end(), [](const Accumulator &acc) {
+           return acc.kind == Kind::COUNT || (acc.kind != Kind::COUNT_DISTINCT && acc.type != type_t::CHAR);
+         });
+}
+
+void HashAggregator::addColumns(const std::vector<const uint8_t *> &values, const uint8_t *selected, size_t n) {
+  if (!canAddColumns()) {
+    throw std::logic_error("Cannot aggregate columns");
+  }
+  size_t count = countSelected(selected, n);
+  if (count == 0) {
+    return;
+  }
+  //The single group is added with the first batch, with MIN and MAX taken from the batch instead of a first value.
+  auto [group, added] = groups->insert(key.data());
+  if (added) {
+    states.resize(state_width, 0);
+  }
+  uint8_t *state = states.data() + group * state_width;
+  for (size_t i = 0; i < accumulators.size(); i++) {
+    const Accumulator &acc = accumulators[i];
+    uint8_t *s = state + acc.offset;
+    if (acc.kind == Kind::COUNT) {
+      store(s, load<int64_t>(s) + static_cast<int64_t>(count));
+    } else if (acc.type == type_t::INT) {
+      IntSummary summary = summarizeInt(values[i], selected, n);
+      switch (acc.kind) {
+      case Kind::SUM_INT:
+        store(s, load<int64_t>(s) + summary.sum);
+        break;
+      case Kind::AVG_INT:
+        store(s, load<int64_t>(s) + summary.sum);
+        store(s + sizeof(int64_t), load<int64_t>(s + sizeof(int64_t)) + static_cast<int64_t>(count));
+        break;
+      case Kind::MIN_INT:
+        store(s, added ? summary.min : std::min(load<int>(s), summary.min));
+        break;
+      case Kind::MAX_INT:
+        store(s, added ? summary.max : std::max(load<int>(s), summary.max));
+        break;
+      default:
+        break;
+      }
+    } else {
+      DoubleSummary summary = summarizeDouble(values[i], selected, n);
+      switch (acc.kind) {
+      case Kind::SUM_DOUBLE:
+        store(s, load<double>(s) + summary.sum);
+        break;
+      case Kind::AVG_DOUBLE:
+        store(s, load<double>(s) + summary.sum);
+        store(s + sizeof(int64_t), load<int64_t>(s + sizeof(int64_t)) + static_cast<int64_t>(count));
+        break;
+      case Kind::MIN_DOUBLE:
+        store(s, added ? summary.min : std::min(load<double>(s), summary.min));
+        break;
+      case Kind::MAX_DOUBLE:
+        store(s, added ? summary.max : std::max(load<double>(s), summary.max));
+        break;
+      default:
+        break;
+      }
+    }
+  }
+}
+
+void HashAggregator::add(const Tuple &t) {
+  input_td.serialize(buffer.data(), t);
+  add(buffer.data());
+}
+
+void HashAggregator::merge(const HashAggregator &other, size_t partition, size_t num_partitions) {
+  //The group of this aggregator for each group of the other one, if the group is in the partition
+  constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+  std::vector<uint32_t> remap(other.groups->size(), NONE);
+  for (uint32_t other_group = 0; other_group < other.groups->size(); ++other_group) {
+    const uint8_t *group_key = other.groups->keyOf(other_group);
+    //The high bits of the hash select the partition, the low ones the slot of the table.
+    if ((hashBytes(group_key, key_width) >> 32) % num_partitions != partition) {
+      continue;
+    }
+    auto [group, added] = groups->insert(group_key);
+    remap[other_group] = group;
+    const uint8_t *other_state = other.states.data() + other_group * state_width;
+    if (added) {
+      states.insert(states.end(), other_state, other_state + state_width);
+      for (const auto &acc : accumulators) {
+        if (acc.kind == Kind::COUNT_DISTINCT) {
+          store<int64_t>(states.data() + group * state_width + acc.offset, 0);
+        }
+      }
+      continue;
+    }
+    uint8_t *state = states.data() + group * state_width;
+    for (const auto &acc : accumulators) {
+      uint8_t *s = state + acc.offset;
+      const uint8_t *o = other_state + acc.offset;
+      switch (acc.kind) {
+      case Kind::COUNT:
+      case Kind::SUM_INT:
+        store(s, load<int64_t>(s) + load<int64_t>(o));
+        break;
+      case Kind::SUM_DOUBLE:
+        store(s, load<double>(s) + load<double>(o));
+        break;
+      case Kind::AVG_INT:
+        store(s, load<int64_t>(s) + load<int64_t>(o));
+        store(s + sizeof(int64_t), load<int64_t>(s + sizeof(int64_t)) + load<int64_t>(o + sizeof(int64_t)));
+        break;
+      case Kind::AVG_DOUBLE:
+        store(s, load<double>(s) + load<double>(o));
+        store(s + sizeof(int64_t), load<int64_t>(s + sizeof(int64_t)) + load<int64_t>(o + sizeof(int64_t)));
+        break;
+      case Kind::MIN_INT:
+        store(s, std::min(load<int>(s), load<int>(o)));
+        break;
+      case Kind::MAX_INT:
+        store(s, std::max(load<int>(s), load<int>(o)));
+        break;
+      case Kind::MIN_DOUBLE:
+        store(s, std::min(load<double>(s), load<double>(o)));
+        break;
+      case Kind::MAX_DOUBLE:
+        store(s, std::max(load<double>(s), load<double>(o)));
+        break;
+      case Kind::MIN_CHAR:
+        if (strncmp(reinterpret_cast<const char *>(o), reinterpret_cast<const char *>(s), CHAR_SIZE) < 0) {
+          std::memcpy(s, o, CHAR_SIZE);
+        }
+        break;
+      case Kind::MAX_CHAR:
+        if (strncmp(reinterpret_cast<const char *>(o), reinterpret_cast<const char *>(s), CHAR_SIZE) > 0) {
+          std::memcpy(s, o, CHAR_SIZE);
+        }
+        break;
+      case Kind::COUNT_DISTINCT:
+        break;
+      }
+    }
+  }
+
+  //Distinct counts cannot be added, the distinct values of the merged groups are inserted again instead.
+  for (const auto &acc : accumulators) {
+    if (acc.kind != Kind::COUNT_DISTINCT) {
+      continue;
+    }
+    const KeyTable &other_set = *other.distinct[acc.distinct];
+    KeyTable &set = *distinct[acc.distinct];
+    uint8_t pair[sizeof(uint32_t) + CHAR_SIZE];
+    for (uint32_t i = 0; i < other_set.size(); ++i) {
+      const uint8_t *other_pair = other_set.keyOf(i);
+      uint32_t group = remap[load<uint32_t>(other_pair)];
+      if (group == NONE) {
+        continue;
+      }
+      store(pair, group);
+      std::memcpy(pair + sizeof(uint32_t), other_pair + sizeof(uint32_t), acc.width);
+      if (set.insert(pair).second) {
+        uint8_t *s = states.data() + group * state_width + acc.offset;
+        store(s, load<int64_t>(s) + 1);
+      }
+    }
+  }
+}
+
+size_t HashAggregator::size() const { return groups->size(); }
+
+std::vector<Tuple> HashAggregator::results() const {
+  std::vector<Tuple> results;
+  auto finalize = [&](const uint8_t *group_key, const uint8_t *state) {
+    std::vector<field_t> fields;
+    fields.reserve(td.size());
+    if (group_td.size() > 0) {
+      Tuple group = group_td.deserialize(group_key);
+      for (size_t i = 0; i < group.size(); ++i) {
+        fields.push_back(group.get_field(i));
+      }
+    }
+    for (const auto &acc : accumulators) {
+      const uint8_t *s = state + acc.offset;
+      switch (acc.kind) {
+      case Kind::COUNT:
+      case Kind::SUM_INT:
+      case Kind::COUNT_DISTINCT: {
+        auto value = load<int64_t>(s);
+        if (value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max()) {
+          throw std::overflow_error(td.name_of(fields.size()) + " does not fit in an INT");
+        }
+        fields.emplace_back(static_cast<int>(value));
+        break;
+      }
+      case Kind::SUM_DOUBLE:
+      case Kind::MIN_DOUBLE:
+      case Kind::MAX_DOUBLE:
+        fields.emplace_back(load<double>(s));
+        break;
+      case Kind::AVG_INT:
+      case Kind::AVG_DOUBLE: {
+        auto count = load<int64_t>(s + sizeof(int64_t));
+        double sum = acc.kind == Kind::AVG_INT ? static_cast<double>(load<int64_t>(s)) : load<double>(s);
+        fields.emplace_back(count > 0 ? sum / count : 0.0);
+        break;
+      }
+      case Kind::MIN_INT:
+      case Kind::MAX_INT:
+        fields.emplace_back(load<int>(s));
+        break;
+      case Kind::MIN_CHAR:
+      case Kind::MAX_CHAR: {
+        const char *chars = reinterpret_cast<const char *>(s);
+        fields.emplace_back(std::string(chars, strnlen(chars, CHAR_SIZE)));
+        break;
+      }
+      }
+    }
+    results.emplace_back(fields);
+  };
+
+  for (uint32_t group = 0; group < groups->size(); ++group) {
+    finalize(groups->keyOf(group), states.data() + group * state_width);
+  }
+  //Without groups, an empty input still has one result, where every accumulator is zero.
+  if (group_fields.empty() && groups->size() == 0) {
+    std::vector<uint8_t> empty(state_width, 0);
+    finalize(nullptr, empty.data());
+  }
+  return results;
+}
+
+TupleDesc db::aggregateDesc(const TupleDesc &in, const std::vector<std::string> &group_by,
+                            const std::vector<AggregateTerm> &terms) {
+  return HashAggregator(in, group_by, terms).getTupleDesc();
+}
+
+HashAggregateOperator::HashAggregateOperator(std::unique_ptr<Operator> child, const std::vector<std::string> &group_by,
+                                             const std::vector<AggregateTerm> &terms)
+    : child(std::move(child)), group_by(group_by), terms(terms),
+      td(aggregateDesc(this->child->getTupleDesc(), group_by, terms)) {}
+
+const TupleDesc &HashAggregateOperator::getTupleDesc() const { return td; }
+
+void HashAggregateOperator::open() {
+  HashAggregator aggregator(child->getTupleDesc(), group_by, terms);
+  child->open();
+  while (auto t = child->next()) {
+    aggregator.add(*t);
+  }
+  child->close();
+  results = aggregator.results();
+  pos = 0;
+}
+
+std::optional<Tuple> HashAggregateOperator::next() {
+  if (pos == results.size()) {
+    return std::nullopt;
+  }
+  return results[pos++];
+}
+
+void HashAggregateOperator::close() {
+  results.clear();
+  pos = 0;
+}
@@ -1,38 +1,100 @@
+#include <db/BTreeFile.hpp>
 #include <db/Database.hpp>
 #include <db/HeapFile.hpp>
 #include <db/HeapPage.hpp>
+#include <db/LeafPage.hpp>
+#include <optional>
 #include <stdexcept>
 
 using namespace db;
 
-HeapFile::HeapFile(const std::string &name, const TupleDesc &td) : DbFile(name, td) {}
+HeapFile::HeapFile(const std::string &name, const TupleDesc &td) : DbFile(name, td), zone_map(td) {
+  zone_map.resize(numPages);
+}
+
+TupleDesc HeapFile::indexDesc() { return {{type_t::INT, type_t::INT, type_t::INT}, {"key", "page", "slot"}}; }
+
+void HeapFile::addIndex(const std::string &field, BTreeFile &index) {
+  size_t field_index = td.index_of(field);
+  if (td.type_of(field_index) != type_t::INT) {
+    throw std::logic_error("Only INT fields can be indexed");
+  }
+  if (getIndex(field_index) != nullptr) {
+    throw std::logic_error("Field already indexed");
+  }
+  const TupleDesc &index_td = index.getTupleDesc();
+  if (index.getKeyIndex() != 0 || index.getKeyWidth() != 3 || index_td.size() != 3 ||
+      index_td.length() != 3 * INT_SIZE) {
+    throw std::logic_error("Index file does not have the index schema");
+  }
+  for (auto it = begin(); it != end(); ++it) {
+    int key = std::get<int>((*it).get_field(field_index));
+    index.insertTuple(Tuple({key, static_cast<int>(it.page), static_cast<int>(it.slot)}));
+  }
+  indexes.emplace_back(field_index, &index);
+}
+
+const BTreeFile *HeapFile::getIndex(size_t field) const {
+  for (const auto &[field_index, index] : indexes) {
+    if (field_index == field) {
+      return index;
+    }
+  }
+  return nullptr;
+}
 
 void HeapFile::insertTuple(const Tuple &t) {
   if (!td.compatible(t)) {
     throw std::runtime_error("Tuple not compatible with TupleDesc");
   }
   BufferPool &bufferPool = getDatabase().getBufferPool();
+  std::lock_guard latch(bufferPool.getLatch());
   PageId pid{name, 0};
   pid.page = numPages - 1;
   Page &p = bufferPool.getPage(pid);
   HeapPage hp(p, td);
-  if (!hp.insertTuple(t)) {
+  size_t slot;
+  // Marked dirty before it changes, so that the snapshots keep its previous version
+  bufferPool.markDirty(pid);
+  if (!hp.insertTuple(t, slot)) {
     numPages++;
     pid.page++;
     Page &np = bufferPool.getPage(pid);
+    bufferPool.markDirty(pid);
     HeapPage nhp(np, td);
-    nhp.insertTuple(t);
+    nhp.insertTuple(t, slot);
+    zone_map.reset(pid.page);
+  }
+  zone_map.update(pid.page, t);
+  for (const auto &[field, index] : indexes) {
+    int key = std::get<int>(t.get_field(field));
+    index->insertTuple(Tuple({key, static_cast<int>(pid.page), static_cast<int>(slot)}));
   }
-  bufferPool.markDirty(pid);
 }
 
 void HeapFile::deleteTuple(const Iterator &it) {
   BufferPool &bufferPool = getDatabase().getBufferPool();
+  std::lock_guard latch(bufferPool.getLatch());
   PageId pid{name, it.page};
   Page &p = bufferPool.getPage(pid);
   HeapPage hp(p, td);
+  std::optional<Tuple> t;
+  if (!indexes.empty()) {
+    t = hp.getTuple(it.slot);
+  }
   bufferPool.markDirty(pid);
   hp.deleteTuple(it.slot);
+  if (!t) {
+    return;
+  }
+  for (const auto &[field, index] : indexes) {
+    // The entries are ordered by (key, page, slot), so the entry of the tuple is found without visiting the others
+    Key entry_key{std::get<int>(t->get_field(field)), static_cast<int>(it.page), static_cast<int>(it.slot)};
+    auto entry = index->lowerBound(entry_key);
+    if (entry != index->end() && keyOf(index->getTuple(entry), 0, 3) == entry_key) {
+      index->deleteTuple(entry);
+    }
+  }
 }
 
 Tuple HeapFile::getTuple(const Iterator &it) const {
@@ -43,6 +105,14 @@ Tuple HeapFile::getTuple(const Iterator &it) const {
   return hp.getTuple(it.slot);
 }
 
+Tuple HeapFile::getTuple(const Iterator &it, const std::vector<size_t> &fields) const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  PageId pid{name, it.page};
+  Page &p = bufferPool.getPage(pid);
+  const HeapPage hp(p, td);
+  return td.deserialize(hp.getData(it.slot), fields);
+}
+
 void HeapFile::next(Iterator &it) const {
   BufferPool &bufferPool = getDatabase().getBufferPool();
   if (it.page < numPages) {
@@ -68,9 +138,25 @@ void HeapFile::next(Iterator &it) const {
   it.slot = 0;
 }
 
-Iterator HeapFile::begin() const {
+const ZoneMap &HeapFile::getZoneMap() const {
+  BufferPool &bufferPool = getDatabase().getBufferPool();
+  zone_map.resize(numPages);
+  for (size_t page = 0; page < numPages; page++) {
+    if (zone_map.isKnown(page)) {
+      continue;
+    }
+    zone_map.reset(page);
+    Page &p = bufferPool.getPage({name, page});
+    const HeapPage hp(p, td);
+    for (size_t slot = hp.begin(); slot != hp.end(); hp.next(slot)) {
+      zone_map.update(page, hp.getTuple(slot));
+    }
+  }
+  return zone_map;
+}
+
+Iterator HeapFile::seek(size_t page) const {
   BufferPool &bufferPool = getDatabase().getBufferPool();
-  size_t page = 0;
   while (page < numPages) {
     PageId pid{name, page};
     Page &p = bufferPool.getPage(pid);
@@ -83,4 +169,6 @@ Iterator HeapFile::begin() const {
   return {*this, numPages, 0};
 }
 
+Iterator HeapFile::begin() const { return seek(0); }
+
 Iterator HeapFile::end() const { return {*this, numPages, 0}; }
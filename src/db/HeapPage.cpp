@@ -22,7 +22,12 @@ size_t HeapPage::begin() const {
 size_t HeapPage::end() const { return capacity; }
 
 bool HeapPage::insertTuple(const Tuple &t) {
-  size_t slot = 0;
+  size_t slot;
+  return insertTuple(t, slot);
+}
+
+bool HeapPage::insertTuple(const Tuple &t, size_t &slot) {
+  slot = 0;
   while (slot < capacity && (header[slot / 8] & (1 << (7 - slot % 8)))) {
     slot++;
   }
@@ -53,6 +58,13 @@ Tuple HeapPage::getTuple(size_t slot) const {
   return td.deserialize(slotData);
 }
 
+const uint8_t *HeapPage::getData(size_t slot) const {
+  if (empty(slot)) {
+    throw std::runtime_error("Slot not occupied");
+  }
+  return data + slot * td.length();
+}
+
 void HeapPage::next(size_t &slot) const {
   while (++slot < capacity && empty(slot))
     ;
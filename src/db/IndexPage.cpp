@@ -1,32 +1,65 @@
+#include <algorithm>
 #include <db/IndexPage.hpp>
 #include <stdexcept>
 
 using namespace db;
 
-IndexPage::IndexPage(Page &page) {
-  capacity = (DEFAULT_PAGE_SIZE - sizeof(IndexPageHeader) - sizeof(int)) / (sizeof(int) + sizeof(size_t));
+IndexPage::IndexPage(Page &page, size_t key_width) : key_width(key_width) {
+  // A full page briefly holds capacity keys and capacity + 1 children, plus room for one more of each
+  capacity = (DEFAULT_PAGE_SIZE - sizeof(IndexPageHeader) - key_width * sizeof(int) - sizeof(size_t)) /
+             (key_width * sizeof(int) + sizeof(size_t));
   header = reinterpret_cast<IndexPageHeader *>(page.data());
   keys = reinterpret_cast<int *>(header + 1);
-  children = reinterpret_cast<size_t *>(keys + capacity + 1);
+  children = reinterpret_cast<size_t *>(keys + (capacity + 1) * key_width);
 }
 
-bool IndexPage::insert(int key, size_t child) {
-  auto it = std::lower_bound(keys, keys + header->size, key);
-  auto slot = it - keys;
-  std::move_backward(keys + slot, keys + header->size, keys + header->size + 1);
+Key IndexPage::getKey(size_t slot) const {
+  Key key{};
+  std::copy(keys + slot * key_width, keys + (slot + 1) * key_width, key.begin());
+  return key;
+}
+
+size_t IndexPage::lowerBound(const Key &key) const {
+  size_t lower = 0, upper = header->size;
+  while (lower < upper) {
+    size_t mid = (lower + upper) / 2;
+    if (getKey(mid) < key) {
+      lower = mid + 1;
+    } else {
+      upper = mid;
+    }
+  }
+  return lower;
+}
+
+size_t IndexPage::upperBound(const Key &key) const {
+  size_t lower = 0, upper = header->size;
+  while (lower < upper) {
+    size_t mid = (lower + upper) / 2;
+    if (key < getKey(mid)) {
+      upper = mid;
+    } else {
+      lower = mid + 1;
+    }
+  }
+  return lower;
+}
+
+bool IndexPage::insert(size_t slot, const Key &key, size_t child) {
+  std::move_backward(keys + slot * key_width, keys + header->size * key_width, keys + (header->size + 1) * key_width);
   std::move_backward(children + slot + 1, children + header->size + 1, children + header->size + 2);
-  keys[slot] = key;
+  std::copy(key.begin(), key.begin() + key_width, keys + slot * key_width);
   children[slot + 1] = child;
   ++header->size;
   return header->size == capacity;
 }
 
-int IndexPage::split(IndexPage &new_page) {
+Key IndexPage::split(IndexPage &new_page) {
   size_t half = header->size / 2;
   new_page.header->size = header->size - half - 1;
   new_page.header->index_children = header->index_children;
-  std::copy(keys + half + 1, keys + header->size, new_page.keys);
+  std::copy(keys + (half + 1) * key_width, keys + header->size * key_width, new_page.keys);
   std::copy(children + half + 1, children + header->size + 1, new_page.children);
   header->size = half;
-  return keys[half];
+  return getKey(half);
 }
@@ -5,7 +5,7 @@ using namespace db;
 
 Iterator::Iterator(const DbFile &file, const size_t &page, size_t slot) : file(file), page(page), slot(slot) {}
 
-Tuple Iterator::operator*() const { return file.getTuple(*this); }
+Tuple Iterator::operator*() const { return fields == nullptr ? file.getTuple(*this) : file.getTuple(*this, *fields); }
 
 Iterator &Iterator::operator++() {
   file.next(*this);
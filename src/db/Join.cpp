@@ -0,0 +1,875 @@
+#include <algorithm>
+#include <cstring>
+#include <db/BTreeFile.hpp>
+#include <db/ExternalSort.hpp>
+#include <db/Hash.hpp>
+#include <db/HeapFile.hpp>
+#include <db/Operator.hpp>
+#include <db/ParallelScan.hpp>
+#include <db/Profile.hpp>
+#include <db/Query.hpp>
+#include <db/SpillFile.hpp>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+using namespace db;
+
+namespace {
+//Writes the combination of a left and a right record to the output table. The join field of the right record is dropped
+//for equality joins. One field buffer is reused for every output record.
+class JoinWriter {
+  DbFile &output;
+  size_t right_idx;
+  bool eliminate_duplicates;
+  QueryStep &step;
+  std::vector<field_t> combined_fields;
+
+public:
+  JoinWriter(DbFile &output, size_t right_idx, bool eliminate_duplicates, QueryStep &step)
+      : output(output), right_idx(right_idx), eliminate_duplicates(eliminate_duplicates), step(step) {}
+
+  void write(const Tuple &left_record, const Tuple &right_record) {
+    combined_fields.clear();
+    for (size_t i = 0; i < left_record.size(); ++i) {
+      combined_fields.push_back(left_record.get_field(i));
+    }
+    for (size_t i = 0; i < right_record.size(); ++i) {
+      if (i != right_idx || !eliminate_duplicates) {
+        combined_fields.push_back(right_record.get_field(i));
+      }
+    }
+    output.insertTuple(Tuple(combined_fields));
+    step.wrote();
+  }
+};
+
+//The schema of the combination of a left and a right record (see JoinWriter).
+TupleDesc joinDesc(const TupleDesc &left_desc, const TupleDesc &right_desc, size_t right_idx, PredicateOp op) {
+  std::vector<type_t> types;
+  std::vector<std::string> names;
+  for (size_t i = 0; i < left_desc.size(); ++i) {
+    types.push_back(left_desc.type_of(i));
+    names.push_back(left_desc.name_of(i));
+  }
+  for (size_t i = 0; i < right_desc.size(); ++i) {
+    if (i != right_idx || op != PredicateOp::EQ) {
+      types.push_back(right_desc.type_of(i));
+      names.push_back(right_desc.name_of(i));
+    }
+  }
+  return {types, names};
+}
+
+Tuple combineRecords(const Tuple &left_record, const Tuple &right_record, size_t right_idx, PredicateOp op) {
+  std::vector<field_t> combined_fields;
+  combined_fields.reserve(left_record.size() + right_record.size());
+  for (size_t i = 0; i < left_record.size(); ++i) {
+    combined_fields.push_back(left_record.get_field(i));
+  }
+  for (size_t i = 0; i < right_record.size(); ++i) {
+    if (i != right_idx || op != PredicateOp::EQ) {
+      combined_fields.push_back(right_record.get_field(i));
+    }
+  }
+  return Tuple(combined_fields);
+}
+
+//std::hash of an int is the identity, mix the bits so that nearby keys spread over the whole table.
+uint64_t hashKey(const field_t &key) { return mix(std::hash<field_t>{}(key)); }
+
+//An open addressing hash table from join keys to the records of the build input.
+//There is one slot per distinct key, and the records sharing a key are chained through `next` in input order.
+//The table is kept at most half full and probed linearly, so a probe usually touches one or two adjacent slots.
+class JoinHashTable {
+  struct Slot {
+    uint64_t hash;
+    /// 1 + the index of the first record with this key, 0 for an empty slot
+    uint32_t head;
+  };
+
+  std::vector<Tuple> records;
+  size_t key_idx;
+  /// 1 + the index of the next record with the same key, 0 at the end of a chain
+  std::vector<uint32_t> next;
+  std::vector<Slot> slots;
+  uint64_t mask;
+
+public:
+  JoinHashTable(std::vector<Tuple> build, size_t key_idx) : records(std::move(build)), key_idx(key_idx) {
+    size_t capacity = 16;
+    while (capacity < 2 * records.size()) {
+      capacity *= 2;
+    }
+    slots.assign(capacity, {0, 0});
+    mask = capacity - 1;
+    next.assign(records.size(), 0);
+    //Insert backwards and prepend to the chains so that each chain ends up in input order.
+    for (size_t i = records.size(); i-- > 0;) {
+      const field_t &key = records[i].get_field(key_idx);
+      uint64_t hash = hashKey(key);
+      uint64_t pos = hash & mask;
+      while (slots[pos].head != 0 &&
+             (slots[pos].hash != hash || records[slots[pos].head - 1].get_field(key_idx) != key)) {
+        pos = (pos + 1) & mask;
+      }
+      next[i] = slots[pos].head;
+      slots[pos] = {hash, static_cast<uint32_t>(i + 1)};
+    }
+  }
+
+  //Call f with every build record whose key equals the given key.
+  template <typename F> void probe(const field_t &key, F f) const {
+    uint64_t hash = hashKey(key);
+    for (uint64_t pos = hash & mask; slots[pos].head != 0; pos = (pos + 1) & mask) {
+      if (slots[pos].hash == hash && records[slots[pos].head - 1].get_field(key_idx) == key) {
+        for (uint32_t i = slots[pos].head; i != 0; i = next[i - 1]) {
+          f(records[i - 1]);
+        }
+        return;
+      }
+    }
+  }
+};
+
+//Compare every left record with every right record.
+void nestedLoopJoin(const DbFile &left, const DbFile &right, JoinWriter &writer, size_t left_idx, size_t right_idx,
+                    PredicateOp op, QueryStep &step) {
+  for (const auto &left_record : left) {
+    step.read(0);
+    const field_t &left_field = left_record.get_field(left_idx);
+    for (const auto &right_record : right) {
+      step.read(1);
+      if (evaluateCondition(left_field, op, right_record.get_field(right_idx))) {
+        writer.write(left_record, right_record);
+      }
+    }
+  }
+}
+
+//Visits every record of a join input, either a database file or a spill partition.
+using Scan = std::function<void(const std::function<void(const Tuple &)> &)>;
+
+//A hybrid hash join. When the build input fits in the memory budget it is loaded into one hash table and the probe
+//input is scanned once. Otherwise both inputs are partitioned by the hash of the key into spill files, keeping the
+//first build partition in memory (so its probe records are joined while partitioning), and each spilled pair of
+//partitions is joined the same way with a different hash, recursively.
+class HashJoin {
+  /// Stop repartitioning after this many levels, e.g. when most records share one key
+  static constexpr size_t MAX_DEPTH = 4;
+
+  JoinWriter &writer;
+  bool build_left;
+  size_t build_idx, probe_idx;
+  const TupleDesc &build_td, &probe_td;
+  size_t memory_pages;
+
+  void emit(const Tuple &build_record, const Tuple &probe_record) {
+    if (build_left) {
+      writer.write(build_record, probe_record);
+    } else {
+      writer.write(probe_record, build_record);
+    }
+  }
+
+  //The number of build records that fit in the given number of pages.
+  size_t capacity(size_t pages) const { return std::max<size_t>(1, pages * DEFAULT_PAGE_SIZE / build_td.length()); }
+
+  //The partition of a key. Each level of recursion uses a different hash, which is also independent of the hash used
+  //by the tables, so the records of one partition still spread over a whole table.
+  static size_t partitionOf(const field_t &key, size_t depth, size_t partitions) {
+    return mix(hashKey(key) + (depth + 1) * 0x9e3779b97f4a7c15ULL) % partitions;
+  }
+
+  //Load as many build records as the budget allows into a hash table, probe it with every probe record, and repeat
+  //until the build input is exhausted. With a single block this is the classic in-memory hash join.
+  void joinBlocks(const Scan &build, const Scan &probe) {
+    std::vector<Tuple> block;
+    size_t limit = capacity(memory_pages);
+    auto join_block = [&]() {
+      JoinHashTable table(std::move(block), build_idx);
+      block.clear();
+      probe([&](const Tuple &probe_record) {
+        table.probe(probe_record.get_field(probe_idx),
+                    [&](const Tuple &build_record) { emit(build_record, probe_record); });
+      });
+    };
+    build([&](const Tuple &build_record) {
+      block.push_back(build_record);
+      if (block.size() == limit) {
+        join_block();
+      }
+    });
+    if (!block.empty()) {
+      join_block();
+    }
+  }
+
+public:
+  HashJoin(JoinWriter &writer, bool build_left, size_t build_idx, size_t probe_idx, const TupleDesc &build_td,
+           const TupleDesc &probe_td, size_t memory_pages)
+      : writer(writer), build_left(build_left), build_idx(build_idx), probe_idx(probe_idx), build_td(build_td),
+        probe_td(probe_td), memory_pages(std::max<size_t>(memory_pages, 4)) {}
+
+  void run(const Scan &build, size_t build_pages, const Scan &probe, size_t depth) {
+    if (build_pages <= memory_pages) {
+      joinBlocks(build, probe);
+      return;
+    }
+
+    //Aim for partitions of half the budget. The other half holds the resident partition and one page per spill file.
+    size_t partitions = std::clamp<size_t>((2 * build_pages + memory_pages - 1) / memory_pages, 2, memory_pages / 2);
+    std::vector<std::unique_ptr<SpillFile>> build_parts(partitions), probe_parts(partitions);
+    for (size_t i = 0; i < partitions; i++) {
+      build_parts[i] = std::make_unique<SpillFile>(build_td);
+      probe_parts[i] = std::make_unique<SpillFile>(probe_td);
+    }
+
+    //Partition 0 stays in memory unless it outgrows its share, in which case it is spilled like the others.
+    std::vector<Tuple> resident;
+    bool spilled = false;
+    size_t resident_limit = capacity(memory_pages / 2);
+    build([&](const Tuple &record) {
+      size_t part = partitionOf(record.get_field(build_idx), depth, partitions);
+      if (part != 0 || spilled) {
+        build_parts[part]->append(record);
+        return;
+      }
+      resident.push_back(record);
+      if (resident.size() > resident_limit) {
+        for (const auto &t : resident) {
+          build_parts[0]->append(t);
+        }
+        resident.clear();
+        spilled = true;
+      }
+    });
+
+    JoinHashTable table(std::move(resident), build_idx);
+    probe([&](const Tuple &record) {
+      const field_t &key = record.get_field(probe_idx);
+      size_t part = partitionOf(key, depth, partitions);
+      if (part != 0 || spilled) {
+        probe_parts[part]->append(record);
+        return;
+      }
+      table.probe(key, [&](const Tuple &build_record) { emit(build_record, record); });
+    });
+
+    for (size_t i = spilled ? 0 : 1; i < partitions; i++) {
+      const SpillFile &build_part = *build_parts[i], &probe_part = *probe_parts[i];
+      if (build_part.size() == 0 || probe_part.size() == 0) {
+        continue;
+      }
+      Scan scan_build = [&](const auto &f) { build_part.scan(f); };
+      Scan scan_probe = [&](const auto &f) { probe_part.scan(f); };
+      //Hashing again cannot split a partition that did not shrink (e.g. a single hot key): join it in blocks instead.
+      if (depth + 1 == MAX_DEPTH || build_part.getNumPages() >= build_pages) {
+        joinBlocks(scan_build, scan_probe);
+      } else {
+        run(scan_build, build_part.getNumPages(), scan_probe, depth + 1);
+      }
+    }
+  }
+};
+
+//Join with a hash table on the input with fewer pages, spilling both inputs to partitions if it exceeds the budget.
+void hashJoin(const DbFile &left, const DbFile &right, JoinWriter &writer, size_t left_idx, size_t right_idx,
+              size_t memory_pages, QueryStep &step) {
+  bool build_left = left.getNumPages() < right.getNumPages();
+  const DbFile &build = build_left ? left : right;
+  const DbFile &probe = build_left ? right : left;
+  HashJoin hash_join(writer, build_left, build_left ? left_idx : right_idx, build_left ? right_idx : left_idx,
+                     build.getTupleDesc(), probe.getTupleDesc(), memory_pages);
+
+  auto scan = [&step](const DbFile &file, size_t input) -> Scan {
+    return [&file, &step, input](const auto &f) {
+      for (const auto &record : file) {
+        step.read(input);
+        f(record);
+      }
+    };
+  };
+  hash_join.run(scan(build, build_left ? 0 : 1), build.getNumPages(), scan(probe, build_left ? 1 : 0), 0);
+}
+//The hash of a join key in a serialized record, consistent with the equality of keys of its type.
+uint64_t hashKeyData(const uint8_t *key, type_t type) {
+  switch (type) {
+  case type_t::INT: {
+    int value;
+    std::memcpy(&value, key, sizeof(value));
+    return mix(static_cast<uint32_t>(value));
+  }
+  case type_t::DOUBLE: {
+    double value;
+    std::memcpy(&value, key, sizeof(value));
+    value = value == 0 ? 0.0 : value;//-0.0 == 0.0
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return mix(bits);
+  }
+  case type_t::CHAR: {
+    const char *chars = reinterpret_cast<const char *>(key);
+    return mix(std::hash<std::string_view>{}({chars, strnlen(chars, CHAR_SIZE)}));
+  }
+  }
+  throw std::logic_error("Unknown field type");
+}
+
+bool keyEquals(const uint8_t *a, const uint8_t *b, type_t type) {
+  switch (type) {
+  case type_t::INT:
+    return std::memcmp(a, b, INT_SIZE) == 0;
+  case type_t::DOUBLE: {
+    double x, y;
+    std::memcpy(&x, a, sizeof(x));
+    std::memcpy(&y, b, sizeof(y));
+    return x == y;
+  }
+  case type_t::CHAR:
+    return strncmp(reinterpret_cast<const char *>(a), reinterpret_cast<const char *>(b), CHAR_SIZE) == 0;
+  }
+  throw std::logic_error("Unknown field type");
+}
+
+//A parallel radix hash join of two inputs that fit in memory. Both inputs are scanned by all threads, and each thread
+//copies the serialized records it reads, prefixed by the hash of their key, into its own buffer for the partition
+//given by the top bits of the hash. There are enough partitions for the build side of each one to fit in the cache.
+//The partitions are then joined independently: a thread takes the next partition, builds a table on its build records
+//from every thread's buffer and probes it with the probe records, writing its output to its own spill file.
+//No locks are taken: the only shared state is the counter of the next partition.
+void radixJoin(const DbFile &left, const DbFile &right, DbFile &output, size_t left_idx, size_t right_idx,
+               size_t num_threads, QueryStep &step) {
+  /// The size of the build side of a partition, so that its records and hash table stay in the cache
+  constexpr size_t CACHE_BYTES = 256 * 1024;
+  /// The maximum number of radix bits, which keeps the partition buffers written by a thread within reach of the TLB
+  constexpr size_t MAX_BITS = 10;
+
+  const TupleDesc &left_desc = left.getTupleDesc(), &right_desc = right.getTupleDesc();
+  type_t type = left_desc.type_of(left_idx);
+  if (right_desc.type_of(right_idx) != type) {
+    return;//Keys of different types are never equal.
+  }
+  size_t key_width = type == type_t::INT ? INT_SIZE : type == type_t::DOUBLE ? DOUBLE_SIZE : CHAR_SIZE;
+  const TupleDesc &output_desc = output.getTupleDesc();
+  if (output_desc.length() != left_desc.length() + right_desc.length() - key_width) {
+    throw std::logic_error("The output table does not have the schema of the join");
+  }
+
+  struct Side {
+    const DbFile &file;
+    size_t key_offset, length;
+    /// parts[thread][partition] holds (hash, serialized record) pairs
+    std::vector<std::vector<std::vector<uint8_t>>> parts;
+  };
+  bool build_left = left.getNumPages() < right.getNumPages();
+  Side left_side{left, left_desc.offset_of(left_idx), left_desc.length(), {}};
+  Side right_side{right, right_desc.offset_of(right_idx), right_desc.length(), {}};
+  Side &build = build_left ? left_side : right_side, &probe = build_left ? right_side : left_side;
+
+  size_t bits = 0;
+  size_t build_bytes = build.file.getNumPages() * DEFAULT_PAGE_SIZE;
+  while (bits < MAX_BITS && ((build_bytes >> bits) > CACHE_BYTES || (size_t{1} << bits) < 4 * num_threads)) {
+    bits++;
+  }
+  size_t partitions = size_t{1} << bits;
+  //The top bits of the hash select the partition, the low bits the slot of the table.
+  auto partitionOf = [bits](uint64_t hash) -> size_t { return bits == 0 ? 0 : hash >> (64 - bits); };
+
+//---Partition
+  auto partition = [&](Side &side) {
+    side.parts.assign(num_threads, std::vector<std::vector<uint8_t>>(partitions));
+    auto add = [&](size_t thread, const uint8_t *data) {
+      uint64_t hash = hashKeyData(data + side.key_offset, type);
+      auto &part = side.parts[thread][partitionOf(hash)];
+      size_t end = part.size();
+      part.resize(end + sizeof(hash) + side.length);
+      std::memcpy(part.data() + end, &hash, sizeof(hash));
+      std::memcpy(part.data() + end + sizeof(hash), data, side.length);
+    };
+    size_t input = &side == &left_side ? 0 : 1;
+    if (parallelScannable(side.file)) {
+      step.read(input, parallelScan(side.file, num_threads, add));
+      return;
+    }
+    std::vector<uint8_t> buffer(side.length);
+    for (const auto &record : side.file) {
+      step.read(input);
+      side.file.getTupleDesc().serialize(buffer.data(), record);
+      add(0, buffer.data());
+    }
+  };
+  partition(build);
+  partition(probe);
+
+//---Build and probe
+  std::vector<std::unique_ptr<SpillFile>> outputs;
+  for (size_t i = 0; i < num_threads; i++) {
+    outputs.push_back(std::make_unique<SpillFile>(output_desc));
+  }
+  //Every partition is a morsel of its own, so the threads that get the partitions of frequent keys join fewer of them.
+  getScheduler().run(partitions, 1, num_threads, [&](size_t thread, Morsel morsel) {
+    auto hashOf = [](const uint8_t *entry) {
+      uint64_t hash;
+      std::memcpy(&hash, entry, sizeof(hash));
+      return hash;
+    };
+    //The combination of a left and a right record, without the join field of the right one.
+    std::vector<uint8_t> combined(output_desc.length());
+    size_t right_key = right_side.key_offset;
+    auto emit = [&](const uint8_t *left_record, const uint8_t *right_record) {
+      uint8_t *out = combined.data();
+      std::memcpy(out, left_record, left_side.length);
+      out += left_side.length;
+      std::memcpy(out, right_record, right_key);
+      std::memcpy(out + right_key, right_record + right_key + key_width, right_side.length - right_key - key_width);
+      outputs[thread]->append(combined.data());
+    };
+
+    //An open addressing table of the build records (1 + index, 0 for an empty slot), chained through next by key.
+    std::vector<const uint8_t *> records;
+    std::vector<uint32_t> slots, next;
+    const size_t build_stride = sizeof(uint64_t) + build.length, probe_stride = sizeof(uint64_t) + probe.length;
+    for (size_t p = morsel.first; p < morsel.last; p++) {
+      records.clear();
+      for (const auto &parts : build.parts) {
+        for (size_t i = 0; i < parts[p].size(); i += build_stride) {
+          records.push_back(parts[p].data() + i);
+        }
+      }
+      if (records.empty()) {
+        continue;
+      }
+      size_t capacity = 16;
+      while (capacity < 2 * records.size()) {
+        capacity *= 2;
+      }
+      uint64_t mask = capacity - 1;
+      slots.assign(capacity, 0);
+      next.assign(records.size(), 0);
+      //Insert backwards and prepend to the chains so that each chain ends up in input order.
+      for (size_t i = records.size(); i-- > 0;) {
+        uint64_t hash = hashOf(records[i]);
+        const uint8_t *key = records[i] + sizeof(hash) + build.key_offset;
+        uint64_t pos = hash & mask;
+        while (slots[pos] != 0) {
+          const uint8_t *head = records[slots[pos] - 1];
+          if (hashOf(head) == hash && keyEquals(head + sizeof(hash) + build.key_offset, key, type)) {
+            break;
+          }
+          pos = (pos + 1) & mask;
+        }
+        next[i] = slots[pos];
+        slots[pos] = i + 1;
+      }
+
+      for (const auto &parts : probe.parts) {
+        for (size_t i = 0; i < parts[p].size(); i += probe_stride) {
+          const uint8_t *entry = parts[p].data() + i;
+          uint64_t hash = hashOf(entry);
+          const uint8_t *probe_record = entry + sizeof(hash);
+          for (uint64_t pos = hash & mask; slots[pos] != 0; pos = (pos + 1) & mask) {
+            const uint8_t *head = records[slots[pos] - 1];
+            if (hashOf(head) != hash ||
+                !keyEquals(head + sizeof(hash) + build.key_offset, probe_record + probe.key_offset, type)) {
+              continue;
+            }
+            for (uint32_t j = slots[pos]; j != 0; j = next[j - 1]) {
+              const uint8_t *build_record = records[j - 1] + sizeof(hash);
+              if (build_left) {
+                emit(build_record, probe_record);
+              } else {
+                emit(probe_record, build_record);
+              }
+            }
+            break;
+          }
+        }
+      }
+    }
+  });
+
+//---Merge: the output table is not shared between threads, so it is written once all partitions are joined.
+  for (const auto &out : outputs) {
+    out->scan([&](const Tuple &record) {
+      output.insertTuple(record);
+      step.wrote();
+    });
+  }
+}
+
+//Produces the records of a join input in ascending order of one field.
+using SortedStream = std::function<std::optional<Tuple>()>;
+
+//Check whether a file is a B+tree whose key is the given field, i.e. whose iteration order is sorted on that field.
+bool sortedOn(const DbFile &file, size_t idx) {
+  const auto *btree = dynamic_cast<const BTreeFile *>(&file);
+  return btree != nullptr && btree->getKeyIndex() == idx;
+}
+
+//Read a file in ascending order of a field: directly if it is a B+tree on that field, otherwise through an external sort.
+//The records read are counted as the given input of the step.
+SortedStream sortedStream(const DbFile &file, size_t idx, size_t memory_pages, QueryStep &step, size_t input) {
+  if (sortedOn(file, idx)) {
+    return [it = file.begin(), end = file.end(), &step, input]() mutable -> std::optional<Tuple> {
+      if (it == end) {
+        return std::nullopt;
+      }
+      step.read(input);
+      Tuple record = *it;
+      ++it;
+      return record;
+    };
+  }
+  auto sorter = std::make_shared<ExternalSort>(
+      file.getTupleDesc(), [idx](const Tuple &a, const Tuple &b) { return a.get_field(idx) < b.get_field(idx); },
+      memory_pages);
+  for (const auto &record : file) {
+    step.read(input);
+    sorter->add(record);
+  }
+  return [sorter]() { return sorter->next(); };
+}
+
+//Read both inputs in key order and advance the one with the smaller key. For each key present on both sides, the right
+//records with that key are buffered and combined with every left record with the same key.
+void sortMergeJoin(const DbFile &left, const DbFile &right, JoinWriter &writer, size_t left_idx, size_t right_idx,
+                   size_t memory_pages, QueryStep &step) {
+  //Each side gets half of the budget for its sort.
+  SortedStream left_stream = sortedStream(left, left_idx, memory_pages / 2, step, 0);
+  SortedStream right_stream = sortedStream(right, right_idx, memory_pages / 2, step, 1);
+  std::optional<Tuple> left_record = left_stream(), right_record = right_stream();
+  std::vector<Tuple> group;
+  while (left_record && right_record) {
+    const field_t &left_key = left_record->get_field(left_idx);
+    const field_t &right_key = right_record->get_field(right_idx);
+    if (left_key < right_key) {
+      left_record = left_stream();
+    } else if (right_key < left_key) {
+      right_record = right_stream();
+    } else {
+      field_t key = right_key;
+      group.clear();
+      while (right_record && right_record->get_field(right_idx) == key) {
+        group.push_back(std::move(*right_record));
+        right_record = right_stream();
+      }
+      while (left_record && left_record->get_field(left_idx) == key) {
+        for (const auto &match : group) {
+          writer.write(*left_record, match);
+        }
+        left_record = left_stream();
+      }
+    }
+  }
+}
+//An input whose records can be found by the value of the join field, through the B+tree of the file itself or a
+//secondary index of a heap file.
+struct IndexedInput {
+  const DbFile *file;
+  const BTreeFile *index;
+  bool clustered;
+};
+
+std::optional<IndexedInput> indexOn(const DbFile &file, size_t idx) {
+  if (const BTreeFile *index = findIndex(file, idx)) {
+    return IndexedInput{&file, index, index == &file};
+  }
+  return std::nullopt;
+}
+
+//The comparison that holds between b and a whenever "a op b" holds.
+PredicateOp flip(PredicateOp op) {
+  switch (op) {
+  case PredicateOp::LT:
+    return PredicateOp::GT;
+  case PredicateOp::LE:
+    return PredicateOp::GE;
+  case PredicateOp::GT:
+    return PredicateOp::LT;
+  case PredicateOp::GE:
+    return PredicateOp::LE;
+  default:
+    return op;
+  }
+}
+
+//A rough number of records in a file, assuming full pages.
+size_t estimatedRecords(const DbFile &file) {
+  return file.getNumPages() * (DEFAULT_PAGE_SIZE / file.getTupleDesc().length());
+}
+
+//Whether one index lookup per outer record reads fewer pages than the other joins. An equality lookup that reads about
+//one page is cheaper than reading the whole inner input once. A range lookup reads a third of the inner input (see
+//indexLookupCost), against a nested loop that reads it once per outer page. NE matches almost every inner record, which
+//a nested loop reads sequentially instead of one lookup at a time.
+bool indexJoinPays(const DbFile &outer, const IndexedInput &inner, PredicateOp op) {
+  switch (op) {
+  case PredicateOp::EQ:
+    return estimatedRecords(outer) < inner.file->getNumPages();
+  case PredicateOp::NE:
+    return false;
+  default:
+    double matches = DEFAULT_RANGE_SELECTIVITY * estimatedRecords(*inner.file);
+    return estimatedRecords(outer) * indexLookupCost(*inner.file, *inner.index, matches) <
+           double(outer.getNumPages()) * inner.file->getNumPages();
+  }
+}
+
+//For each outer record, descend the index of the inner input to the records whose key satisfies "key op outer value".
+//NE is answered with the two ranges on either side of the value.
+void indexNestedLoopJoin(const DbFile &outer, size_t outer_idx, const IndexedInput &inner, PredicateOp op,
+                         bool inner_right, JoinWriter &writer, QueryStep &step) {
+  auto emit = [&](const Tuple &outer_record, const Tuple &inner_record) {
+    if (inner_right) {
+      writer.write(outer_record, inner_record);
+    } else {
+      writer.write(inner_record, outer_record);
+    }
+  };
+  std::vector<PredicateOp> ranges = {op};
+  if (op == PredicateOp::NE) {
+    ranges = {PredicateOp::LT, PredicateOp::GT};
+  }
+  size_t outer_input = inner_right ? 0 : 1, inner_input = inner_right ? 1 : 0;
+  for (const auto &outer_record : outer) {
+    step.read(outer_input);
+    const field_t &key = outer_record.get_field(outer_idx);
+    for (PredicateOp range : ranges) {
+      auto [first, last] = indexRange(*inner.index, range, std::get<int>(key));
+      for (auto it = first; it != last; ++it) {
+        step.read(inner_input);
+        if (inner.clustered) {
+          emit(outer_record, *it);
+          continue;
+        }
+        Tuple entry = *it;
+        size_t page = std::get<int>(entry.get_field(1)), slot = std::get<int>(entry.get_field(2));
+        emit(outer_record, inner.file->getTuple({*inner.file, page, slot}));
+      }
+    }
+  }
+}
+} // namespace
+
+//create a new table (output) that contains records formed by combining rows from two input tables where a specified condition holds true
+void db::join(const DbFile &left, const DbFile &right, DbFile &output, const JoinPredicate &predicate,
+              JoinAlgorithm algorithm, size_t memory_pages, size_t num_threads) {
+  const TupleDesc &left_desc = left.getTupleDesc(), &right_desc = right.getTupleDesc();
+  size_t left_idx = left_desc.index_of(predicate.left), right_idx = right_desc.index_of(predicate.right);
+  bool eliminate_duplicates = (predicate.op == PredicateOp::EQ);
+  QueryStep step("Join(" + left.getName() + ", " + right.getName() + ")", {&left, &right});
+  JoinWriter writer(output, right_idx, eliminate_duplicates, step);
+
+  //The inner input of an index join: the right one if it is indexed on its join field, otherwise the left one.
+  //The outer join field must be an INT to be looked up.
+  std::optional<IndexedInput> inner;
+  bool inner_right = false;
+  if (left_desc.type_of(left_idx) == type_t::INT && (inner = indexOn(right, right_idx))) {
+    inner_right = true;
+  } else if (right_desc.type_of(right_idx) == type_t::INT) {
+    inner = indexOn(left, left_idx);
+  }
+  const DbFile &outer = inner_right ? left : right;
+
+  if (algorithm == JoinAlgorithm::AUTO) {
+    if (predicate.op == PredicateOp::EQ && sortedOn(left, left_idx) && sortedOn(right, right_idx)) {
+      algorithm = JoinAlgorithm::SORT_MERGE;
+    } else if (inner && indexJoinPays(outer, *inner, predicate.op)) {
+      algorithm = JoinAlgorithm::INDEX;
+    } else if (predicate.op == PredicateOp::EQ && left.getNumPages() + right.getNumPages() <= memory_pages &&
+               parallelism(left.getNumPages() + right.getNumPages(), num_threads) > 1) {
+      algorithm = JoinAlgorithm::RADIX_HASH;
+    } else if (predicate.op == PredicateOp::EQ) {
+      algorithm = JoinAlgorithm::HASH;
+    } else {
+      algorithm = JoinAlgorithm::NESTED_LOOP;
+    }
+  }
+  switch (algorithm) {
+  case JoinAlgorithm::NESTED_LOOP:
+    nestedLoopJoin(left, right, writer, left_idx, right_idx, predicate.op, step);
+    break;
+  case JoinAlgorithm::HASH:
+    if (predicate.op != PredicateOp::EQ) {
+      throw std::logic_error("Hash join requires an equality predicate");
+    }
+    hashJoin(left, right, writer, left_idx, right_idx, memory_pages, step);
+    break;
+  case JoinAlgorithm::SORT_MERGE:
+    if (predicate.op != PredicateOp::EQ) {
+      throw std::logic_error("Sort-merge join requires an equality predicate");
+    }
+    sortMergeJoin(left, right, writer, left_idx, right_idx, memory_pages, step);
+    break;
+  case JoinAlgorithm::RADIX_HASH:
+    if (predicate.op != PredicateOp::EQ) {
+      throw std::logic_error("Radix hash join requires an equality predicate");
+    }
+    radixJoin(left, right, output, left_idx, right_idx,
+              parallelism(left.getNumPages() + right.getNumPages(), num_threads), step);
+    break;
+  case JoinAlgorithm::INDEX:
+    if (!inner) {
+      throw std::logic_error("Index join requires an index on the join field of one input");
+    }
+    //The index answers "inner key op' outer value", so the predicate is flipped when the inner input is the right one.
+    indexNestedLoopJoin(outer, inner_right ? left_idx : right_idx, *inner,
+                        inner_right ? flip(predicate.op) : predicate.op, inner_right, writer, step);
+    break;
+  default:
+    throw std::logic_error("Unsupported join algorithm");
+  }
+}
+
+class JoinOperator::HashTable : public JoinHashTable {
+public:
+  using JoinHashTable::JoinHashTable;
+};
+
+JoinOperator::JoinOperator(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, const JoinPredicate &pred,
+                           JoinAlgorithm algorithm)
+    : left(std::move(left)), right(std::move(right)), pred(pred) {
+  switch (algorithm) {
+  case JoinAlgorithm::AUTO:
+    hash = pred.op == PredicateOp::EQ;
+    break;
+  case JoinAlgorithm::HASH:
+    if (pred.op != PredicateOp::EQ) {
+      throw std::logic_error("Hash join requires an equality predicate");
+    }
+    hash = true;
+    break;
+  case JoinAlgorithm::NESTED_LOOP:
+    hash = false;
+    break;
+  default:
+    throw std::logic_error("Unsupported join algorithm");
+  }
+  const TupleDesc &left_desc = this->left->getTupleDesc(), &right_desc = this->right->getTupleDesc();
+  left_idx = left_desc.index_of(pred.left);
+  right_idx = right_desc.index_of(pred.right);
+  td = joinDesc(left_desc, right_desc, right_idx, pred.op);
+}
+
+JoinOperator::~JoinOperator() = default;
+
+const TupleDesc &JoinOperator::getTupleDesc() const { return td; }
+
+void JoinOperator::open() {
+  if (hash) {
+    std::vector<Tuple> build;
+    right->open();
+    while (auto t = right->next()) {
+      build.push_back(std::move(*t));
+    }
+    right->close();
+    table = std::make_unique<HashTable>(std::move(build), right_idx);
+  }
+  left->open();
+}
+
+std::optional<Tuple> JoinOperator::next() {
+  while (true) {
+    if (hash) {
+      if (match < matches.size()) {
+        return combine(*left_record, *matches[match++]);
+      }
+    } else if (left_record) {
+      const field_t &left_field = left_record->get_field(left_idx);
+      while (auto right_record = right->next()) {
+        if (evaluateCondition(left_field, pred.op, right_record->get_field(right_idx))) {
+          return combine(*left_record, *right_record);
+        }
+      }
+      right->close();
+    }
+    left_record = left->next();
+    if (!left_record) {
+      return std::nullopt;
+    }
+    if (hash) {
+      matches.clear();
+      match = 0;
+      table->probe(left_record->get_field(left_idx), [this](const Tuple &t) { matches.push_back(&t); });
+    } else {
+      right->open();
+    }
+  }
+}
+
+void JoinOperator::close() {
+  if (!hash && left_record) {
+    right->close();
+  }
+  left->close();
+  left_record.reset();
+  matches.clear();
+  match = 0;
+  table.reset();
+}
+
+Tuple JoinOperator::combine(const Tuple &left_record, const Tuple &right_record) const {
+  return combineRecords(left_record, right_record, right_idx, pred.op);
+}
+
+IndexJoinOperator::IndexJoinOperator(std::unique_ptr<Operator> outer, const DbFile &inner, const JoinPredicate &pred,
+                                     const std::optional<Predicate> &inner_filter)
+    : outer(std::move(outer)), inner(inner), pred(pred) {
+  const TupleDesc &outer_desc = this->outer->getTupleDesc(), &inner_desc = inner.getTupleDesc();
+  outer_idx = outer_desc.index_of(pred.left);
+  inner_idx = inner_desc.index_of(pred.right);
+  index = findIndex(inner, inner_idx);
+  if (index == nullptr || outer_desc.type_of(outer_idx) != type_t::INT) {
+    throw std::logic_error("Index join requires an index on the join field of one input");
+  }
+  if (inner_filter) {
+    this->inner_filter.emplace(*inner_filter, inner_desc);
+  }
+  td = joinDesc(outer_desc, inner_desc, inner_idx, pred.op);
+}
+
+const TupleDesc &IndexJoinOperator::getTupleDesc() const { return td; }
+
+void IndexJoinOperator::open() { outer->open(); }
+
+std::optional<Tuple> IndexJoinOperator::next() {
+  while (match == matches.size()) {
+    outer_record = outer->next();
+    if (!outer_record) {
+      return std::nullopt;
+    }
+    matches.clear();
+    match = 0;
+    //The index answers "inner key op' outer value", so the predicate is flipped. NE looks up both sides of the value.
+    int key = std::get<int>(outer_record->get_field(outer_idx));
+    std::vector<PredicateOp> ranges = {flip(pred.op)};
+    if (pred.op == PredicateOp::NE) {
+      ranges = {PredicateOp::LT, PredicateOp::GT};
+    }
+    for (PredicateOp range : ranges) {
+      auto [first, last] = indexRange(*index, range, key);
+      for (auto it = first; it != last; ++it) {
+        Tuple record = *it;
+        if (index != &inner) {
+          size_t page = std::get<int>(record.get_field(1)), slot = std::get<int>(record.get_field(2));
+          record = inner.getTuple({inner, page, slot});
+        }
+        if (!inner_filter || (*inner_filter)(record)) {
+          matches.push_back(std::move(record));
+        }
+      }
+    }
+  }
+  return combineRecords(*outer_record, matches[match++], inner_idx, pred.op);
+}
+
+void IndexJoinOperator::close() {
+  outer->close();
+  outer_record.reset();
+  matches.clear();
+  match = 0;
+}
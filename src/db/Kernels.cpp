@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <db/Kernels.hpp>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DB_KERNELS_AVX2
+#endif
+
+using namespace db;
+
+namespace {
+template <typename T> T load(const uint8_t *p) {
+  T value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+bool supportsAvx2() {
+#ifdef DB_KERNELS_AVX2
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+std::atomic<SimdLevel> &level() {
+  static std::atomic<SimdLevel> level(supportsAvx2() ? SimdLevel::AVX2 : SimdLevel::SCALAR);
+  return level;
+}
+
+//The kernels of each comparison are indexed by the PredicateOp, in the order of its declaration.
+template <typename T> using Select = void (*)(const uint8_t *, size_t, T, uint8_t *);
+
+template <PredicateOp OP, typename T> bool compare(T value, T operand) {
+  switch (OP) {
+  case PredicateOp::EQ:
+    return value == operand;
+  case PredicateOp::NE:
+    return value != operand;
+  case PredicateOp::LT:
+    return value < operand;
+  case PredicateOp::LE:
+    return value <= operand;
+  case PredicateOp::GT:
+    return value > operand;
+  case PredicateOp::GE:
+    return value >= operand;
+  }
+  return false;
+}
+
+//---Scalar kernels
+
+template <typename T, PredicateOp OP> void selectScalar(const uint8_t *values, size_t n, T operand, uint8_t *selected) {
+  for (size_t i = 0; i < n; i++) {
+    selected[i] &= compare<OP>(load<T>(values + i * sizeof(T)), operand);
+  }
+}
+
+template <typename T>
+constexpr std::array<Select<T>, 6> SELECT_SCALAR = {
+    selectScalar<T, PredicateOp::EQ>, selectScalar<T, PredicateOp::NE>, selectScalar<T, PredicateOp::LT>,
+    selectScalar<T, PredicateOp::LE>, selectScalar<T, PredicateOp::GT>, selectScalar<T, PredicateOp::GE>};
+
+size_t countScalar(const uint8_t *selected, size_t n) {
+  size_t count = 0;
+  for (size_t i = 0; i < n; i++) {
+    count += selected[i] != 0;
+  }
+  return count;
+}
+
+void summarizeIntScalar(const uint8_t *values, const uint8_t *selected, size_t n, IntSummary &summary) {
+  for (size_t i = 0; i < n; i++) {
+    if (selected != nullptr && !selected[i]) {
+      continue;
+    }
+    int value = load<int>(values + i * sizeof(int));
+    summary.sum += value;
+    summary.min = std::min(summary.min, value);
+    summary.max = std::max(summary.max, value);
+    summary.count++;
+  }
+}
+
+//Value i is added to lanes[i % 4], n values from a multiple of 4, so that every kernel sums in the same order.
+void summarizeDoubleScalar(const uint8_t *values, const uint8_t *selected, size_t n, double *lanes,
+                           DoubleSummary &summary) {
+  for (size_t i = 0; i < n; i++) {
+    if (selected != nullptr && !selected[i]) {
+      continue;
+    }
+    double value = load<double>(values + i * sizeof(double));
+    lanes[i % 4] += value;
+    summary.min = value < summary.min ? value : summary.min;
+    summary.max = value > summary.max ? value : summary.max;
+    summary.count++;
+  }
+}
+
+#ifdef DB_KERNELS_AVX2
+//---AVX2 kernels: whole vectors first, then the remaining values with the scalar kernels.
+
+//The 8 flag bytes of a selection that keep the flags whose bit is set in a comparison mask, for every mask.
+constexpr std::array<uint64_t, 256> EXPAND = [] {
+  std::array<uint64_t, 256> expand{};
+  for (size_t bits = 0; bits < 256; bits++) {
+    for (size_t i = 0; i < 8; i++) {
+      if (bits & (1 << i)) {
+        expand[bits] |= uint64_t{0xFF} << (8 * i);
+      }
+    }
+  }
+  return expand;
+}();
+
+void keep(uint8_t *selected, unsigned bits) {
+  uint64_t flags = load<uint64_t>(selected) & EXPAND[bits];
+  std::memcpy(selected, &flags, sizeof(flags));
+}
+
+template <PredicateOp OP>
+__attribute__((target("avx2"))) void selectIntAvx2(const uint8_t *values, size_t n, int operand, uint8_t *selected) {
+  const __m256i x = _mm256_set1_epi32(operand);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i * sizeof(int)));
+    //AVX2 only compares for equality and greater than, the other comparisons swap the operands or negate the result.
+    __m256i mask;
+    if constexpr (OP == PredicateOp::EQ || OP == PredicateOp::NE) {
+      mask = _mm256_cmpeq_epi32(v, x);
+    } else if constexpr (OP == PredicateOp::LT || OP == PredicateOp::GE) {
+      mask = _mm256_cmpgt_epi32(x, v);
+    } else {
+      mask = _mm256_cmpgt_epi32(v, x);
+    }
+    unsigned bits = _mm256_movemask_ps(_mm256_castsi256_ps(mask));
+    if constexpr (OP == PredicateOp::NE || OP == PredicateOp::LE || OP == PredicateOp::GE) {
+      bits ^= 0xFF;
+    }
+    keep(selected + i, bits);
+  }
+  selectScalar<int, OP>(values + i * sizeof(int), n - i, operand, selected + i);
+}
+
+template <PredicateOp OP>
+__attribute__((target("avx2"))) void selectDoubleAvx2(const uint8_t *values, size_t n, double operand,
+                                                      uint8_t *selected) {
+  //The ordered predicates are false for NaN and the unordered NE is true, like the C++ operators.
+  constexpr int CMP = OP == PredicateOp::EQ   ? _CMP_EQ_OQ
+                      : OP == PredicateOp::NE ? _CMP_NEQ_UQ
+                      : OP == PredicateOp::LT ? _CMP_LT_OQ
+                      : OP == PredicateOp::LE ? _CMP_LE_OQ
+                      : OP == PredicateOp::GT ? _CMP_GT_OQ
+                                              : _CMP_GE_OQ;
+  const __m256d x = _mm256_set1_pd(operand);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    const auto *data = reinterpret_cast<const double *>(values + i * sizeof(double));
+    unsigned low = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(data), x, CMP));
+    unsigned high = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(data + 4), x, CMP));
+    keep(selected + i, low | high << 4);
+  }
+  selectScalar<double, OP>(values + i * sizeof(double), n - i, operand, selected + i);
+}
+
+constexpr std::array<Select<int>, 6> SELECT_INT_AVX2 = {
+    selectIntAvx2<PredicateOp::EQ>, selectIntAvx2<PredicateOp::NE>, selectIntAvx2<PredicateOp::LT>,
+    selectIntAvx2<PredicateOp::LE>, selectIntAvx2<PredicateOp::GT>, selectIntAvx2<PredicateOp::GE>};
+
+constexpr std::array<Select<double>, 6> SELECT_DOUBLE_AVX2 = {
+    selectDoubleAvx2<PredicateOp::EQ>, selectDoubleAvx2<PredicateOp::NE>, selectDoubleAvx2<PredicateOp::LT>,
+    selectDoubleAvx2<PredicateOp::LE>, selectDoubleAvx2<PredicateOp::GT>, selectDoubleAvx2<PredicateOp::GE>};
+
+__attribute__((target("avx2"))) size_t countAvx2(const uint8_t *selected, size_t n) {
+  const __m256i zero = _mm256_setzero_si256();
+  size_t count = 0, i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i flags = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(selected + i));
+    count += 32 - std::popcount(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(flags, zero))));
+  }
+  return count + countScalar(selected + i, n - i);
+}
+
+//The lanes of the 8 values whose flags start at selected that are selected.
+__attribute__((target("avx2"))) __m256i selectionMask(const uint8_t *selected) {
+  __m128i flags = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(selected));
+  return _mm256_cmpgt_epi32(_mm256_cvtepu8_epi32(flags), _mm256_setzero_si256());
+}
+
+__attribute__((target("avx2"))) IntSummary summarizeIntAvx2(const uint8_t *values, const uint8_t *selected, size_t n) {
+  const __m256i lowest = _mm256_set1_epi32(std::numeric_limits<int>::min());
+  const __m256i highest = _mm256_set1_epi32(std::numeric_limits<int>::max());
+  //The values are widened to 64 bits before they are summed, so the sum cannot overflow.
+  __m256i sum_low = _mm256_setzero_si256(), sum_high = _mm256_setzero_si256();
+  __m256i min = highest, max = lowest;
+  size_t count = 0, i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i * sizeof(int)));
+    if (selected != nullptr) {
+      __m256i mask = selectionMask(selected + i);
+      count += std::popcount(static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(mask))));
+      min = _mm256_min_epi32(min, _mm256_blendv_epi8(highest, v, mask));
+      max = _mm256_max_epi32(max, _mm256_blendv_epi8(lowest, v, mask));
+      v = _mm256_and_si256(v, mask);
+    } else {
+      count += 8;
+      min = _mm256_min_epi32(min, v);
+      max = _mm256_max_epi32(max, v);
+    }
+    sum_low = _mm256_add_epi64(sum_low, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(v)));
+    sum_high = _mm256_add_epi64(sum_high, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(v, 1)));
+  }
+  alignas(32) int64_t sums[4];
+  alignas(32) int mins[8], maxs[8];
+  _mm256_store_si256(reinterpret_cast<__m256i *>(sums), _mm256_add_epi64(sum_low, sum_high));
+  _mm256_store_si256(reinterpret_cast<__m256i *>(mins), min);
+  _mm256_store_si256(reinterpret_cast<__m256i *>(maxs), max);
+  IntSummary summary;
+  summary.count = count;
+  for (size_t lane = 0; lane < 8; lane++) {
+    summary.min = std::min(summary.min, mins[lane]);
+    summary.max = std::max(summary.max, maxs[lane]);
+  }
+  summary.sum = sums[0] + sums[1] + sums[2] + sums[3];
+  summarizeIntScalar(values + i * sizeof(int), selected != nullptr ? selected + i : nullptr, n - i, summary);
+  return summary;
+}
+
+__attribute__((target("avx2"))) void summarizeDoubleAvx2(const uint8_t *values, const uint8_t *selected, size_t n,
+                                                         double *lanes, DoubleSummary &summary) {
+  const __m256d lowest = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+  const __m256d highest = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+  __m256d sum = _mm256_setzero_pd(), min = highest, max = lowest;
+  size_t count = 0, i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d v = _mm256_loadu_pd(reinterpret_cast<const double *>(values + i * sizeof(double)));
+    if (selected != nullptr) {
+      __m128i flags = _mm_cvtsi32_si128(load<int>(selected + i));
+      __m256d mask =
+          _mm256_castsi256_pd(_mm256_cmpgt_epi64(_mm256_cvtepu8_epi64(flags), _mm256_setzero_si256()));
+      count += std::popcount(static_cast<uint32_t>(_mm256_movemask_pd(mask)));
+      //The value is the first operand, so that it is only kept when it compares lower (or higher), as in the scalar
+      //kernel.
+      min = _mm256_min_pd(_mm256_blendv_pd(highest, v, mask), min);
+      max = _mm256_max_pd(_mm256_blendv_pd(lowest, v, mask), max);
+      v = _mm256_and_pd(v, mask);
+    } else {
+      count += 4;
+      min = _mm256_min_pd(v, min);
+      max = _mm256_max_pd(v, max);
+    }
+    sum = _mm256_add_pd(sum, v);
+  }
+  alignas(32) double mins[4], maxs[4];
+  _mm256_storeu_pd(lanes, sum);
+  _mm256_store_pd(mins, min);
+  _mm256_store_pd(maxs, max);
+  summary.count = count;
+  for (size_t lane = 0; lane < 4; lane++) {
+    summary.min = mins[lane] < summary.min ? mins[lane] : summary.min;
+    summary.max = maxs[lane] > summary.max ? maxs[lane] : summary.max;
+  }
+  summarizeDoubleScalar(values + i * sizeof(double), selected != nullptr ? selected + i : nullptr, n - i, lanes,
+                        summary);
+}
+#endif
+} // namespace
+
+SimdLevel db::getSimdLevel() { return level().load(std::memory_order_relaxed); }
+
+void db::setSimdLevel(SimdLevel simd) {
+  if (simd == SimdLevel::AVX2 && !supportsAvx2()) {
+    throw std::logic_error("AVX2 is not supported by the processor");
+  }
+  level().store(simd, std::memory_order_relaxed);
+}
+
+void db::selectInt(const uint8_t *values, size_t n, PredicateOp op, int operand, uint8_t *selected) {
+#ifdef DB_KERNELS_AVX2
+  if (getSimdLevel() == SimdLevel::AVX2) {
+    SELECT_INT_AVX2[static_cast<size_t>(op)](values, n, operand, selected);
+    return;
+  }
+#endif
+  SELECT_SCALAR<int>[static_cast<size_t>(op)](values, n, operand, selected);
+}
+
+void db::selectDouble(const uint8_t *values, size_t n, PredicateOp op, double operand, uint8_t *selected) {
+#ifdef DB_KERNELS_AVX2
+  if (getSimdLevel() == SimdLevel::AVX2) {
+    SELECT_DOUBLE_AVX2[static_cast<size_t>(op)](values, n, operand, selected);
+    return;
+  }
+#endif
+  SELECT_SCALAR<double>[static_cast<size_t>(op)](values, n, operand, selected);
+}
+
+bool db::selectValues(type_t type, const uint8_t *values, size_t n, PredicateOp op, const field_t &operand,
+                      uint8_t *selected) {
+  if (type == type_t::INT && std::holds_alternative<int>(operand)) {
+    selectInt(values, n, op, std::get<int>(operand), selected);
+    return true;
+  }
+  if (type == type_t::DOUBLE && std::holds_alternative<double>(operand)) {
+    selectDouble(values, n, op, std::get<double>(operand), selected);
+    return true;
+  }
+  return false;
+}
+
+size_t db::countSelected(const uint8_t *selected, size_t n) {
+#ifdef DB_KERNELS_AVX2
+  if (getSimdLevel() == SimdLevel::AVX2) {
+    return countAvx2(selected, n);
+  }
+#endif
+  return countScalar(selected, n);
+}
+
+IntSummary db::summarizeInt(const uint8_t *values, const uint8_t *selected, size_t n) {
+#ifdef DB_KERNELS_AVX2
+  if (getSimdLevel() == SimdLevel::AVX2) {
+    return summarizeIntAvx2(values, selected, n);
+  }
+#endif
+  IntSummary summary;
+  summarizeIntScalar(values, selected, n, summary);
+  return summary;
+}
+
+DoubleSummary db::summarizeDouble(const uint8_t *values, const uint8_t *selected, size_t n) {
+  DoubleSummary summary;
+  double lanes[4] = {0, 0, 0, 0};
+#ifdef DB_KERNELS_AVX2
+  if (getSimdLevel() == SimdLevel::AVX2) {
+    summarizeDoubleAvx2(values, selected, n, lanes, summary);
+  } else {
+    summarizeDoubleScalar(values, selected, n, lanes, summary);
+  }
+#else
+  summarizeDoubleScalar(values, selected, n, lanes, summary);
+#endif
+  summary.sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+  return summary;
+}
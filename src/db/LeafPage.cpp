@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstring>
 #include <db/LeafPage.hpp>
 #include <stdexcept>
 
@@ -6,11 +8,12 @@ using namespace db;
 struct Iterator {
   using iterator_category = std::contiguous_iterator_tag;
   using difference_type = uint16_t;
-  using value_type = int;
-  using reference = int &;
+  using value_type = Key;
+  using reference = Key &;
 
   const uint8_t *data;
   size_t width;
+  size_t key_width;
   uint16_t slot;
 
   void operator++() { ++slot; }
@@ -19,39 +22,76 @@ struct Iterator {
   void operator-=(uint16_t n) { slot -= n; }
   uint16_t operator-(const Iterator &other) const { return slot - other.slot; }
 
-  int operator*() const { return *reinterpret_cast<const int *>(data + slot * width); }
+  // The fields of a key are consecutive INTs
+  Key operator*() const {
+    Key key{};
+    std::memcpy(key.data(), data + slot * width, key_width * INT_SIZE);
+    return key;
+  }
 };
 
-LeafPage::LeafPage(Page &page, const TupleDesc &td, size_t key_index) : td(td), key_index(key_index) {
+Key db::keyOf(const Tuple &t, size_t key_index, size_t key_width) {
+  Key key{};
+  for (size_t i = 0; i < key_width; i++) {
+    key[i] = std::get<int>(t.get_field(key_index + i));
+  }
+  return key;
+}
+
+LeafPage::LeafPage(Page &page, const TupleDesc &td, size_t key_index, size_t key_width)
+    : td(td), key_index(key_index), key_width(key_width) {
   header = reinterpret_cast<LeafPageHeader *>(page.data());
   capacity = (DEFAULT_PAGE_SIZE - sizeof(LeafPageHeader)) / td.length();
   data = page.data() + DEFAULT_PAGE_SIZE - td.length() * capacity;
 }
 
 bool LeafPage::insertTuple(const Tuple &t) {
-  int key = std::get<int>(t.get_field(key_index));
-
-  const auto first = data + td.offset_of(key_index);
+  auto slot = upperBound(keyOf(t, key_index, key_width));
   const auto width = td.length();
-  const auto last = first + header->size * width;
-  auto it = std::lower_bound(Iterator{first, width, 0}, Iterator{last, width, header->size}, key);
-
-  auto slot = it.slot;
-  if (slot >= header->size || key != *it) {
-    std::copy_backward(data + slot * width, data + header->size * width, data + (header->size + 1) * width);
-    ++header->size;
-  }
+  std::copy_backward(data + slot * width, data + header->size * width, data + (header->size + 1) * width);
+  ++header->size;
   td.serialize(data + slot * td.length(), t);
   return header->size == capacity;
 }
 
-int LeafPage::split(LeafPage &new_page) {
+void LeafPage::deleteTuple(size_t slot) {
+  if (slot >= header->size) {
+    throw std::out_of_range("slot out of range");
+  }
+  const auto width = td.length();
+  std::copy(data + (slot + 1) * width, data + header->size * width, data + slot * width);
+  --header->size;
+}
+
+Key LeafPage::split(LeafPage &new_page) {
   size_t half = header->size / 2;
   new_page.header->size = header->size - half;
   new_page.header->next_leaf = header->next_leaf;
   std::copy(data + half * td.length(), data + header->size * td.length(), new_page.data);
   header->size = half;
-  return std::get<int>(td.deserialize(new_page.data).get_field(key_index));
+  return new_page.getFullKey(0);
+}
+
+int LeafPage::getKey(size_t slot) const {
+  return *reinterpret_cast<const int *>(data + slot * td.length() + td.offset_of(key_index));
+}
+
+Key LeafPage::getFullKey(size_t slot) const {
+  return *Iterator{data + td.offset_of(key_index), td.length(), key_width, static_cast<uint16_t>(slot)};
+}
+
+size_t LeafPage::lowerBound(const Key &key) const {
+  const auto first = data + td.offset_of(key_index);
+  const auto width = td.length();
+  return std::lower_bound(Iterator{first, width, key_width, 0}, Iterator{first, width, key_width, header->size}, key)
+      .slot;
+}
+
+size_t LeafPage::upperBound(const Key &key) const {
+  const auto first = data + td.offset_of(key_index);
+  const auto width = td.length();
+  return std::upper_bound(Iterator{first, width, key_width, 0}, Iterator{first, width, key_width, header->size}, key)
+      .slot;
 }
 
 Tuple LeafPage::getTuple(size_t slot) const {
@@ -60,3 +100,10 @@ Tuple LeafPage::getTuple(size_t slot) const {
   }
   return td.deserialize(data + slot * td.length());
 }
+
+Tuple LeafPage::getTuple(size_t slot, const std::vector<size_t> &fields) const {
+  if (slot >= header->size) {
+    throw std::out_of_range("slot out of range");
+  }
+  return td.deserialize(data + slot * td.length(), fields);
+}
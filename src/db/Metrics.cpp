@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <bit>
+#include <db/Metrics.hpp>
+
+using namespace db;
+
+Metrics &db::getMetrics() {
+  static Metrics metrics;
+  return metrics;
+}
+
+double LatencyHistogram::Snapshot::mean() const { return count == 0 ? 0 : double(total_ns) / count; }
+
+uint64_t LatencyHistogram::Snapshot::percentile(double p) const {
+  if (count == 0) {
+    return 0;
+  }
+  //The rank of the percentile, counted from 1.
+  auto rank = std::max<uint64_t>(1, uint64_t(std::clamp(p, 0.0, 100.0) / 100 * count + 0.5));
+  uint64_t seen = 0;
+  for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+    seen += buckets[b];
+    if (seen >= rank) {
+      return b == 0 ? 0 : (uint64_t{1} << b) - 1;
+    }
+  }
+  return UINT64_MAX;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+  size_t bucket = std::min<size_t>(std::bit_width(ns), HISTOGRAM_BUCKETS - 1);
+  buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  total_ns.fetch_add(ns, std::memory_order_relaxed);
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+  Snapshot result;
+  for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+    result.buckets[b] = buckets[b].load(std::memory_order_relaxed);
+    result.count += result.buckets[b];
+  }
+  result.total_ns = total_ns.load(std::memory_order_relaxed);
+  return result;
+}
+
+FileMetrics::FileMetrics(FileMetrics *total) : total(total) {}
+
+void FileMetrics::recordRead(uint64_t ns) {
+  read_latency.record(ns);
+  reads.fetch_add(1, std::memory_order_relaxed);
+  if (total != nullptr) {
+    total->recordRead(ns);
+  }
+}
+
+void FileMetrics::recordWrite(uint64_t ns) {
+  write_latency.record(ns);
+  writes.fetch_add(1, std::memory_order_relaxed);
+  if (total != nullptr) {
+    total->recordWrite(ns);
+  }
+}
+
+FileMetrics::Snapshot FileMetrics::snapshot() const {
+  return {reads.load(std::memory_order_relaxed), writes.load(std::memory_order_relaxed), read_latency.snapshot(),
+          write_latency.snapshot()};
+}
+
+PoolMetrics::Snapshot PoolMetrics::snapshot() const {
+  return {hits.load(std::memory_order_relaxed),      misses.load(std::memory_order_relaxed),
+          evictions.load(std::memory_order_relaxed), flushes.load(std::memory_order_relaxed),
+          miss_latency.snapshot(),                   flush_latency.snapshot()};
+}
+
+PageTrace::PageTrace(size_t capacity) { reset(capacity); }
+
+void PageTrace::reset(size_t new_capacity) {
+  capacity = new_capacity;
+  ids.clear();
+  slots = capacity == FULL_TRACE ? nullptr : std::make_unique<std::atomic<size_t>[]>(capacity);
+  total.store(0, std::memory_order_relaxed);
+}
+
+void PageTrace::record(size_t id) {
+  if (capacity == FULL_TRACE) {
+    std::lock_guard lock(mutex);
+    ids.push_back(id);
+  } else if (capacity > 0) {
+    slots[total.fetch_add(1, std::memory_order_relaxed) % capacity].store(id, std::memory_order_relaxed);
+  }
+}
+
+std::vector<size_t> PageTrace::get() const {
+  if (capacity == FULL_TRACE) {
+    std::lock_guard lock(mutex);
+    return ids;
+  }
+  size_t end = total.load(std::memory_order_relaxed);
+  size_t begin = end - std::min(end, capacity);
+  std::vector<size_t> last;
+  last.reserve(end - begin);
+  for (size_t i = begin; i < end; i++) {
+    last.push_back(slots[i % capacity].load(std::memory_order_relaxed));
+  }
+  return last;
+}
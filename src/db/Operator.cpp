@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <db/BTreeFile.hpp>
+#include <db/Operator.hpp>
+#include <stdexcept>
+
+using namespace db;
+
+//The indexes of the named fields of a schema.
+static std::vector<size_t> indexesOf(const TupleDesc &td, const std::vector<std::string> &field_names) {
+  std::vector<size_t> fields;
+  for (const auto &name : field_names) {
+    fields.push_back(td.index_of(name));
+  }
+  return fields;
+}
+
+ScanOperator::ScanOperator(const DbFile &file) : file(file), td(file.getTupleDesc()) {}
+
+ScanOperator::ScanOperator(const DbFile &file, const std::vector<std::string> &field_names)
+    : file(file), fields(indexesOf(file.getTupleDesc(), field_names)), td(file.getTupleDesc().project(*fields)) {}
+
+const TupleDesc &ScanOperator::getTupleDesc() const { return td; }
+
+void ScanOperator::open() { it.emplace(fields ? file.begin(*fields) : file.begin()); }
+
+std::optional<Tuple> ScanOperator::next() {
+  if (*it == file.end()) {
+    return std::nullopt;
+  }
+  Tuple t = **it;
+  ++*it;
+  return t;
+}
+
+void ScanOperator::close() { it.reset(); }
+
+IndexScanOperator::IndexScanOperator(const DbFile &file, const FilterPredicate &pred)
+    : file(file), index(findIndex(file, file.getTupleDesc().index_of(pred.field_name))), pred(pred),
+      td(file.getTupleDesc()) {
+  if (index == nullptr) {
+    throw std::logic_error("Index scan requires an index on the field");
+  }
+  if (pred.op == PredicateOp::NE || !std::holds_alternative<int>(pred.value)) {
+    throw std::logic_error("Predicate cannot use an index");
+  }
+}
+
+IndexScanOperator::IndexScanOperator(const DbFile &file, const FilterPredicate &pred,
+                                     const std::vector<std::string> &field_names)
+    : IndexScanOperator(file, pred) {
+  fields = indexesOf(file.getTupleDesc(), field_names);
+  td = file.getTupleDesc().project(*fields);
+}
+
+const TupleDesc &IndexScanOperator::getTupleDesc() const { return td; }
+
+void IndexScanOperator::open() {
+  auto [first, end] = indexRange(*index, pred.op, std::get<int>(pred.value));
+  if (index == &file) {
+    it.emplace(first);
+    last.emplace(end);
+    it->fields = fields ? &*fields : nullptr;
+    return;
+  }
+  locations.clear();
+  for (auto entry = first; entry != end; ++entry) {
+    Tuple t = *entry;
+    locations.emplace_back(std::get<int>(t.get_field(1)), std::get<int>(t.get_field(2)));
+  }
+  std::sort(locations.begin(), locations.end());
+  pos = 0;
+}
+
+std::optional<Tuple> IndexScanOperator::next() {
+  if (index == &file) {
+    if (*it == *last) {
+      return std::nullopt;
+    }
+    Tuple t = **it;
+    ++*it;
+    return t;
+  }
+  if (pos == locations.size()) {
+    return std::nullopt;
+  }
+  auto [page, slot] = locations[pos++];
+  return fields ? file.getTuple({file, page, slot}, *fields) : file.getTuple({file, page, slot});
+}
+
+void IndexScanOperator::close() {
+  it.reset();
+  last.reset();
+  locations.clear();
+  pos = 0;
+}
+
+FilterOperator::FilterOperator(std::unique_ptr<Operator> child, const Predicate &pred)
+    : child(std::move(child)), predicate(pred, this->child->getTupleDesc()) {}
+
+FilterOperator::FilterOperator(std::unique_ptr<Operator> child, const std::vector<FilterPredicate> &pred)
+    : FilterOperator(std::move(child), Predicate::all({pred.begin(), pred.end()})) {}
+
+FilterOperator::FilterOperator(std::unique_ptr<Operator> child, std::initializer_list<FilterPredicate> pred)
+    : FilterOperator(std::move(child), Predicate::all({pred.begin(), pred.end()})) {}
+
+const TupleDesc &FilterOperator::getTupleDesc() const { return child->getTupleDesc(); }
+
+void FilterOperator::open() { child->open(); }
+
+std::optional<Tuple> FilterOperator::next() {
+  while (auto t = child->next()) {
+    if (predicate(*t)) {
+      return t;
+    }
+  }
+  return std::nullopt;
+}
+
+void FilterOperator::close() { child->close(); }
+
+ProjectOperator::ProjectOperator(std::unique_ptr<Operator> child, const std::vector<std::string> &field_names)
+    : child(std::move(child)) {
+  const TupleDesc &child_td = this->child->getTupleDesc();
+  std::vector<type_t> types;
+  for (const auto &name : field_names) {
+    fields.push_back(child_td.index_of(name));
+    types.push_back(child_td.type_of(fields.back()));
+  }
+  td = TupleDesc(types, field_names);
+}
+
+const TupleDesc &ProjectOperator::getTupleDesc() const { return td; }
+
+void ProjectOperator::open() { child->open(); }
+
+std::optional<Tuple> ProjectOperator::next() {
+  auto t = child->next();
+  if (!t) {
+    return std::nullopt;
+  }
+  std::vector<field_t> projected_fields;
+  projected_fields.reserve(fields.size());
+  for (size_t idx : fields) {
+    projected_fields.push_back(t->get_field(idx));
+  }
+  return Tuple(projected_fields);
+}
+
+void ProjectOperator::close() { child->close(); }
+
+SortOperator::SortOperator(std::unique_ptr<Operator> child, const std::vector<SortKey> &keys, size_t memory_pages)
+    : child(std::move(child)), memory_pages(memory_pages) {
+  const TupleDesc &child_td = this->child->getTupleDesc();
+  for (const auto &key : keys) {
+    order.emplace_back(child_td.index_of(key.field), key.descending);
+  }
+}
+
+const TupleDesc &SortOperator::getTupleDesc() const { return child->getTupleDesc(); }
+
+void SortOperator::open() {
+  sorter = std::make_unique<ExternalSort>(child->getTupleDesc(), ExternalSort::byFields(order), memory_pages);
+  child->open();
+  while (auto t = child->next()) {
+    sorter->add(*t);
+  }
+  child->close();
+  sorter->finish();
+}
+
+std::optional<Tuple> SortOperator::next() { return sorter->next(); }
+
+void SortOperator::close() { sorter.reset(); }
+
+TopKOperator::TopKOperator(std::unique_ptr<Operator> child, const std::vector<SortKey> &keys, size_t k)
+    : child(std::move(child)), k(k) {
+  const TupleDesc &child_td = this->child->getTupleDesc();
+  for (const auto &key : keys) {
+    order.emplace_back(child_td.index_of(key.field), key.descending);
+  }
+}
+
+const TupleDesc &TopKOperator::getTupleDesc() const { return child->getTupleDesc(); }
+
+void TopKOperator::open() {
+  TopKHeap heap(ExternalSort::byFields(order), k);
+  child->open();
+  while (auto t = child->next()) {
+    heap.add(*t);
+  }
+  child->close();
+  results = heap.finish();
+  pos = 0;
+}
+
+std::optional<Tuple> TopKOperator::next() {
+  if (pos == results.size()) {
+    return std::nullopt;
+  }
+  return results[pos++];
+}
+
+void TopKOperator::close() {
+  results.clear();
+  pos = 0;
+}
+
+void db::materialize(Operator &op, DbFile &out) {
+  op.open();
+  while (auto t = op.next()) {
+    out.insertTuple(*t);
+  }
+  op.close();
+}
@@ -0,0 +1,595 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <db/BTreeFile.hpp>
+#include <db/BufferPool.hpp>
+#include <db/Database.hpp>
+#include <db/HashAggregator.hpp>
+#include <db/Planner.hpp>
+#include <db/Profile.hpp>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace db;
+
+std::string PlanNode::toString() const {
+  std::ostringstream out;
+  auto print = [&](auto &self, const PlanNode &node, size_t depth) -> void {
+    out << std::string(2 * depth, ' ') << node.description << "  rows=" << std::llround(node.rows)
+        << " cost=" << std::llround(node.cost);
+    if (node.profile) {
+      out << "  actual " << node.profile->describe();
+    }
+    out << '\n';
+    for (const auto &child : node.children) {
+      self(self, child, depth + 1);
+    }
+  };
+  print(print, *this, 0);
+  return out.str();
+}
+
+std::string PlanNode::toJson() const {
+  std::ostringstream out;
+  out << "{\"step\": " << jsonString(description) << ", \"rows\": " << rows << ", \"cost\": " << cost;
+  if (profile) {
+    out << ", \"actual\": " << profile->toJson(false);
+  }
+  out << ", \"inputs\": [";
+  for (size_t i = 0; i < children.size(); i++) {
+    out << (i == 0 ? "" : ", ") << children[i].toJson();
+  }
+  out << "]}";
+  return out.str();
+}
+
+namespace {
+std::optional<size_t> fieldIndex(const TupleDesc &td, const std::string &name) {
+  for (size_t i = 0; i < td.size(); i++) {
+    if (td.name_of(i) == name) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+double defaultSelectivity(PredicateOp op) {
+  switch (op) {
+  case PredicateOp::EQ:
+    return DEFAULT_EQ_SELECTIVITY;
+  case PredicateOp::NE:
+    return 1 - DEFAULT_EQ_SELECTIVITY;
+  default:
+    return DEFAULT_RANGE_SELECTIVITY;
+  }
+}
+
+double defaultSelectivity(const Predicate &pred) {
+  double result = 1;
+  switch (pred.getKind()) {
+  case Predicate::Kind::COMPARE:
+    return defaultSelectivity(pred.getOp());
+  case Predicate::Kind::IN:
+    return std::min(1.0, DEFAULT_EQ_SELECTIVITY * pred.getValues().size());
+  case Predicate::Kind::AND:
+    for (const auto &child : pred.getChildren()) {
+      result *= defaultSelectivity(child);
+    }
+    return result;
+  case Predicate::Kind::OR:
+    for (const auto &child : pred.getChildren()) {
+      result *= 1 - defaultSelectivity(child);
+    }
+    return 1 - result;
+  case Predicate::Kind::NOT:
+    return 1 - defaultSelectivity(pred.getChildren()[0]);
+  }
+  throw std::logic_error("Unknown predicate");
+}
+
+//The comparison that holds between b and a whenever "a op b" holds.
+PredicateOp flip(PredicateOp op) {
+  switch (op) {
+  case PredicateOp::LT:
+    return PredicateOp::GT;
+  case PredicateOp::LE:
+    return PredicateOp::GE;
+  case PredicateOp::GT:
+    return PredicateOp::LT;
+  case PredicateOp::GE:
+    return PredicateOp::LE;
+  default:
+    return op;
+  }
+}
+
+const char *toString(PredicateOp op) {
+  switch (op) {
+  case PredicateOp::EQ:
+    return "=";
+  case PredicateOp::NE:
+    return "!=";
+  case PredicateOp::LT:
+    return "<";
+  case PredicateOp::LE:
+    return "<=";
+  case PredicateOp::GT:
+    return ">";
+  case PredicateOp::GE:
+    return ">=";
+  }
+  throw std::logic_error("Unknown predicate operation");
+}
+
+std::string toString(const field_t &value) {
+  std::ostringstream out;
+  std::visit([&](const auto &v) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::string>) {
+      out << '\'' << v << '\'';
+    } else {
+      out << v;
+    }
+  }, value);
+  return out.str();
+}
+
+std::string toString(const Predicate &pred) {
+  std::string result;
+  const auto &children = pred.getChildren();
+  switch (pred.getKind()) {
+  case Predicate::Kind::COMPARE:
+    return pred.getField() + " " + toString(pred.getOp()) + " " + toString(pred.getValues()[0]);
+  case Predicate::Kind::IN:
+    for (const auto &value : pred.getValues()) {
+      result += (result.empty() ? "" : ", ") + toString(value);
+    }
+    return pred.getField() + " IN (" + result + ")";
+  case Predicate::Kind::AND:
+  case Predicate::Kind::OR:
+    if (children.empty()) {
+      return pred.getKind() == Predicate::Kind::AND ? "TRUE" : "FALSE";
+    }
+    for (const auto &child : children) {
+      result += (result.empty() ? "" : pred.getKind() == Predicate::Kind::AND ? " AND " : " OR ") + toString(child);
+    }
+    return children.size() == 1 ? result : "(" + result + ")";
+  case Predicate::Kind::NOT:
+    return "NOT " + toString(children[0]);
+  }
+  throw std::logic_error("Unknown predicate");
+}
+
+std::string toString(const JoinPredicate &pred) {
+  return pred.left + " " + toString(pred.op) + " " + pred.right;
+}
+
+//A table of the query with its estimates and the access path chosen for it.
+struct Table {
+  std::string name;
+  const DbFile *file;
+  const TableStats *stats;
+  double rows;
+  std::optional<Predicate> filter;
+  /// The fraction of the rows that satisfy the filter
+  double selectivity = 1;
+  /// The comparison looked up in an index, if an index scan is cheaper than a full scan
+  std::optional<FilterPredicate> index_scan;
+  double index_rows = 0;
+  double cost;
+
+  double selectivityOf(const Predicate &pred) const {
+    return stats ? stats->selectivity(file->getTupleDesc(), pred) : defaultSelectivity(pred);
+  }
+
+  //The number of distinct values of a field among the rows that satisfy the filter.
+  double distinct(size_t field) const {
+    double values = stats ? stats->columns[field].distinct : rows;
+    return std::max(1.0, std::min(values, rows * selectivity));
+  }
+};
+
+enum class Method { SCAN, HASH_JOIN, NESTED_LOOP_JOIN, INDEX_JOIN };
+
+//The best plan found for a set of tables, given as a bit mask. A join combines the plans of two disjoint sets.
+struct SubPlan {
+  Method method = Method::SCAN;
+  double rows = 0;
+  double cost = std::numeric_limits<double>::infinity();
+  /// The sum of the tuple lengths of the tables
+  double width = 0;
+  uint32_t left = 0, right = 0;
+  /// The join predicate, with its left field in the left set
+  JoinPredicate join;
+};
+
+class Planner {
+  const QuerySpec &query;
+  size_t memory_pages;
+  bool profile;
+  std::vector<Table> tables;
+  /// The table of every field name
+  std::unordered_map<std::string, size_t> owner;
+  std::vector<SubPlan> best;
+  /// The fields dropped by equality joins, and the field they were equal to
+  std::unordered_map<std::string, std::string> replaced;
+  /// The fields the query refers to, or nothing if its output has every field
+  std::optional<std::unordered_set<std::string>> used;
+
+  size_t tableOf(const std::string &field) const {
+    auto it = owner.find(field);
+    if (it == owner.end()) {
+      throw std::logic_error("Unknown field " + field);
+    }
+    return it->second;
+  }
+
+  size_t indexOf(const std::string &field) const {
+    return *fieldIndex(tables[tableOf(field)].file->getTupleDesc(), field);
+  }
+
+  void chooseAccessPath(Table &table) {
+    const DbFile &file = *table.file;
+    const TupleDesc &td = file.getTupleDesc();
+    table.cost = file.getNumPages();
+    if (!table.filter) {
+      return;
+    }
+    for (const auto &condition : table.filter->conjuncts()) {
+      const BTreeFile *index = findIndex(file, *fieldIndex(td, condition.field_name));
+      if (index == nullptr || condition.op == PredicateOp::NE || !std::holds_alternative<int>(condition.value)) {
+        continue;
+      }
+      //A B+tree reads the leaves of the matching range, a secondary index also reads the page of every match.
+      double selectivity = table.selectivityOf(condition);
+      double cost = indexDepth(*index) + std::ceil(selectivity * index->getNumPages());
+      if (index != &file) {
+        cost += std::min<double>(file.getNumPages(), std::ceil(selectivity * table.rows));
+      }
+      if (cost < table.cost) {
+        table.cost = cost;
+        table.index_scan = condition;
+        table.index_rows = selectivity * table.rows;
+      }
+    }
+  }
+
+  double joinSelectivity(const JoinPredicate &pred) const {
+    const Table &left = tables[tableOf(pred.left)], &right = tables[tableOf(pred.right)];
+    double distinct = std::max(left.distinct(indexOf(pred.left)), right.distinct(indexOf(pred.right)));
+    switch (pred.op) {
+    case PredicateOp::EQ:
+      return 1 / distinct;
+    case PredicateOp::NE:
+      return 1 - 1 / distinct;
+    default:
+      return DEFAULT_RANGE_SELECTIVITY;
+    }
+  }
+
+  //The join predicate between two sets of tables, with its left field in the left set.
+  std::optional<JoinPredicate> connect(uint32_t left, uint32_t right) const {
+    for (const auto &pred : query.joins) {
+      uint32_t l = 1u << tableOf(pred.left), r = 1u << tableOf(pred.right);
+      if ((l & left) && (r & right)) {
+        return pred;
+      }
+      if ((r & left) && (l & right)) {
+        return JoinPredicate{pred.right, flip(pred.op), pred.left};
+      }
+    }
+    return std::nullopt;
+  }
+
+  void consider(SubPlan &plan, SubPlan candidate) {
+    if (candidate.cost < plan.cost) {
+      plan = candidate;
+    }
+  }
+
+  void enumerate() {
+    size_t n = tables.size();
+    best.assign(size_t{1} << n, {});
+    for (size_t i = 0; i < n; i++) {
+      const Table &table = tables[i];
+      best[1u << i] = {.method = Method::SCAN,
+                       .rows = table.rows * table.selectivity,
+                       .cost = table.cost,
+                       .width = double(table.file->getTupleDesc().length()),
+                       .left = 0,
+                       .right = 0,
+                       .join = {}};
+    }
+    //A set is only enumerated after its subsets, which are smaller numbers.
+    for (uint32_t set = 1; set < best.size(); set++) {
+      if (std::popcount(set) < 2) {
+        continue;
+      }
+      for (uint32_t left = (set - 1) & set; left > 0; left = (left - 1) & set) {
+        uint32_t right = set ^ left;
+        const SubPlan &outer = best[left], &inner = best[right];
+        std::optional<JoinPredicate> pred;
+        if (std::isinf(outer.cost) || std::isinf(inner.cost) || !(pred = connect(left, right))) {
+          continue;
+        }
+        SubPlan join{Method::HASH_JOIN, outer.rows * inner.rows * joinSelectivity(*pred), 0, outer.width + inner.width,
+                     left, right, *pred};
+        SubPlan &plan = best[set];
+        //The tuples produced are counted as the pages they would fill, so that the orders with the smallest
+        //intermediate results are preferred among those that read the same pages.
+        double produced = join.rows * join.width / DEFAULT_PAGE_SIZE;
+
+        //Both orders of the inputs read the same pages, the hash table is built on the smaller one.
+        if (pred->op == PredicateOp::EQ && inner.rows <= outer.rows &&
+            inner.rows * inner.width <= double(memory_pages) * DEFAULT_PAGE_SIZE) {
+          join.cost = outer.cost + inner.cost + produced;
+          consider(plan, join);
+        }
+
+        if (std::popcount(right) == 1) {
+          const Table &table = tables[std::countr_zero(right)];
+          const BTreeFile *index = findIndex(*table.file, indexOf(pred->right));
+          const TupleDesc &outer_desc = tables[tableOf(pred->left)].file->getTupleDesc();
+          if (index != nullptr && outer_desc.type_of(indexOf(pred->left)) == type_t::INT) {
+            //Every lookup reads the matches of one key (see indexLookupCost).
+            double matches = table.rows * joinSelectivity(*pred);
+            join.method = Method::INDEX_JOIN;
+            join.cost = outer.cost + outer.rows * indexLookupCost(*table.file, *index, matches) + produced;
+            consider(plan, join);
+          }
+        }
+
+        //A table that fits in the buffer pool is only read from the file once.
+        bool cached = std::popcount(right) == 1 && inner.method == Method::SCAN &&
+                      !tables[std::countr_zero(right)].index_scan &&
+                      tables[std::countr_zero(right)].file->getNumPages() <= DEFAULT_NUM_PAGES;
+        join.method = Method::NESTED_LOOP_JOIN;
+        join.cost = outer.cost + (cached ? 1 : std::max(1.0, outer.rows)) * inner.cost + produced;
+        consider(plan, join);
+      }
+    }
+  }
+
+  //The name of a field in a schema, following the fields dropped by equality joins.
+  std::string resolve(std::string field, const TupleDesc &td) const {
+    while (!fieldIndex(td, field)) {
+      auto it = replaced.find(field);
+      if (it == replaced.end()) {
+        break;
+      }
+      field = it->second;
+    }
+    return field;
+  }
+
+  //Wrap the operator of a step in a ProfileOperator, whose inputs are the profiles of the inputs of the step.
+  std::unique_ptr<Operator> measure(std::unique_ptr<Operator> op, PlanNode &node) const {
+    if (!profile) {
+      return op;
+    }
+    std::vector<std::shared_ptr<const ProfileNode>> inputs;
+    for (const auto &child : node.children) {
+      inputs.push_back(child.profile);
+    }
+    auto result = std::make_unique<ProfileOperator>(std::move(op), node.description, std::move(inputs));
+    node.profile = result->getProfile();
+    return result;
+  }
+
+  std::unique_ptr<Operator> build(uint32_t set, PlanNode &node) {
+    const SubPlan &plan = best[set];
+    node.rows = plan.rows;
+    node.cost = plan.cost;
+    if (plan.method == Method::SCAN) {
+      const Table &table = tables[std::countr_zero(set)];
+      std::unique_ptr<Operator> scan;
+      PlanNode *scan_node = &node;
+      if (table.filter) {
+        node.description = "Filter(" + toString(*table.filter) + ")";
+        scan_node = &node.children.emplace_back();
+      }
+      //Only the fields the query refers to are decoded.
+      const TupleDesc &td = table.file->getTupleDesc();
+      std::vector<std::string> fields;
+      std::string description;
+      for (size_t i = 0; i < td.size(); i++) {
+        if (!used || used->contains(td.name_of(i))) {
+          fields.push_back(td.name_of(i));
+        }
+      }
+      if (fields.size() < td.size()) {
+        for (const auto &field : fields) {
+          description += (description.empty() ? " [" : ", ") + field;
+        }
+        description += "]";
+      }
+      if (table.index_scan) {
+        scan = fields.size() < td.size() ? std::make_unique<IndexScanOperator>(*table.file, *table.index_scan, fields)
+                                         : std::make_unique<IndexScanOperator>(*table.file, *table.index_scan);
+        *scan_node = {.description =
+                          "IndexScan(" + table.name + ", " + toString(Predicate(*table.index_scan)) + ")" + description,
+                      .rows = table.index_rows,
+                      .cost = table.cost,
+                      .children = {},
+                      .profile = nullptr};
+      } else {
+        scan = fields.size() < td.size() ? std::make_unique<ScanOperator>(*table.file, fields)
+                                         : std::make_unique<ScanOperator>(*table.file);
+        *scan_node = {.description = "Scan(" + table.name + ")" + description,
+                      .rows = table.rows,
+                      .cost = table.cost,
+                      .children = {},
+                      .profile = nullptr};
+      }
+      scan = measure(std::move(scan), *scan_node);
+      if (table.filter) {
+        return measure(std::make_unique<FilterOperator>(std::move(scan), *table.filter), node);
+      }
+      return scan;
+    }
+
+    std::unique_ptr<Operator> left = build(plan.left, node.children.emplace_back());
+    JoinPredicate pred = plan.join;
+    pred.left = resolve(pred.left, left->getTupleDesc());
+    std::unique_ptr<Operator> join;
+    if (plan.method == Method::INDEX_JOIN) {
+      const Table &table = tables[std::countr_zero(plan.right)];
+      node.description = "IndexJoin(" + table.name + ", " + toString(pred) + ")";
+      if (table.filter) {
+        node.description += " filter " + toString(*table.filter);
+      }
+      join = std::make_unique<IndexJoinOperator>(std::move(left), *table.file, pred, table.filter);
+    } else {
+      std::unique_ptr<Operator> right = build(plan.right, node.children.emplace_back());
+      pred.right = resolve(pred.right, right->getTupleDesc());
+      bool hash = plan.method == Method::HASH_JOIN;
+      node.description = (hash ? "HashJoin(" : "NestedLoopJoin(") + toString(pred) + ")";
+      join = std::make_unique<JoinOperator>(std::move(left), std::move(right), pred,
+                                            hash ? JoinAlgorithm::HASH : JoinAlgorithm::NESTED_LOOP);
+    }
+    if (pred.op == PredicateOp::EQ) {
+      replaced[pred.right] = pred.left;
+    }
+    return measure(std::move(join), node);
+  }
+
+public:
+  Planner(const QuerySpec &query, size_t memory_pages, bool profile)
+      : query(query), memory_pages(memory_pages), profile(profile) {
+    if (query.tables.empty() || query.tables.size() > MAX_PLANNED_TABLES) {
+      throw std::logic_error("Query must have between 1 and MAX_PLANNED_TABLES tables");
+    }
+    for (const auto &name : query.tables) {
+      const DbFile &file = getDatabase().get(name);
+      const TupleDesc &td = file.getTupleDesc();
+      const TableStats *stats = getDatabase().getStats(name);
+      double rows = stats ? stats->rows : file.getNumPages() * double(DEFAULT_PAGE_SIZE / td.length());
+      for (size_t i = 0; i < td.size(); i++) {
+        if (!owner.emplace(td.name_of(i), tables.size()).second) {
+          throw std::logic_error("Field names of the tables must be distinct");
+        }
+      }
+      //The filter and the access path are chosen once all the tables are known.
+      tables.push_back({.name = name,
+                        .file = &file,
+                        .stats = stats,
+                        .rows = rows,
+                        .filter = std::nullopt,
+                        .selectivity = 1,
+                        .index_scan = std::nullopt,
+                        .index_rows = 0,
+                        .cost = 0});
+    }
+
+    //The filters of each table are combined and applied when it is read.
+    std::vector<std::vector<Predicate>> filters(tables.size());
+    for (const auto &filter : query.filters) {
+      std::vector<std::string> fields = filter.fields();
+      if (fields.empty()) {
+        throw std::logic_error("Filter predicate must refer to a field");
+      }
+      size_t table = tableOf(fields[0]);
+      if (std::any_of(fields.begin(), fields.end(), [&](const auto &field) { return tableOf(field) != table; })) {
+        throw std::logic_error("Filter predicate must refer to the fields of one table");
+      }
+      filters[table].push_back(filter);
+    }
+    for (size_t i = 0; i < tables.size(); i++) {
+      Table &table = tables[i];
+      if (filters[i].size() == 1) {
+        table.filter = filters[i][0];
+      } else if (!filters[i].empty()) {
+        table.filter = Predicate::all(filters[i]);
+      }
+      if (table.filter) {
+        table.selectivity = table.selectivityOf(*table.filter);
+      }
+      chooseAccessPath(table);
+    }
+
+    for (const auto &pred : query.joins) {
+      if (tableOf(pred.left) == tableOf(pred.right)) {
+        throw std::logic_error("Join predicate must refer to two tables");
+      }
+    }
+    if (query.joins.size() + 1 != tables.size()) {
+      throw std::logic_error("Join predicates must connect the tables without cycles");
+    }
+    //When the output is aggregated or projected, the scans only produce the fields that are used.
+    if (!query.group_by.empty() || !query.aggregates.empty() || !query.fields.empty()) {
+      used.emplace(query.group_by.begin(), query.group_by.end());
+      used->insert(query.fields.begin(), query.fields.end());
+      for (const auto &term : query.aggregates) {
+        used->insert(term.field);
+      }
+      for (const auto &pred : query.joins) {
+        used->insert(pred.left);
+        used->insert(pred.right);
+      }
+      for (const auto &filter : query.filters) {
+        for (const auto &field : filter.fields()) {
+          used->insert(field);
+        }
+      }
+    }
+    enumerate();
+    if (std::isinf(best.back().cost)) {
+      throw std::logic_error("Join predicates must connect the tables without cycles");
+    }
+  }
+
+  QueryPlan run() {
+    QueryPlan result;
+    PlanNode input;
+    std::unique_ptr<Operator> root = build(best.size() - 1, input);
+    const TupleDesc &td = root->getTupleDesc();
+
+    if (!query.group_by.empty() || !query.aggregates.empty()) {
+      std::vector<std::string> group_by;
+      std::string description;
+      double groups = 1;
+      for (const auto &field : query.group_by) {
+        group_by.push_back(resolve(field, td));
+        description += (description.empty() ? "" : ", ") + group_by.back();
+        groups *= tables[tableOf(field)].distinct(indexOf(field));
+      }
+      description = group_by.empty() ? "Aggregate(" : "Aggregate(GROUP BY " + description + ": ";
+      std::vector<AggregateTerm> terms;
+      for (const auto &term : query.aggregates) {
+        terms.push_back({term.op, resolve(term.field, td)});
+        description += (&term == &query.aggregates.front() ? "" : ", ") + HashAggregator::nameOf(terms.back());
+      }
+      double rows = group_by.empty() ? 1 : std::min(input.rows, groups);
+      result.explain = {.description = description + ")",
+                        .rows = rows,
+                        .cost = input.cost,
+                        .children = {std::move(input)},
+                        .profile = nullptr};
+      result.root = measure(std::make_unique<HashAggregateOperator>(std::move(root), group_by, terms), result.explain);
+    } else if (!query.fields.empty()) {
+      std::vector<std::string> fields;
+      std::string description;
+      for (const auto &field : query.fields) {
+        fields.push_back(resolve(field, td));
+        description += (description.empty() ? "" : ", ") + fields.back();
+      }
+      result.explain = {.description = "Project(" + description + ")",
+                        .rows = input.rows,
+                        .cost = input.cost,
+                        .children = {std::move(input)},
+                        .profile = nullptr};
+      result.root = measure(std::make_unique<ProjectOperator>(std::move(root), fields), result.explain);
+    } else {
+      result.explain = std::move(input);
+      result.root = std::move(root);
+    }
+    return result;
+  }
+};
+} // namespace
+
+QueryPlan db::plan(const QuerySpec &query, size_t memory_pages, bool profile) {
+  return Planner(query, memory_pages, profile).run();
+}
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <cstring>
+#include <db/Predicate.hpp>
+#include <stdexcept>
+#include <string_view>
+
+using namespace db;
+
+Predicate::Predicate(Kind kind, std::vector<Predicate> children) : kind(kind), children(std::move(children)) {}
+
+Predicate::Predicate(const FilterPredicate &pred)
+    : kind(Kind::COMPARE), field(pred.field_name), op(pred.op), values{pred.value} {}
+
+Predicate Predicate::compare(const std::string &field, PredicateOp op, const field_t &value) {
+  return FilterPredicate{field, op, value};
+}
+
+Predicate Predicate::in(const std::string &field, const std::vector<field_t> &values) {
+  Predicate pred(Kind::IN, {});
+  pred.field = field;
+  pred.values = values;
+  return pred;
+}
+
+Predicate Predicate::all(std::vector<Predicate> preds) { return {Kind::AND, std::move(preds)}; }
+
+Predicate Predicate::any(std::vector<Predicate> preds) { return {Kind::OR, std::move(preds)}; }
+
+Predicate Predicate::negate(Predicate pred) { return {Kind::NOT, {std::move(pred)}}; }
+
+Predicate::Kind Predicate::getKind() const { return kind; }
+
+const std::string &Predicate::getField() const { return field; }
+
+PredicateOp Predicate::getOp() const { return op; }
+
+const std::vector<field_t> &Predicate::getValues() const { return values; }
+
+const std::vector<Predicate> &Predicate::getChildren() const { return children; }
+
+std::vector<FilterPredicate> Predicate::conjuncts() const {
+  std::vector<FilterPredicate> result;
+  if (kind == Kind::COMPARE) {
+    result.push_back({field, op, values[0]});
+  } else if (kind == Kind::AND) {
+    for (const auto &child : children) {
+      if (child.kind == Kind::COMPARE) {
+        result.push_back({child.field, child.op, child.values[0]});
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<std::string> Predicate::fields() const {
+  std::vector<std::string> result;
+  auto collect = [&](auto &self, const Predicate &pred) -> void {
+    if ((pred.kind == Kind::COMPARE || pred.kind == Kind::IN) &&
+        std::find(result.begin(), result.end(), pred.field) == result.end()) {
+      result.push_back(pred.field);
+    }
+    for (const auto &child : pred.children) {
+      self(self, child);
+    }
+  };
+  collect(collect, *this);
+  return result;
+}
+
+//The comparison codes of each type are in the order of PredicateOp, so that the code of "INT op" is INT_EQ + op.
+enum class CompiledPredicate::Code : uint8_t {
+  INT_EQ, INT_NE, INT_LT, INT_LE, INT_GT, INT_GE,
+  DOUBLE_EQ, DOUBLE_NE, DOUBLE_LT, DOUBLE_LE, DOUBLE_GT, DOUBLE_GE,
+  STRING_EQ, STRING_NE, STRING_LT, STRING_LE, STRING_GT, STRING_GE,
+  INT_IN, DOUBLE_IN, STRING_IN,
+  TRUE, FALSE, NOT,
+  JUMP_IF_FALSE, JUMP_IF_TRUE
+};
+
+namespace {
+//Reads the fields of a serialized tuple.
+struct SerializedFields {
+  const uint8_t *data;
+
+  int getInt(uint32_t, uint32_t offset) const {
+    int value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+  }
+  double getDouble(uint32_t, uint32_t offset) const {
+    double value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+  }
+  std::string_view getString(uint32_t, uint32_t offset) const {
+    const char *chars = reinterpret_cast<const char *>(data + offset);
+    return {chars, strnlen(chars, CHAR_SIZE)};
+  }
+};
+
+//Reads the fields of a tuple.
+struct TupleFields {
+  const Tuple &t;
+
+  int getInt(uint32_t field, uint32_t) const { return std::get<int>(t.get_field(field)); }
+  double getDouble(uint32_t field, uint32_t) const { return std::get<double>(t.get_field(field)); }
+  std::string_view getString(uint32_t field, uint32_t) const { return std::get<std::string>(t.get_field(field)); }
+};
+} // namespace
+
+field_t db::sampleOf(type_t type) {
+  switch (type) {
+  case type_t::INT:
+    return 0;
+  case type_t::DOUBLE:
+    return 0.0;
+  case type_t::CHAR:
+    return std::string();
+  }
+  throw std::logic_error("Unknown field type");
+}
+
+CompiledPredicate::CompiledPredicate(const Predicate &pred, const TupleDesc &td) { compile(pred, td); }
+
+CompiledPredicate::Instruction &CompiledPredicate::emit(Code code, uint32_t arg) {
+  program.push_back({code, 0, 0, arg, 0, 0, {}});
+  return program.back();
+}
+
+void CompiledPredicate::compile(const Predicate &pred, const TupleDesc &td) {
+  switch (pred.getKind()) {
+  case Predicate::Kind::COMPARE: {
+    size_t idx = td.index_of(pred.getField());
+    type_t type = td.type_of(idx);
+    const field_t &value = pred.getValues()[0];
+    auto op = static_cast<uint8_t>(pred.getOp());
+    Instruction *in;
+    if (type == type_t::INT && std::holds_alternative<int>(value)) {
+      in = &emit(static_cast<Code>(static_cast<uint8_t>(Code::INT_EQ) + op));
+      in->int_value = std::get<int>(value);
+    } else if (type == type_t::DOUBLE && std::holds_alternative<double>(value)) {
+      in = &emit(static_cast<Code>(static_cast<uint8_t>(Code::DOUBLE_EQ) + op));
+      in->double_value = std::get<double>(value);
+    } else if (type == type_t::CHAR && std::holds_alternative<std::string>(value)) {
+      in = &emit(static_cast<Code>(static_cast<uint8_t>(Code::STRING_EQ) + op));
+      in->string_value = std::get<std::string>(value);
+    } else {
+      emit(evaluateCondition(sampleOf(type), pred.getOp(), value) ? Code::TRUE : Code::FALSE);
+      break;
+    }
+    in->field = idx;
+    in->offset = td.offset_of(idx);
+    break;
+  }
+  case Predicate::Kind::IN: {
+    size_t idx = td.index_of(pred.getField());
+    type_t type = td.type_of(idx);
+    //Values of another type never equal the field and are dropped.
+    auto collect = [&]<typename T>(std::vector<std::vector<T>> &sets, Code code) {
+      std::vector<T> set;
+      for (const auto &value : pred.getValues()) {
+        if (std::holds_alternative<T>(value)) {
+          set.push_back(std::get<T>(value));
+        }
+      }
+      if (set.empty()) {
+        emit(Code::FALSE);
+        return;
+      }
+      std::sort(set.begin(), set.end());
+      set.erase(std::unique(set.begin(), set.end()), set.end());
+      sets.push_back(std::move(set));
+      Instruction &in = emit(code, sets.size() - 1);
+      in.field = idx;
+      in.offset = td.offset_of(idx);
+    };
+    switch (type) {
+    case type_t::INT:
+      collect(int_sets, Code::INT_IN);
+      break;
+    case type_t::DOUBLE:
+      collect(double_sets, Code::DOUBLE_IN);
+      break;
+    case type_t::CHAR:
+      collect(string_sets, Code::STRING_IN);
+      break;
+    }
+    break;
+  }
+  case Predicate::Kind::NOT:
+    compile(pred.getChildren()[0], td);
+    emit(Code::NOT);
+    break;
+  case Predicate::Kind::AND:
+  case Predicate::Kind::OR: {
+    bool is_and = pred.getKind() == Predicate::Kind::AND;
+    const auto &children = pred.getChildren();
+    if (children.empty()) {
+      emit(is_and ? Code::TRUE : Code::FALSE);
+      break;
+    }
+    //Once an operand decides the result (false for AND, true for OR), jump to the end with that result.
+    std::vector<size_t> jumps;
+    for (size_t i = 0; i < children.size(); ++i) {
+      compile(children[i], td);
+      if (i + 1 < children.size()) {
+        jumps.push_back(program.size());
+        emit(is_and ? Code::JUMP_IF_FALSE : Code::JUMP_IF_TRUE);
+      }
+    }
+    for (size_t jump : jumps) {
+      program[jump].arg = program.size();
+    }
+    break;
+  }
+  }
+}
+
+template <typename Fields> bool CompiledPredicate::run(const Fields &fields) const {
+  bool result = true;
+  size_t pc = 0;
+  while (pc < program.size()) {
+    const Instruction &in = program[pc++];
+    switch (in.code) {
+    case Code::INT_EQ: result = fields.getInt(in.field, in.offset) == in.int_value; break;
+    case Code::INT_NE: result = fields.getInt(in.field, in.offset) != in.int_value; break;
+    case Code::INT_LT: result = fields.getInt(in.field, in.offset) < in.int_value; break;
+    case Code::INT_LE: result = fields.getInt(in.field, in.offset) <= in.int_value; break;
+    case Code::INT_GT: result = fields.getInt(in.field, in.offset) > in.int_value; break;
+    case Code::INT_GE: result = fields.getInt(in.field, in.offset) >= in.int_value; break;
+    case Code::DOUBLE_EQ: result = fields.getDouble(in.field, in.offset) == in.double_value; break;
+    case Code::DOUBLE_NE: result = fields.getDouble(in.field, in.offset) != in.double_value; break;
+    case Code::DOUBLE_LT: result = fields.getDouble(in.field, in.offset) < in.double_value; break;
+    case Code::DOUBLE_LE: result = fields.getDouble(in.field, in.offset) <= in.double_value; break;
+    case Code::DOUBLE_GT: result = fields.getDouble(in.field, in.offset) > in.double_value; break;
+    case Code::DOUBLE_GE: result = fields.getDouble(in.field, in.offset) >= in.double_value; break;
+    case Code::STRING_EQ: result = fields.getString(in.field, in.offset) == in.string_value; break;
+    case Code::STRING_NE: result = fields.getString(in.field, in.offset) != in.string_value; break;
+    case Code::STRING_LT: result = fields.getString(in.field, in.offset) < in.string_value; break;
+    case Code::STRING_LE: result = fields.getString(in.field, in.offset) <= in.string_value; break;
+    case Code::STRING_GT: result = fields.getString(in.field, in.offset) > in.string_value; break;
+    case Code::STRING_GE: result = fields.getString(in.field, in.offset) >= in.string_value; break;
+    case Code::INT_IN: {
+      const auto &set = int_sets[in.arg];
+      result = std::binary_search(set.begin(), set.end(), fields.getInt(in.field, in.offset));
+      break;
+    }
+    case Code::DOUBLE_IN: {
+      const auto &set = double_sets[in.arg];
+      result = std::binary_search(set.begin(), set.end(), fields.getDouble(in.field, in.offset));
+      break;
+    }
+    case Code::STRING_IN: {
+      const auto &set = string_sets[in.arg];
+      std::string_view value = fields.getString(in.field, in.offset);
+      result = std::binary_search(set.begin(), set.end(), value, std::less<>());
+      break;
+    }
+    case Code::TRUE: result = true; break;
+    case Code::FALSE: result = false; break;
+    case Code::NOT: result = !result; break;
+    case Code::JUMP_IF_FALSE:
+      if (!result) {
+        pc = in.arg;
+      }
+      break;
+    case Code::JUMP_IF_TRUE:
+      if (result) {
+        pc = in.arg;
+      }
+      break;
+    }
+  }
+  return result;
+}
+
+bool CompiledPredicate::operator()(const uint8_t *data) const { return run(SerializedFields{data}); }
+
+bool CompiledPredicate::operator()(const Tuple &t) const { return run(TupleFields{t}); }
@@ -0,0 +1,279 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <db/Metrics.hpp>
+#include <db/Profile.hpp>
+#include <iomanip>
+#include <sstream>
+
+using namespace db;
+
+namespace {
+//The clocks and counters at one point in time.
+struct Sample {
+  std::chrono::steady_clock::time_point wall;
+  double cpu_ms;
+  size_t pool_hits, pool_misses, page_reads, page_writes;
+
+  //Reading the CPU time is a system call, which costs more than reading the other clocks and counters.
+  static Sample now(bool with_cpu = true) {
+    timespec cpu{};
+    if (with_cpu) {
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    }
+    const Metrics &metrics = getMetrics();
+    return {std::chrono::steady_clock::now(),
+            cpu.tv_sec * 1e3 + cpu.tv_nsec / 1e6,
+            metrics.pool_hits.load(std::memory_order_relaxed),
+            metrics.pool_misses.load(std::memory_order_relaxed),
+            metrics.files.reads.load(std::memory_order_relaxed),
+            metrics.files.writes.load(std::memory_order_relaxed)};
+  }
+};
+
+//Add the work done between two samples to the metrics of a step.
+void addDelta(OperatorMetrics &total, const Sample &before, const Sample &after) {
+  total.wall_ms += std::chrono::duration<double, std::milli>(after.wall - before.wall).count();
+  total.cpu_ms += after.cpu_ms - before.cpu_ms;
+  total.pool_hits += after.pool_hits - before.pool_hits;
+  total.pool_misses += after.pool_misses - before.pool_misses;
+  total.page_reads += after.page_reads - before.page_reads;
+  total.page_writes += after.page_writes - before.page_writes;
+}
+
+//The elapsed time taken by measuring a call that does nothing without its CPU time, averaged over many calls. The
+//measured calls of a ProfileOperator are corrected for it, since scaling them to all the calls would otherwise count it
+//for the calls that were not measured.
+double sampleOverheadMs() {
+  static const double overhead = [] {
+    constexpr int CALLS = 1000;
+    OperatorMetrics total;
+    for (int i = 0; i < CALLS; i++) {
+      Sample before = Sample::now(false);
+      addDelta(total, before, Sample::now(false));
+    }
+    return total.wall_ms / CALLS;
+  }();
+  return overhead;
+}
+
+/// The innermost QueryProfiler of the thread
+thread_local QueryProfiler *current_profiler = nullptr;
+
+void writeJson(std::ostream &out, const OperatorMetrics &metrics) {
+  out << "{\"wall_ms\": " << metrics.wall_ms << ", \"cpu_ms\": " << metrics.cpu_ms
+      << ", \"pool_hits\": " << metrics.pool_hits << ", \"pool_misses\": " << metrics.pool_misses
+      << ", \"page_reads\": " << metrics.page_reads << ", \"page_writes\": " << metrics.page_writes << "}";
+}
+} // namespace
+
+std::string db::jsonString(const std::string &s) {
+  std::ostringstream out;
+  out << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << int(c) << std::dec;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+  return out.str();
+}
+
+size_t ProfileNode::rowsIn() const {
+  size_t rows = 0;
+  for (const auto &input : inputs) {
+    rows += input->total.rows;
+  }
+  return rows;
+}
+
+OperatorMetrics ProfileNode::self() const {
+  //The totals of sampled steps are estimates, so the inputs may seem to have done more than the step itself.
+  auto subtract = [](size_t &count, size_t input) { count -= std::min(count, input); };
+  OperatorMetrics metrics = total;
+  for (const auto &input : inputs) {
+    metrics.wall_ms -= input->total.wall_ms;
+    metrics.cpu_ms -= input->total.cpu_ms;
+    subtract(metrics.pool_hits, input->total.pool_hits);
+    subtract(metrics.pool_misses, input->total.pool_misses);
+    subtract(metrics.page_reads, input->total.page_reads);
+    subtract(metrics.page_writes, input->total.page_writes);
+  }
+  metrics.wall_ms = std::max(0.0, metrics.wall_ms);
+  metrics.cpu_ms = std::max(0.0, metrics.cpu_ms);
+  return metrics;
+}
+
+std::string ProfileNode::describe() const {
+  OperatorMetrics own = self();
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2) << "rows=" << total.rows << " in=" << rowsIn() << " time=" << total.wall_ms
+      << "ms (self " << own.wall_ms << "ms) cpu=" << own.cpu_ms << "ms hits=" << own.pool_hits
+      << " misses=" << own.pool_misses << " reads=" << own.page_reads << " writes=" << own.page_writes;
+  return out.str();
+}
+
+std::string ProfileNode::toString() const {
+  std::ostringstream out;
+  auto print = [&](auto &self, const ProfileNode &node, size_t depth) -> void {
+    out << std::string(2 * depth, ' ') << node.name << "  " << node.describe() << '\n';
+    for (const auto &input : node.inputs) {
+      self(self, *input, depth + 1);
+    }
+  };
+  print(print, *this, 0);
+  return out.str();
+}
+
+std::string ProfileNode::toJson(bool with_inputs) const {
+  std::ostringstream out;
+  out << "{\"operator\": " << jsonString(name) << ", \"rows_in\": " << rowsIn() << ", \"rows_out\": " << total.rows
+      << ", \"total\": ";
+  writeJson(out, total);
+  out << ", \"self\": ";
+  writeJson(out, self());
+  if (with_inputs) {
+    out << ", \"inputs\": [";
+    for (size_t i = 0; i < inputs.size(); i++) {
+      out << (i == 0 ? "" : ", ") << inputs[i]->toJson();
+    }
+    out << "]";
+  }
+  out << "}";
+  return out.str();
+}
+
+ProfileOperator::ProfileOperator(std::unique_ptr<Operator> child, const std::string &name,
+                                 std::vector<std::shared_ptr<const ProfileNode>> inputs)
+    : child(std::move(child)), profile(std::make_shared<ProfileNode>(ProfileNode{name, {}, std::move(inputs)})) {}
+
+std::shared_ptr<const ProfileNode> ProfileOperator::getProfile() const { return profile; }
+
+template <typename Call> auto ProfileOperator::measure(OperatorMetrics &metrics, Call call, bool with_cpu) {
+  Sample before = Sample::now(with_cpu);
+  auto record = [&] { addDelta(metrics, before, Sample::now(with_cpu)); };
+  if constexpr (std::is_void_v<decltype(call())>) {
+    call();
+    record();
+  } else {
+    auto result = call();
+    record();
+    return result;
+  }
+}
+
+void ProfileOperator::update() {
+  OperatorMetrics &total = profile->total;
+  size_t rows = total.rows;
+  total = opened;
+  total.rows = rows;
+  if (sampled_calls == 0) {
+    return;
+  }
+  //The counters of every measured call are scaled to all the calls.
+  double scale = double(calls) / sampled_calls;
+  auto count = [&](size_t sampled_count, size_t timed_count) {
+    return static_cast<size_t>(std::llround((sampled_count + timed_count) * scale));
+  };
+  total.pool_hits += count(sampled.pool_hits, timed.pool_hits);
+  total.pool_misses += count(sampled.pool_misses, timed.pool_misses);
+  total.page_reads += count(sampled.page_reads, timed.page_reads);
+  total.page_writes += count(sampled.page_writes, timed.page_writes);
+  //The elapsed time is taken from the calls that did not read the CPU time, as long as there are some.
+  size_t wall_calls = sampled_calls - timed_calls;
+  double wall_ms = wall_calls == 0 ? timed.wall_ms / timed_calls
+                                   : std::max(0.0, sampled.wall_ms - wall_calls * sampleOverheadMs()) / wall_calls;
+  total.wall_ms += wall_ms * calls;
+  //The CPU time is the share of the elapsed time that the thread spent on the CPU in the calls that read both.
+  if (timed.wall_ms > 0) {
+    total.cpu_ms += wall_ms * calls * std::min(1.0, timed.cpu_ms / timed.wall_ms);
+  }
+}
+
+const TupleDesc &ProfileOperator::getTupleDesc() const { return child->getTupleDesc(); }
+
+void ProfileOperator::open() {
+  measure(opened, [&] { child->open(); });
+  update();
+}
+
+std::optional<Tuple> ProfileOperator::next() {
+  calls++;
+  std::optional<Tuple> t;
+  if (--until_sample == 0) {
+    bool with_cpu = sampled_calls++ % PROFILE_CPU_SAMPLE_INTERVAL == 0;
+    t = measure(with_cpu ? timed : sampled, [&] { return child->next(); }, with_cpu);
+    timed_calls += with_cpu;
+    //The gaps are uniform in [1, 2 * PROFILE_SAMPLE_INTERVAL - 1] (xorshift64).
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    until_sample = 1 + random % (2 * PROFILE_SAMPLE_INTERVAL - 1);
+    update();
+  } else {
+    t = child->next();
+  }
+  if (t) {
+    profile->total.rows++;
+  }
+  return t;
+}
+
+void ProfileOperator::close() {
+  measure(opened, [&] { child->close(); });
+  update();
+}
+
+QueryProfiler::QueryProfiler() : outer(current_profiler) { current_profiler = this; }
+
+QueryProfiler::~QueryProfiler() { current_profiler = outer; }
+
+const std::vector<std::shared_ptr<const ProfileNode>> &QueryProfiler::getProfiles() const { return profiles; }
+
+std::string QueryProfiler::toString() const {
+  std::string out;
+  for (const auto &profile : profiles) {
+    out += profile->toString();
+  }
+  return out;
+}
+
+std::string QueryProfiler::toJson() const {
+  std::string out = "[";
+  for (size_t i = 0; i < profiles.size(); i++) {
+    out += (i == 0 ? "" : ", ") + profiles[i]->toJson();
+  }
+  return out + "]";
+}
+
+struct QueryStep::Start : Sample {};
+
+QueryStep::QueryStep(const std::string &name, const std::vector<const DbFile *> &inputs)
+    : profiler(current_profiler) {
+  if (profiler == nullptr) {
+    return;
+  }
+  profile = std::make_shared<ProfileNode>(ProfileNode{name, {}, {}});
+  for (const DbFile *input : inputs) {
+    profile->inputs.push_back(std::make_shared<ProfileNode>(ProfileNode{"Table(" + input->getName() + ")", {}, {}}));
+  }
+  rows_read.resize(inputs.size());
+  start = std::make_unique<Start>(Start{Sample::now()});
+}
+
+QueryStep::~QueryStep() {
+  if (!profile) {
+    return;
+  }
+  addDelta(profile->total, *start, Sample::now());
+  for (size_t i = 0; i < rows_read.size(); i++) {
+    //The inputs were created by the constructor, so they can still be changed.
+    std::const_pointer_cast<ProfileNode>(profile->inputs[i])->total.rows = rows_read[i];
+  }
+  profiler->profiles.push_back(profile);
+}
@@ -1,33 +1,62 @@
+#include <algorithm>
+#include <cmath>
 #include <db/Query.hpp>
+#include <db/Database.hpp>
 #include <db/HeapFile.hpp>
+#include <db/HashAggregator.hpp>
+#include <db/HeapPage.hpp>
+#include <db/Kernels.hpp>
 #include <db/BTreeFile.hpp>
+#include <db/ColumnFile.hpp>
+#include <db/ExternalSort.hpp>
+#include <db/Operator.hpp>
+#include <db/ParallelScan.hpp>
+#include <db/Predicate.hpp>
+#include <db/Profile.hpp>
 #include <unordered_map>
 #include <stdexcept>
 #include <limits>
 #include <variant>
 #include <type_traits>
 #include <vector>
+#include <tuple>
+#include <numeric>
+#include <memory>
 
 using namespace db;
 //The projection function is used to create a subset of columns (or fields) from the input data (DbFile) and write the selected fields to the output data (DbFile).
 void db::projection(const DbFile &input, DbFile &output, const std::vector<std::string> &fields) {
   const TupleDesc &input_desc = input.getTupleDesc();
+  std::vector<size_t> columns;//The indexes of the selected fields, in the order of the output.
+  columns.reserve(fields.size());
+  for (const auto &field_name : fields) {
+    columns.push_back(input_desc.index_of(field_name));
+  }
 
-  for (const auto &record : input) {
-    std::vector<field_t> projected_fields;//Create an empty vector to hold the fields that are selected from the current tuple.
-    projected_fields.reserve(fields.size());
-    //Iterate over each field name in the fields vector to extract the corresponding value from the current tuple (record).
-    for (const auto &field_name : fields) {
-      projected_fields.push_back(record.get_field(input_desc.index_of(field_name)));
-    }
-
-    output.insertTuple(Tuple(projected_fields));
+  QueryStep step("Projection(" + input.getName() + ")", {&input});
+  //The iterator only decodes the selected fields of each record, the other fields are never copied out of the page.
+  for (auto it = input.begin(columns); it != input.end(); ++it) {
+    step.read(0);
+    output.insertTuple(*it);
+    step.wrote();
     //The output database now contains the projected tuple, which has only the fields specified in the fields parameter.
   }
 }
 
+//The indexes of the named fields, each once, in order of first appearance.
+static std::vector<size_t> columnsOf(const TupleDesc &td, const std::vector<std::string> &names) {
+  std::vector<size_t> columns;
+  for (const auto &name : names) {
+    size_t idx = td.index_of(name);
+    if (std::find(columns.begin(), columns.end(), idx) == columns.end()) {
+      columns.push_back(idx);
+    }
+  }
+  return columns;
+}
+
 //evaluate a conditional expression involving two field_t values (field and value) using a specific comparison operator
-bool evaluateCondition(const field_t &field, PredicateOp operation, const field_t &value) {
+bool db::evaluateCondition(const field_t &field, PredicateOp operation, const field_t &value) {
     switch (operation) {
         case PredicateOp::EQ: return field == value;
         case PredicateOp::NE: return field != value;
@@ -39,29 +68,325 @@ bool evaluateCondition(const field_t &field, PredicateOp operation, const field_
     }
 }
 
+//Check with the zone map whether a page with the given range of a field may hold a value that satisfies "field op value".
+static bool mayMatch(const ZoneRange &range, PredicateOp op, double value) {
+  if (range.empty()) {
+    return false;
+  }
+  switch (op) {
+    case PredicateOp::EQ: return range.min <= value && value <= range.max;
+    case PredicateOp::NE: return range.min != value || range.max != value;
+    case PredicateOp::LT: return range.min < value;
+    case PredicateOp::LE: return range.min <= value;
+    case PredicateOp::GT: return range.max > value;
+    case PredicateOp::GE: return range.max >= value;
+    default: return true;
+  }
+}
+
+//Visit some fields of every record stored in one page of a heap file.
+template <typename Visit>
+static void scanPage(const HeapFile &heap, size_t page, const std::vector<size_t> &fields, Visit visit) {
+  auto it = heap.seek(page);
+  it.fields = &fields;
+  for (; it.page == page; ++it) {
+    visit(*it);
+  }
+}
+
+//Visit the serialized bytes of every record stored in one page of a heap file.
+template <typename Visit>
+static void scanPageData(const HeapFile &heap, size_t page, Visit visit) {
+  Page &p = getDatabase().getBufferPool().getPage({heap.getName(), page});
+  const HeapPage hp(p, heap.getTupleDesc());
+  for (size_t slot = hp.begin(); slot != hp.end(); hp.next(slot)) {
+    visit(hp.getData(slot));
+  }
+}
+
+//Find the range of index entries [first, last) that can satisfy "key op value". NE is not a range and is not handled.
+std::pair<Iterator, Iterator> db::indexRange(const BTreeFile &index, PredicateOp op, int value) {
+  switch (op) {
+    case PredicateOp::EQ: return {index.lowerBound(value), index.upperBound(value)};
+    case PredicateOp::LT: return {index.begin(), index.lowerBound(value)};
+    case PredicateOp::LE: return {index.begin(), index.upperBound(value)};
+    case PredicateOp::GT: return {index.upperBound(value), index.end()};
+    case PredicateOp::GE: return {index.lowerBound(value), index.end()};
+    default: throw std::logic_error("Predicate cannot use an index");
+  }
+}
+
+const BTreeFile *db::findIndex(const DbFile &file, size_t field) {
+  if (file.getTupleDesc().type_of(field) != type_t::INT) {
+    return nullptr;
+  }
+  if (const auto *btree = dynamic_cast<const BTreeFile *>(&file); btree != nullptr && btree->getKeyIndex() == field) {
+    return btree;
+  }
+  if (const auto *heap = dynamic_cast<const HeapFile *>(&file)) {
+    return heap->getIndex(field);
+  }
+  return nullptr;
+}
+
+double db::indexDepth(const BTreeFile &index) {
+  //The number of children of an index page, roughly.
+  constexpr double FANOUT = DEFAULT_PAGE_SIZE / (2 * INT_SIZE);
+  return 1 + std::ceil(std::log(std::max<double>(index.getNumPages(), 1)) / std::log(FANOUT));
+}
+
+double db::indexLookupCost(const DbFile &file, const BTreeFile &index, double matches) {
+  double per_page = std::max<size_t>(1, DEFAULT_PAGE_SIZE / index.getTupleDesc().length());
+  double cost = indexDepth(index) + std::ceil(matches / per_page);
+  if (&index != &file) {
+    cost += std::ceil(matches);
+  }
+  return cost;
+}
+
+//Use a secondary index of the heap file to find the (page, slot) of the records that may match the conditions.
+//An equality predicate is preferred since it is the most selective, otherwise the first indexed range predicate is used.
+//Returns nothing if no predicate can use an index.
+static std::optional<std::vector<std::pair<size_t, size_t>>> indexLookup(const HeapFile &input, const std::vector<FilterPredicate> &conditions) {
+  const TupleDesc &input_desc = input.getTupleDesc();
+  const FilterPredicate *chosen = nullptr;
+  const BTreeFile *index = nullptr;
+  for (const auto &condition : conditions) {
+    const BTreeFile *candidate = input.getIndex(input_desc.index_of(condition.field_name));
+    if (candidate == nullptr || condition.op == PredicateOp::NE || !std::holds_alternative<int>(condition.value)) {
+      continue;
+    }
+    if (chosen == nullptr || (condition.op == PredicateOp::EQ && chosen->op != PredicateOp::EQ)) {
+      chosen = &condition;
+      index = candidate;
+    }
+  }
+  if (chosen == nullptr) {
+    return std::nullopt;
+  }
+
+  std::vector<std::pair<size_t, size_t>> rids;
+  auto [first, last] = indexRange(*index, chosen->op, std::get<int>(chosen->value));
+  for (auto it = first; it != last; ++it) {
+    Tuple entry = *it;
+    rids.emplace_back(std::get<int>(entry.get_field(1)), std::get<int>(entry.get_field(2)));
+  }
+  //Visit the heap in file order so that every matching page is read once.
+  std::sort(rids.begin(), rids.end());
+  return rids;
+}
+
 void db::filter(const DbFile &input, DbFile &output, const std::vector<FilterPredicate> &conditions) {
+  filter(input, output, Predicate::all({conditions.begin(), conditions.end()}));
+}
+
+void db::filter(const DbFile &input, DbFile &output, std::initializer_list<FilterPredicate> conditions) {
+  filter(input, output, Predicate::all({conditions.begin(), conditions.end()}));
+}
+
+void db::filter(const DbFile &input, DbFile &output, const Predicate &predicate) {
   const TupleDesc &input_desc = input.getTupleDesc();
 
-  for (const auto &record : input) {
-    //Determine if the current record satisfies all of the conditions.
-    bool is_match = std::all_of(conditions.begin(), conditions.end(), [&](const FilterPredicate &condition) {//check if all elements in the conditions vector evaluate to true based on a given predicate.
-        size_t idx = input_desc.index_of(condition.field_name);
-        const field_t &field = record.get_field(idx);
-        return evaluateCondition(field, condition.op, condition.value);
-      // Evaluate whether the field value satisfies the condition based on the specified operator (condition.op) and comparison value (condition.value).
-    });
+  //Determine if the current record satisfies the predicate, with field names resolved once.
+  CompiledPredicate is_match(predicate, input_desc);
+  std::vector<FilterPredicate> conditions = predicate.conjuncts();
+  QueryStep step("Filter(" + input.getName() + ")", {&input});
+
+  //A heap file with a secondary index on one of the predicate fields only reads the pages holding candidate records.
+  const auto *heap = dynamic_cast<const HeapFile *>(&input);
+  if (heap != nullptr) {
+    if (auto rids = indexLookup(*heap, conditions)) {
+      for (const auto &[page, slot] : *rids) {
+        Tuple record = heap->getTuple({*heap, page, slot});
+        step.read(0);
+        if (is_match(record)) {
+          output.insertTuple(record);
+          step.wrote();
+        }
+      }
+      return;
+    }
+  }
+
+  //A column file first compares the columns of the conjuncts a page at a time, on their encoded values (e.g. dictionary
+  //codes) or with the column kernels, then copies the predicate columns of the remaining records next to each other to
+  //check the whole predicate, and reads the other columns of the records that match.
+  if (const auto *column_file = dynamic_cast<const ColumnFile *>(&input)) {
+    std::vector<size_t> columns = columnsOf(input_desc, predicate.fields());
+    Page row{};
+    std::vector<uint8_t> selected;
+    std::vector<Tuple> matches;
+    for (size_t page = 0; page < column_file->getNumPages(); page++) {
+      const ColumnPage cp = column_file->getPage(page);
+      cp.occupancy(selected);
+      if (step.active()) {
+        step.read(0, countSelected(selected.data(), selected.size()));
+      }
+      for (const auto &condition : conditions) {
+        cp.match(input_desc.index_of(condition.field_name), condition.op, condition.value, selected);
+      }
+      for (size_t slot = 0; slot < selected.size(); slot++) {
+        if (!selected[slot]) {
+          continue;
+        }
+        cp.gather(slot, columns, row.data());
+        if (is_match(row.data())) {
+          matches.push_back(cp.getTuple(slot));
+        }
+      }
+      for (const auto &record : matches) {
+        output.insertTuple(record);
+      }
+      step.wrote(matches.size());
+      matches.clear();
+    }
+    return;
+  }
 
-    if (is_match) {
+  //Other files only decode the predicate fields of each record, and read the whole record when it matches.
+  if (heap == nullptr) {
+    std::vector<size_t> columns = columnsOf(input_desc, predicate.fields());
+    CompiledPredicate is_match_columns(predicate, input_desc.project(columns));
+    for (auto it = input.begin(columns); it != input.end(); ++it) {
+      step.read(0);
+      if (is_match_columns(*it)) {
+        output.insertTuple(input.getTuple(it));
+        step.wrote();
+      }
+    }
+    return;
+  }
+
+  //Numeric predicates whose value has the type of the field can be checked against the zone map of every page.
+  std::vector<std::tuple<size_t, PredicateOp, double>> ranged;
+  for (const auto &condition : conditions) {
+    size_t idx = input_desc.index_of(condition.field_name);
+    type_t type = input_desc.type_of(idx);
+    if (type == type_t::INT && std::holds_alternative<int>(condition.value)) {
+      ranged.emplace_back(idx, condition.op, std::get<int>(condition.value));
+    } else if (type == type_t::DOUBLE && std::holds_alternative<double>(condition.value)) {
+      ranged.emplace_back(idx, condition.op, std::get<double>(condition.value));
+    }
+  }
+  //Pages where the range of some predicate field cannot satisfy the predicate are not read at all.
+  const ZoneMap *zones = ranged.empty() ? nullptr : &heap->getZoneMap();
+  std::vector<Tuple> matches;
+  for (size_t page = 0; page < heap->getNumPages(); page++) {
+    bool skip = zones != nullptr && std::any_of(ranged.begin(), ranged.end(), [&](const auto &condition) {
+      const auto &[idx, op, value] = condition;
+      const ZoneRange *range = zones->range(page, idx);
+      return range != nullptr && !mayMatch(*range, op, value);
+    });
+    if (skip) {
+      continue;
+    }
+    //The page may be evicted by the inserts into the output, so its matches are collected first.
+    scanPageData(*heap, page, [&](const uint8_t *data) {
+      step.read(0);
+      if (is_match(data)) {
+        matches.push_back(input_desc.deserialize(data));
+      }
+    });
+    for (const auto &record : matches) {
       output.insertTuple(record);
       // Only records that meet all specified conditions are inserted into the output database.
     }
+    step.wrote(matches.size());
+    matches.clear();
   }
 }
 
-void db::aggregate(const DbFile &input, DbFile &output, const Aggregate &agg) {
-    const auto &schema = input.getTupleDesc();//Schema
-    size_t value_idx = schema.index_of(agg.field);//Schema
-    size_t group_idx = agg.group.has_value() ? schema.index_of(agg.group.value()) : 0;//Schema
+void db::sort(const DbFile &input, DbFile &output, const std::vector<SortKey> &keys, size_t memory_pages) {
+  const TupleDesc &input_desc = input.getTupleDesc();
+  std::vector<std::pair<size_t, bool>> order;//(field index, descending) of each key
+  for (const auto &key : keys) {
+    order.emplace_back(input_desc.index_of(key.field), key.descending);
+  }
+  QueryStep step("Sort(" + input.getName() + ")", {&input});
+
+  //A B+tree is already sorted ascending on its key.
+  const auto *btree = dynamic_cast<const BTreeFile *>(&input);
+  if (btree != nullptr && order.size() == 1 && order[0] == std::make_pair(btree->getKeyIndex(), false)) {
+    for (const auto &record : input) {
+      step.read(0);
+      output.insertTuple(record);
+      step.wrote();
+    }
+    return;
+  }
+
+  ExternalSort sorter(input_desc, ExternalSort::byFields(order), memory_pages);
+  for (const auto &record : input) {
+    step.read(0);
+    sorter.add(record);
+  }
+  while (auto record = sorter.next()) {
+    output.insertTuple(*record);
+    step.wrote();
+  }
+}
+
+void db::topk(const DbFile &input, DbFile &output, const std::vector<SortKey> &keys, size_t k, size_t num_threads) {
+  const TupleDesc &input_desc = input.getTupleDesc();
+  std::vector<std::pair<size_t, bool>> order;//(field index, descending) of each key
+  for (const auto &key : keys) {
+    order.emplace_back(input_desc.index_of(key.field), key.descending);
+  }
+  QueryStep step("TopK(" + input.getName() + ")", {&input});
+  if (k == 0) {
+    return;
+  }
+  TopKHeap heap(ExternalSort::byFields(order), k);
+
+  const auto *btree = dynamic_cast<const BTreeFile *>(&input);
+  if (btree != nullptr && !order.empty() && order[0].first == btree->getKeyIndex()) {
+    //The rows arrive in the order of the first key, so once k rows are kept, a row whose first key is worse than the
+    //first key of the largest kept row cannot be kept, and neither can any row after it.
+    ExternalSort::Less first_less = ExternalSort::byFields({order[0]});
+    auto visit = [&](const Tuple &record) {
+      step.read(0);
+      if (heap.full() && first_less(heap.largest(), record)) {
+        return false;
+      }
+      heap.add(record);
+      return true;
+    };
+    if (order[0].second) {
+      btree->reverseScan(visit);
+    } else {
+      for (const auto &record : input) {
+        if (!visit(record)) {
+          break;
+        }
+      }
+    }
+  } else if (parallelScannable(input) && (num_threads = parallelism(input.getNumPages(), num_threads)) > 1) {
+    std::vector<TopKHeap> heaps(num_threads, heap);
+    step.read(0, parallelScan(input, num_threads, [&](size_t thread, const uint8_t *data) {
+                heaps[thread].add(input_desc.deserialize(data));
+              }));
+    for (const auto &partial : heaps) {
+      heap.merge(partial);
+    }
+  } else {
+    for (const auto &record : input) {
+      step.read(0);
+      heap.add(record);
+    }
+  }
+
+  for (const auto &record : heap.finish()) {
+    output.insertTuple(record);
+    step.wrote();
+  }
+}
+
+namespace {
+//Accumulates one aggregate over a stream of records, shared by db::aggregate and AggregateOperator.
+class Aggregator {
+    const Aggregate &agg;
+    size_t value_idx;
+    size_t group_idx;
 //---Aggregate Storage
     std::unordered_map<field_t, std::pair<double, int>> grouped_aggregates;// store the sum and count for each group when grouping is applied.
     double global_value = 0;
@@ -71,8 +396,21 @@ void db::aggregate(const DbFile &input, DbFile &output, const Aggregate &agg) {
     bool has_data = false;
 //global_value, global_count, min_value, and max_value track the aggregation values if no grouping is applied.
 
+public:
+    Aggregator(const TupleDesc &schema, const Aggregate &agg)
+        : agg(agg), value_idx(schema.index_of(agg.field)),
+          group_idx(agg.group.has_value() ? schema.index_of(agg.group.value()) : 0) {}
+
+    //The current result of a global MIN (or the negated result of a global MAX), +inf before any record.
+    double best() const {
+        if (!has_data) {
+            return std::numeric_limits<double>::infinity();
+        }
+        return agg.op == AggregateOp::MIN ? min_value : -max_value;
+    }
+
 //---Loop Through Input Records:
-    for (const auto &record : input) {
+    void add(const Tuple &record) {
         double value = std::visit([](auto &&arg) -> double {
             if constexpr (std::is_arithmetic_v<std::decay_t<decltype(arg)>>) {
                 return static_cast<double>(arg);
@@ -131,66 +469,233 @@ void db::aggregate(const DbFile &input, DbFile &output, const Aggregate &agg) {
             }
         }
     }
-//---Compilation and Insertion
-    if (agg.group.has_value()) {//---Grouped Aggregates
-        for (const auto &[key, aggregate] : grouped_aggregates) {
-            double result = aggregate.first;
-            if (agg.op == AggregateOp::AVG) {
-                result /= aggregate.second;
-            } else if (agg.op == AggregateOp::COUNT) {
-                result = aggregate.second;
+
+//---Compilation
+    std::vector<Tuple> results() const {
+        std::vector<Tuple> results;
+        if (agg.group.has_value()) {//---Grouped Aggregates
+            for (const auto &[key, aggregate] : grouped_aggregates) {
+                double result = aggregate.first;
+                if (agg.op == AggregateOp::AVG) {
+                    result /= aggregate.second;
+                } else if (agg.op == AggregateOp::COUNT) {
+                    result = aggregate.second;
+                }
+                results.push_back(Tuple({key, field_t(result)}));
             }
-            output.insertTuple(Tuple({key, field_t(result)}));
+        } else {//---Non-Grouped Aggregates
+            field_t result;
+            switch (agg.op) {
+                case AggregateOp::SUM:
+                    result = field_t(static_cast<int>(global_value));
+                    break;
+                case AggregateOp::AVG:
+                    result = field_t(global_count > 0 ? global_value / global_count : 0);
+                    break;
+                case AggregateOp::MIN:
+                    result = field_t(has_data ? static_cast<int>(min_value) : 0);
+                    break;
+                case AggregateOp::MAX:
+                    result = field_t(has_data ? static_cast<int>(max_value) : 0);
+                    break;
+                case AggregateOp::COUNT:
+                    result = field_t(global_count);
+                    break;
+                default:
+                    throw std::runtime_error("Unsupported aggregation operation");
+            }
+            results.push_back(Tuple({result}));
         }
-    } else {//---Non-Grouped Aggregates
-        field_t result;
-        switch (agg.op) {
-            case AggregateOp::SUM:
-                result = field_t(static_cast<int>(global_value));
-                break;
-            case AggregateOp::AVG:
-                result = field_t(global_count > 0 ? global_value / global_count : 0);
-                break;
-            case AggregateOp::MIN:
-                result = field_t(has_data ? static_cast<int>(min_value) : 0);
-                break;
-            case AggregateOp::MAX:
-                result = field_t(has_data ? static_cast<int>(max_value) : 0);
-                break;
-            case AggregateOp::COUNT:
-                result = field_t(global_count);
+        return results;
+    }
+};
+} // namespace
+
+void db::aggregate(const DbFile &input, DbFile &output, const Aggregate &agg) {
+    const auto &schema = input.getTupleDesc();//Schema
+    size_t value_idx = schema.index_of(agg.field);
+    //Only the aggregated field and the group field are decoded from the records.
+    std::vector<std::string> names = {agg.field};
+    if (agg.group.has_value()) {
+        names.push_back(agg.group.value());
+    }
+    std::vector<size_t> columns = columnsOf(schema, names);
+    Aggregator aggregator(schema.project(columns), agg);
+    QueryStep step("Aggregate(" + input.getName() + ")", {&input});
+    auto visit = [&](const Tuple &record) {
+        step.read(0);
+        aggregator.add(record);
+    };
+
+//---Skip Pages: a global MIN or MAX over a heap file visits the pages in the order of their zone map bound (lowest
+//minimum or highest maximum first) and stops at the first page whose bound cannot improve the current result.
+    const auto *heap = dynamic_cast<const HeapFile *>(&input);
+    bool prune = heap != nullptr && !agg.group.has_value() && (agg.op == AggregateOp::MIN || agg.op == AggregateOp::MAX) &&
+                 schema.type_of(value_idx) != type_t::CHAR;
+    if (prune) {
+        const ZoneMap &zones = heap->getZoneMap();
+        auto bound = [&](size_t page) {
+            const ZoneRange *range = zones.range(page, value_idx);
+            return agg.op == AggregateOp::MIN ? range->min : -range->max;
+        };
+        std::vector<size_t> pages(heap->getNumPages());
+        std::iota(pages.begin(), pages.end(), 0);
+        std::stable_sort(pages.begin(), pages.end(), [&](size_t a, size_t b) { return bound(a) < bound(b); });
+        for (size_t page : pages) {
+            if (bound(page) >= aggregator.best()) {
                 break;
-            default:
-                throw std::runtime_error("Unsupported aggregation operation");
+            }
+            scanPage(*heap, page, columns, visit);
+        }
+    } else {
+        for (auto it = input.begin(columns); it != input.end(); ++it) {
+            visit(*it);
         }
-        output.insertTuple(Tuple({result}));
-    }
-}
-
-//create a new table (output) that contains records formed by combining rows from two input tables where a specified condition holds true
-void db::join(const DbFile &left, const DbFile &right, DbFile &output, const JoinPredicate &predicate) {
-    const TupleDesc &left_desc = left.getTupleDesc(), &right_desc = right.getTupleDesc();
-    size_t left_idx = left_desc.index_of(predicate.left), right_idx = right_desc.index_of(predicate.right);
-    bool eliminate_duplicates = (predicate.op == PredicateOp::EQ);
-
-//Extract Left Field: The value of the field to be compared is extracted from the current left_record based on the index.
-    for (const auto &left_record : left) {
-        const field_t &left_field = left_record.get_field(left_idx);
-      //compares the value of left_field with the corresponding field value from right_record (right_record.get_field(right_idx)) based on the predicate.op
-        for (const auto &right_record : right) {
-            if (evaluateCondition(left_field, predicate.op, right_record.get_field(right_idx))) {
- //---Combining Records
-                std::vector<field_t> combined_fields;
-                for (size_t i = 0; i < left_record.size(); ++i) {
-                    combined_fields.push_back(left_record.get_field(i));
-                }//All fields from left_record are added to combined_fields, preserving their original order.
-                for (size_t i = 0; i < right_desc.size(); ++i) {
-                    if (i != right_idx || !eliminate_duplicates) {//decide whether or not to add a particular field from the right_record to the combined_fields.
-                        combined_fields.push_back(right_record.get_field(i));
-                    }
-                }//The condition allows all fields except the one used for joining to be added, if eliminate_duplicates is true and i == right_idx. Otherwise, all fields are added.
-                output.insertTuple(Tuple(combined_fields));
+    }
+//---Insertion
+    for (const auto &result : aggregator.results()) {
+        output.insertTuple(result);
+        step.wrote();
+    }
+}
+
+void db::aggregate(const DbFile &input, DbFile &output, const std::vector<std::string> &group_by,
+                   const std::vector<AggregateTerm> &terms, size_t num_threads) {
+    const auto *heap = dynamic_cast<const HeapFile *>(&input);
+    num_threads = parallelScannable(input) ? parallelism(input.getNumPages(), num_threads) : 1;
+    QueryStep step("Aggregate(" + input.getName() + ")", {&input});
+
+    if (num_threads == 1) {
+        //The records of a heap file are aggregated from their serialized bytes, and those of a column file from the
+        //columns of the groups and the terms copied next to each other. Other files only decode these fields.
+        std::vector<std::string> names = group_by;
+        for (const auto &term : terms) {
+            names.push_back(term.field);
+        }
+        std::vector<size_t> columns = columnsOf(input.getTupleDesc(), names);
+        const auto *column_file = dynamic_cast<const ColumnFile *>(&input);
+        bool serialized = heap != nullptr || column_file != nullptr;
+        HashAggregator aggregator(serialized ? input.getTupleDesc() : input.getTupleDesc().project(columns), group_by,
+                                  terms);
+        if (heap != nullptr) {
+            for (size_t page = 0; page < heap->getNumPages(); page++) {
+                scanPageData(*heap, page, [&](const uint8_t *data) {
+                    step.read(0);
+                    aggregator.add(data);
+                });
+            }
+        } else if (column_file != nullptr && aggregator.canAddColumns()) {
+            //Without groups, the columns of the terms are reduced a page at a time by the column kernels.
+            std::vector<uint8_t> selected;
+            std::vector<std::vector<uint8_t>> buffers(terms.size());
+            std::vector<const uint8_t *> values(terms.size());
+            column_file->scanPages([&](const ColumnPage &cp) {
+                cp.occupancy(selected);
+                if (step.active()) {
+                    step.read(0, countSelected(selected.data(), selected.size()));
+                }
+                for (size_t i = 0; i < terms.size(); i++) {
+                    values[i] = terms[i].op == AggregateOp::COUNT
+                                    ? nullptr
+                                    : cp.values(input.getTupleDesc().index_of(terms[i].field), buffers[i]);
+                }
+                aggregator.addColumns(values, selected.data(), selected.size());
+            });
+        } else if (column_file != nullptr) {
+            Page row{};
+            column_file->scanPages([&](const ColumnPage &cp) {
+                for (size_t slot = cp.begin(); slot != cp.end(); cp.next(slot)) {
+                    cp.gather(slot, columns, row.data());
+                    step.read(0);
+                    aggregator.add(row.data());
+                }
+            });
+        } else {
+            for (auto it = input.begin(columns); it != input.end(); ++it) {
+                step.read(0);
+                aggregator.add(*it);
+            }
+        }
+        for (const auto &result : aggregator.results()) {
+            output.insertTuple(result);
+            step.wrote();
+        }
+        return;
+    }
+
+//---Scan: every thread aggregates the pages it reads into its own table.
+    std::vector<std::unique_ptr<HashAggregator>> partials;
+    for (size_t i = 0; i < num_threads; i++) {
+        partials.push_back(std::make_unique<HashAggregator>(input.getTupleDesc(), group_by, terms));
+    }
+    size_t records =
+        parallelScan(input, num_threads, [&](size_t thread, const uint8_t *data) { partials[thread]->add(data); });
+    step.read(0, records);
+//---Merge: thread p combines partition p of the groups of every partial table, so no group is touched by two threads.
+    std::vector<std::unique_ptr<HashAggregator>> merged;
+    std::vector<std::vector<Tuple>> results(num_threads);
+    for (size_t i = 0; i < num_threads; i++) {
+        merged.push_back(std::make_unique<HashAggregator>(input.getTupleDesc(), group_by, terms));
+    }
+    getScheduler().run(num_threads, 1, num_threads, [&](size_t, Morsel morsel) {
+        for (size_t partition = morsel.first; partition < morsel.last; partition++) {
+            for (const auto &partial : partials) {
+                merged[partition]->merge(*partial, partition, num_threads);
             }
+            results[partition] = merged[partition]->results();
+        }
+    });
+
+    //Without groups, every partition but the one holding the single group reports an empty input.
+    if (group_by.empty()) {
+        size_t partition = 0;
+        while (partition + 1 < num_threads && merged[partition]->size() == 0) {
+            partition++;
         }
+        results = {results[partition]};
+    }
+    for (const auto &partition : results) {
+        for (const auto &result : partition) {
+            output.insertTuple(result);
+        }
+        step.wrote(partition.size());
+    }
+}
+
+AggregateOperator::AggregateOperator(std::unique_ptr<Operator> child, const Aggregate &agg)
+    : child(std::move(child)), agg(agg) {
+    const TupleDesc &child_td = this->child->getTupleDesc();
+    std::string name = HashAggregator::nameOf({agg.op, agg.field});
+    child_td.index_of(agg.field);//Throws if the aggregated field does not exist
+    if (agg.group.has_value()) {
+        size_t group_idx = child_td.index_of(agg.group.value());
+        td = TupleDesc({child_td.type_of(group_idx), type_t::DOUBLE}, {agg.group.value(), name});
+    } else {
+        td = TupleDesc({agg.op == AggregateOp::AVG ? type_t::DOUBLE : type_t::INT}, {name});
     }
 }
+
+const TupleDesc &AggregateOperator::getTupleDesc() const { return td; }
+
+void AggregateOperator::open() {
+    Aggregator aggregator(child->getTupleDesc(), agg);
+    child->open();
+    while (auto t = child->next()) {
+        aggregator.add(*t);
+    }
+    child->close();
+    results = aggregator.results();
+    pos = 0;
+}
+
+std::optional<Tuple> AggregateOperator::next() {
+    if (pos == results.size()) {
+        return std::nullopt;
+    }
+    return results[pos++];
+}
+
+void AggregateOperator::close() {
+    results.clear();
+    pos = 0;
+}
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <db/Scheduler.hpp>
+#include <deque>
+#include <utility>
+
+using namespace db;
+
+namespace {
+//The number of the worker running on this thread, or NONE on other threads.
+constexpr size_t NONE = static_cast<size_t>(-1);
+thread_local size_t current_worker = NONE;
+} // namespace
+
+//The morsels dealt to a worker. The owner takes them from the front and thieves from the back.
+class Scheduler::Queue {
+  std::mutex mutex;
+  std::deque<Morsel> morsels;
+
+public:
+  void push(Morsel morsel) {
+    std::lock_guard lock(mutex);
+    morsels.push_back(morsel);
+  }
+
+  bool pop(Morsel &morsel) {
+    std::lock_guard lock(mutex);
+    if (morsels.empty()) {
+      return false;
+    }
+    morsel = morsels.front();
+    morsels.pop_front();
+    return true;
+  }
+
+  bool steal(Morsel &morsel) {
+    std::lock_guard lock(mutex);
+    if (morsels.empty()) {
+      return false;
+    }
+    morsel = morsels.back();
+    morsels.pop_back();
+    return true;
+  }
+
+  void clear() {
+    std::lock_guard lock(mutex);
+    morsels.clear();
+  }
+};
+
+Scheduler::Scheduler() = default;
+
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+size_t Scheduler::size() const {
+  std::lock_guard lock(mutex);
+  return threads.size();
+}
+
+bool Scheduler::take(size_t worker, Morsel &morsel) {
+  if (queues[worker]->pop(morsel)) {
+    return true;
+  }
+  //The victims are tried in order from the next worker, so that thieves spread over different deques.
+  for (size_t i = 1; i < job_workers; i++) {
+    if (queues[(worker + i) % job_workers]->steal(morsel)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Scheduler::work(size_t worker) {
+  current_worker = worker;
+  size_t seen = 0;
+  while (true) {
+    {
+      std::unique_lock lock(mutex);
+      wake.wait(lock, [&] { return stopping || (generation != seen && worker < job_workers); });
+      if (stopping) {
+        return;
+      }
+      seen = generation;
+    }
+    Morsel morsel;
+    while (take(worker, morsel)) {
+      try {
+        (*task)(worker, morsel);
+      } catch (...) {
+        //The first error stops the job: the morsels left are dropped and the other workers finish their current one.
+        std::lock_guard lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        for (size_t i = 0; i < job_workers; i++) {
+          queues[i]->clear();
+        }
+      }
+    }
+    std::lock_guard lock(mutex);
+    if (--active == 0) {
+      done.notify_all();
+    }
+  }
+}
+
+void Scheduler::run(size_t items, size_t morsel_size, size_t num_workers,
+                    const std::function<void(size_t, Morsel)> &task) {
+  morsel_size = std::max<size_t>(morsel_size, 1);
+  size_t num_morsels = (items + morsel_size - 1) / morsel_size;
+  num_workers = std::clamp<size_t>(num_workers, 1, std::max<size_t>(num_morsels, 1));
+  //A single worker, or a job submitted by a task, runs on the calling thread.
+  if (num_workers == 1 || current_worker != NONE) {
+    for (size_t first = 0; first < items; first += morsel_size) {
+      task(0, {first, std::min(first + morsel_size, items)});
+    }
+    return;
+  }
+
+  std::lock_guard job(job_mutex);
+  {
+    std::lock_guard lock(mutex);
+    while (threads.size() < num_workers) {
+      queues.push_back(std::make_unique<Queue>());
+      threads.emplace_back(&Scheduler::work, this, threads.size());
+    }
+  }
+  //Worker w gets the morsels of the w-th block of consecutive items.
+  for (size_t w = 0; w < num_workers; w++) {
+    for (size_t m = num_morsels * w / num_workers; m < num_morsels * (w + 1) / num_workers; m++) {
+      queues[w]->push({m * morsel_size, std::min((m + 1) * morsel_size, items)});
+    }
+  }
+
+  std::unique_lock lock(mutex);
+  this->task = &task;
+  job_workers = num_workers;
+  active = num_workers;
+  error = nullptr;
+  generation++;
+  wake.notify_all();
+  done.wait(lock, [&] { return active == 0; });
+  this->task = nullptr;
+  job_workers = 0;
+  if (error) {
+    std::rethrow_exception(std::exchange(error, nullptr));
+  }
+}
+
+Scheduler &db::getScheduler() {
+  static Scheduler scheduler;
+  return scheduler;
+}
@@ -0,0 +1,179 @@
+#include <db/BTreeFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/HeapPage.hpp>
+#include <db/IndexPage.hpp>
+#include <db/LeafPage.hpp>
+#include <db/Snapshot.hpp>
+#include <numeric>
+#include <stdexcept>
+
+using namespace db;
+
+namespace {
+//The page of the root of a BTreeFile, which is also the page of its end iterator.
+constexpr size_t ROOT_ID = 0;
+} // namespace
+
+Snapshot::Snapshot(std::unordered_map<std::string, size_t> num_pages)
+    : time(getDatabase().getBufferPool().openSnapshot(num_pages)), num_pages(std::move(num_pages)) {}
+
+Snapshot::~Snapshot() { getDatabase().getBufferPool().closeSnapshot(time); }
+
+Timestamp Snapshot::getTime() const { return time; }
+
+size_t Snapshot::getNumPages(const std::string &file) const {
+  auto it = num_pages.find(file);
+  if (it == num_pages.end()) {
+    throw std::logic_error("File is not in the snapshot");
+  }
+  return it->second;
+}
+
+void Snapshot::readPage(const DbFile &file, Page &page, size_t id) const {
+  getDatabase().getBufferPool().readVersion(file, id, time, page);
+}
+
+SnapshotFile::SnapshotFile(const DbFile &file, std::shared_ptr<const Snapshot> snapshot)
+    : DbFile(file.getName(), file.getTupleDesc()), snapshot(std::move(snapshot)) {
+  if (const auto *btree = dynamic_cast<const BTreeFile *>(&file)) {
+    key_index = btree->getKeyIndex();
+    key_width = btree->getKeyWidth();
+  } else if (dynamic_cast<const HeapFile *>(&file) == nullptr) {
+    throw std::logic_error("Only HeapFiles and BTreeFiles have snapshots");
+  }
+  numPages = this->snapshot->getNumPages(name);
+}
+
+const Snapshot &SnapshotFile::getSnapshot() const { return *snapshot; }
+
+const std::optional<size_t> &SnapshotFile::getKeyIndex() const { return key_index; }
+
+void SnapshotFile::readVersion(Page &page, size_t id) const { snapshot->readPage(*this, page, id); }
+
+template <typename F> auto SnapshotFile::withPage(size_t id, F f) const {
+  std::lock_guard lock(cache_mutex);
+  if (cached_id != id) {
+    readVersion(cached, id);
+    cached_id = id;
+  }
+  return f(cached);
+}
+
+std::vector<size_t> SnapshotFile::dataPages() const {
+  if (!key_index) {
+    std::vector<size_t> pages(numPages);
+    std::iota(pages.begin(), pages.end(), 0);
+    return pages;
+  }
+  Page page;
+  std::vector<size_t> level{ROOT_ID};
+  while (true) {
+    std::vector<size_t> children;
+    bool leaves = false;
+    for (size_t id : level) {
+      readVersion(page, id);
+      IndexPage node(page, key_width);
+      leaves = !node.header->index_children;
+      for (size_t i = 0; i <= node.header->size; i++) {
+        // An empty tree has no leaf yet
+        if (node.children[i] != ROOT_ID) {
+          children.push_back(node.children[i]);
+        }
+      }
+    }
+    if (leaves) {
+      return children;
+    }
+    level = std::move(children);
+  }
+}
+
+void SnapshotFile::insertTuple(const Tuple &) { throw std::logic_error("A snapshot is read-only"); }
+
+void SnapshotFile::deleteTuple(const Iterator &) { throw std::logic_error("A snapshot is read-only"); }
+
+Tuple SnapshotFile::getTuple(const Iterator &it) const {
+  return withPage(it.page, [&](Page &page) {
+    if (key_index) {
+      return LeafPage(page, td, *key_index).getTuple(it.slot);
+    }
+    return HeapPage(page, td).getTuple(it.slot);
+  });
+}
+
+Tuple SnapshotFile::getTuple(const Iterator &it, const std::vector<size_t> &fields) const {
+  return withPage(it.page, [&](Page &page) {
+    if (key_index) {
+      return LeafPage(page, td, *key_index).getTuple(it.slot, fields);
+    }
+    const HeapPage hp(page, td);
+    return td.deserialize(hp.getData(it.slot), fields);
+  });
+}
+
+void SnapshotFile::seekTuple(Iterator &it) const {
+  if (key_index) {
+    //Follow the leaf chain past the end of each leaf, as BTreeFile::seekTuple does.
+    while (it.page != ROOT_ID) {
+      bool found = withPage(it.page, [&](Page &page) {
+        LeafPage leaf(page, td, *key_index);
+        if (it.slot < leaf.header->size) {
+          return true;
+        }
+        it.page = leaf.header->next_leaf;
+        it.slot = 0;
+        return false;
+      });
+      if (found) {
+        return;
+      }
+    }
+    return;
+  }
+  //Find the first occupied slot from it.slot on, skipping empty pages as HeapFile::next does.
+  while (it.page < numPages) {
+    bool found = withPage(it.page, [&](Page &page) {
+      const HeapPage hp(page, td);
+      while (it.slot < hp.end() && hp.empty(it.slot)) {
+        it.slot++;
+      }
+      return it.slot < hp.end();
+    });
+    if (found) {
+      return;
+    }
+    it.page++;
+    it.slot = 0;
+  }
+  it.slot = 0;
+}
+
+void SnapshotFile::next(Iterator &it) const {
+  it.slot++;
+  seekTuple(it);
+}
+
+Iterator SnapshotFile::begin() const {
+  if (!key_index) {
+    Iterator it{*this, 0, 0};
+    seekTuple(it);
+    return it;
+  }
+  size_t id = ROOT_ID;
+  while (true) {
+    bool index_children = withPage(id, [&](Page &page) {
+      IndexPage node(page, key_width);
+      id = node.children[0];
+      return node.header->index_children;
+    });
+    if (!index_children) {
+      break;
+    }
+  }
+  Iterator it{*this, id, 0};
+  seekTuple(it);
+  return it;
+}
+
+Iterator SnapshotFile::end() const { return {*this, key_index ? ROOT_ID : numPages, 0}; }
@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <db/Metrics.hpp>
+#include <db/SpillFile.hpp>
+#include <filesystem>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace db;
+
+namespace {
+uint64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+} // namespace
+
+SpillFile::SpillFile(const TupleDesc &td) : td(td), per_page(DEFAULT_PAGE_SIZE / td.length()) {
+  std::string path = (std::filesystem::temp_directory_path() / "db-spill-XXXXXX").string();
+  fd = mkstemp(path.data());
+  if (fd == -1) {
+    throw std::runtime_error("mkstemp");
+  }
+  unlink(path.c_str());
+}
+
+SpillFile::~SpillFile() { close(fd); }
+
+void SpillFile::readPage(Page &page, size_t id) const {
+  auto start = std::chrono::steady_clock::now();
+  if (pread(fd, page.data(), DEFAULT_PAGE_SIZE, id * DEFAULT_PAGE_SIZE) != DEFAULT_PAGE_SIZE) {
+    throw std::runtime_error("pread");
+  }
+  metrics.recordRead(elapsedNs(start));
+}
+
+void SpillFile::append(const Tuple &t) {
+  td.serialize(buffer.data() + buffered * td.length(), t);
+  flushIfFull();
+}
+
+void SpillFile::append(const uint8_t *data) {
+  std::memcpy(buffer.data() + buffered * td.length(), data, td.length());
+  flushIfFull();
+}
+
+void SpillFile::flushIfFull() {
+  count++;
+  if (++buffered < per_page) {
+    return;
+  }
+  auto start = std::chrono::steady_clock::now();
+  if (pwrite(fd, buffer.data(), DEFAULT_PAGE_SIZE, pages * DEFAULT_PAGE_SIZE) != DEFAULT_PAGE_SIZE) {
+    throw std::runtime_error("pwrite");
+  }
+  metrics.recordWrite(elapsedNs(start));
+  pages++;
+  buffered = 0;
+}
+
+size_t SpillFile::size() const { return count; }
+
+size_t SpillFile::getNumPages() const { return pages + (buffered > 0 ? 1 : 0); }
+
+const TupleDesc &SpillFile::getTupleDesc() const { return td; }
+
+const FileMetrics &SpillFile::getIoMetrics() const { return metrics; }
+
+SpillFile::Cursor::Cursor(const SpillFile &file) : file(file) {}
+
+bool SpillFile::Cursor::done() const { return index == file.count; }
+
+Tuple SpillFile::Cursor::next() {
+  size_t id = index / file.per_page, slot = index % file.per_page;
+  index++;
+  if (id == file.pages) {
+    return file.td.deserialize(file.buffer.data() + slot * file.td.length());
+  }
+  if (slot == 0) {
+    file.readPage(page, id);
+  }
+  return file.td.deserialize(page.data() + slot * file.td.length());
+}
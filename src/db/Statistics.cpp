@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <db/Hash.hpp>
+#include <db/Predicate.hpp>
+#include <db/Statistics.hpp>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+using namespace db;
+
+void HyperLogLog::add(const field_t &value) {
+  uint64_t hash = mix(std::hash<field_t>{}(value));
+  size_t index = hash >> (64 - BITS);
+  uint64_t rest = hash << BITS;
+  auto rank = static_cast<uint8_t>(rest == 0 ? 64 - BITS + 1 : std::countl_zero(rest) + 1);
+  registers[index] = std::max(registers[index], rank);
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+  for (size_t i = 0; i < registers.size(); i++) {
+    registers[i] = std::max(registers[i], other.registers[i]);
+  }
+}
+
+double HyperLogLog::estimate() const {
+  const double m = registers.size();
+  double sum = 0;
+  size_t zeros = 0;
+  for (uint8_t r : registers) {
+    sum += std::ldexp(1.0, -r);
+    zeros += r == 0;
+  }
+  double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+  //Linear counting is more accurate while many registers are still empty.
+  if (estimate <= 2.5 * m && zeros > 0) {
+    estimate = m * std::log(m / zeros);
+  }
+  return estimate;
+}
+
+namespace {
+double toDouble(const field_t &value) {
+  return std::holds_alternative<int>(value) ? std::get<int>(value) : std::get<double>(value);
+}
+} // namespace
+
+double ColumnStats::selectivity(PredicateOp op, const field_t &operand) const {
+  if (count == 0) {
+    return 0;
+  }
+  //A comparison with a value of another type only depends on the types.
+  if (operand.index() != min.index()) {
+    return evaluateCondition(min, op, operand) ? 1 : 0;
+  }
+
+  //The fraction of values equal to the operand: a value that is the bound of several buckets fills all but one of them,
+  //otherwise the values are assumed to be spread evenly over the distinct values.
+  double equal = 0;
+  if (min <= operand && operand <= max) {
+    auto [first, last] = std::equal_range(bounds.begin(), bounds.end(), operand);
+    double buckets = bounds.empty() ? 0 : static_cast<double>(last - first - 1) / bounds.size();
+    equal = std::max(1 / std::max(distinct, 1.0), buckets);
+  }
+  //The fraction of values less than the operand: the buckets whose bound is less than the operand, and the part of the
+  //bucket holding the operand that is below it (interpolated for numbers, half of it for strings).
+  double less = 0;
+  if (operand > max) {
+    less = 1;
+  } else if (operand > min && !bounds.empty()) {
+    size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), operand) - bounds.begin();
+    const field_t &low = bucket == 0 ? min : bounds[bucket - 1];
+    const field_t &high = bounds[bucket];
+    double part = 0.5;
+    if (!std::holds_alternative<std::string>(operand)) {
+      double width = toDouble(high) - toDouble(low);
+      part = width > 0 ? (toDouble(operand) - toDouble(low)) / width : 0;
+    }
+    less = (bucket + part) / bounds.size();
+  }
+
+  double result = 0;
+  switch (op) {
+  case PredicateOp::EQ:
+    result = equal;
+    break;
+  case PredicateOp::NE:
+    result = 1 - equal;
+    break;
+  case PredicateOp::LT:
+    result = less;
+    break;
+  case PredicateOp::LE:
+    result = less + equal;
+    break;
+  case PredicateOp::GT:
+    result = 1 - less - equal;
+    break;
+  case PredicateOp::GE:
+    result = 1 - less;
+    break;
+  }
+  return std::clamp(result, 0.0, 1.0);
+}
+
+double TableStats::selectivity(const TupleDesc &td, const Predicate &pred) const {
+  switch (pred.getKind()) {
+  case Predicate::Kind::COMPARE:
+    return columns.at(td.index_of(pred.getField())).selectivity(pred.getOp(), pred.getValues()[0]);
+  case Predicate::Kind::IN: {
+    const ColumnStats &column = columns.at(td.index_of(pred.getField()));
+    std::vector<field_t> values = pred.getValues();
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    double result = 0;
+    for (const auto &value : values) {
+      result += column.selectivity(PredicateOp::EQ, value);
+    }
+    return std::min(result, 1.0);
+  }
+  case Predicate::Kind::AND: {
+    double result = 1;
+    for (const auto &child : pred.getChildren()) {
+      result *= selectivity(td, child);
+    }
+    return result;
+  }
+  case Predicate::Kind::OR: {
+    double none = 1;
+    for (const auto &child : pred.getChildren()) {
+      none *= 1 - selectivity(td, child);
+    }
+    return 1 - none;
+  }
+  case Predicate::Kind::NOT:
+    return 1 - selectivity(td, pred.getChildren()[0]);
+  }
+  throw std::logic_error("Unknown predicate");
+}
+
+namespace {
+constexpr char MAGIC[8] = {'D', 'B', 'S', 'T', 'A', 'T', 'S', '1'};
+
+template <typename T> void write(std::ostream &out, T value) { out.write(reinterpret_cast<const char *>(&value), sizeof(value)); }
+
+template <typename T> T read(std::istream &in) {
+  T value{};
+  in.read(reinterpret_cast<char *>(&value), sizeof(value));
+  return value;
+}
+
+//Fields are written with the width they have in a page.
+void writeField(std::ostream &out, type_t type, const field_t &value) {
+  switch (type) {
+  case type_t::INT:
+    write(out, std::get<int>(value));
+    break;
+  case type_t::DOUBLE:
+    write(out, std::get<double>(value));
+    break;
+  case type_t::CHAR: {
+    const std::string &str = std::get<std::string>(value);
+    char chars[CHAR_SIZE]{};
+    std::memcpy(chars, str.data(), std::min(str.size(), CHAR_SIZE));
+    out.write(chars, CHAR_SIZE);
+    break;
+  }
+  }
+}
+
+field_t readField(std::istream &in, type_t type) {
+  switch (type) {
+  case type_t::INT:
+    return read<int>(in);
+  case type_t::DOUBLE:
+    return read<double>(in);
+  case type_t::CHAR: {
+    char chars[CHAR_SIZE]{};
+    in.read(chars, CHAR_SIZE);
+    return std::string(chars, strnlen(chars, CHAR_SIZE));
+  }
+  }
+  throw std::logic_error("Unknown field type");
+}
+} // namespace
+
+void TableStats::save(const std::string &path, const TupleDesc &td) const {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(MAGIC, sizeof(MAGIC));
+  write<uint64_t>(out, rows);
+  write<uint64_t>(out, pages);
+  write<uint64_t>(out, columns.size());
+  for (size_t i = 0; i < columns.size(); i++) {
+    const ColumnStats &column = columns[i];
+    type_t type = td.type_of(i);
+    write<uint64_t>(out, column.count);
+    write<uint64_t>(out, column.nulls);
+    write(out, column.distinct);
+    writeField(out, type, column.min);
+    writeField(out, type, column.max);
+    write<uint64_t>(out, column.bounds.size());
+    for (const auto &bound : column.bounds) {
+      writeField(out, type, bound);
+    }
+  }
+  if (!out) {
+    throw std::runtime_error("Cannot write statistics");
+  }
+}
+
+bool TableStats::load(const std::string &path, const TupleDesc &td) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  char magic[sizeof(MAGIC)]{};
+  in.read(magic, sizeof(magic));
+  TableStats stats;
+  stats.rows = read<uint64_t>(in);
+  stats.pages = read<uint64_t>(in);
+  if (!in || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || read<uint64_t>(in) != td.size()) {
+    throw std::runtime_error("Invalid statistics file");
+  }
+  for (size_t i = 0; i < td.size(); i++) {
+    ColumnStats &column = stats.columns.emplace_back();
+    type_t type = td.type_of(i);
+    column.count = read<uint64_t>(in);
+    column.nulls = read<uint64_t>(in);
+    column.distinct = read<double>(in);
+    column.min = readField(in, type);
+    column.max = readField(in, type);
+    auto buckets = read<uint64_t>(in);
+    for (size_t b = 0; b < buckets && in; b++) {
+      column.bounds.push_back(readField(in, type));
+    }
+  }
+  if (!in) {
+    throw std::runtime_error("Invalid statistics file");
+  }
+  *this = std::move(stats);
+  return true;
+}
+
+TableStats db::analyze(const DbFile &input, size_t buckets) {
+  const TupleDesc &td = input.getTupleDesc();
+  TableStats stats;
+  stats.pages = input.getNumPages();
+  stats.columns.resize(td.size());
+  //An empty column has any value of its type as its minimum and maximum.
+  for (size_t i = 0; i < td.size(); i++) {
+    stats.columns[i].min = stats.columns[i].max = sampleOf(td.type_of(i));
+  }
+  std::vector<HyperLogLog> sketches(td.size());
+
+  //Reservoir sampling: the n-th row replaces a random sampled row with probability ANALYZE_SAMPLE_SIZE / n.
+  std::vector<Tuple> sample;
+  std::mt19937_64 rng(ANALYZE_SAMPLE_SIZE);
+  for (const auto &record : input) {
+    stats.rows++;
+    for (size_t i = 0; i < td.size(); i++) {
+      ColumnStats &column = stats.columns[i];
+      const field_t &value = record.get_field(i);
+      if (column.count++ == 0) {
+        column.min = column.max = value;
+      } else if (value < column.min) {
+        column.min = value;
+      } else if (column.max < value) {
+        column.max = value;
+      }
+      sketches[i].add(value);
+    }
+    if (sample.size() < ANALYZE_SAMPLE_SIZE) {
+      sample.push_back(record);
+    } else if (size_t j = rng() % stats.rows; j < ANALYZE_SAMPLE_SIZE) {
+      sample[j] = record;
+    }
+  }
+
+  std::vector<field_t> values;
+  for (size_t i = 0; i < td.size(); i++) {
+    ColumnStats &column = stats.columns[i];
+    column.distinct = std::clamp(sketches[i].estimate(), column.count > 0 ? 1.0 : 0.0, double(column.count));
+    values.clear();
+    for (const auto &record : sample) {
+      values.push_back(record.get_field(i));
+    }
+    std::sort(values.begin(), values.end());
+    size_t count = std::min(buckets, values.size());
+    for (size_t b = 1; b <= count; b++) {
+      column.bounds.push_back(values[b * values.size() / count - 1]);
+    }
+    //The sample may miss the largest value.
+    if (!column.bounds.empty()) {
+      column.bounds.back() = column.max;
+    }
+  }
+  return stats;
+}
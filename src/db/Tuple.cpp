@@ -24,7 +24,8 @@ size_t Tuple::size() const { return fields.size(); }
 
 const field_t &Tuple::get_field(size_t i) const { return fields.at(i); }
 
-TupleDesc::TupleDesc(const std::vector<type_t> &types, const std::vector<std::string> &names) : types(types) {
+TupleDesc::TupleDesc(const std::vector<type_t> &types, const std::vector<std::string> &names)
+    : types(types), names(names) {
   if (types.size() != names.size()) {
     throw std::logic_error("Types and names sizes do not match");
   }
@@ -65,6 +66,10 @@ bool TupleDesc::compatible(const Tuple &tuple) const {
 
 size_t TupleDesc::offset_of(const size_t &index) const { return offsets.at(index); }
 
+type_t TupleDesc::type_of(const size_t &index) const { return types.at(index); }
+
+const std::string &TupleDesc::name_of(const size_t &index) const { return names.at(index); }
+
 size_t TupleDesc::index_of(const std::string &name) const { return name_to_index.at(name); }
 
 size_t TupleDesc::length() const {
@@ -87,6 +92,36 @@ size_t TupleDesc::length() const {
 
 size_t TupleDesc::size() const { return types.size(); }
 
+Tuple TupleDesc::deserialize(const uint8_t *data, const std::vector<size_t> &fields) const {
+  std::vector<field_t> values;
+  values.reserve(fields.size());
+  for (size_t field : fields) {
+    const uint8_t *field_data = data + offsets.at(field);
+    switch (types[field]) {
+    case type_t::INT:
+      values.emplace_back(*reinterpret_cast<const int *>(field_data));
+      break;
+    case type_t::DOUBLE:
+      values.emplace_back(*reinterpret_cast<const double *>(field_data));
+      break;
+    case type_t::CHAR:
+      values.emplace_back(std::string(reinterpret_cast<const char *>(field_data)));
+      break;
+    }
+  }
+  return {values};
+}
+
+TupleDesc TupleDesc::project(const std::vector<size_t> &fields) const {
+  std::vector<type_t> projected_types;
+  std::vector<std::string> projected_names;
+  for (size_t field : fields) {
+    projected_types.push_back(types.at(field));
+    projected_names.push_back(names.at(field));
+  }
+  return {projected_types, projected_names};
+}
+
 Tuple TupleDesc::deserialize(const uint8_t *data) const {
   std::vector<field_t> fields;
   fields.reserve(types.size());
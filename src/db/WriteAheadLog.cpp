@@ -0,0 +1,436 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <db/WriteAheadLog.hpp>
+#include <fcntl.h>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace db;
+
+namespace {
+constexpr uint64_t MAGIC = 0x314c41574244ULL;//"DBWAL1"
+/// The magic number and the LSN of the first record
+constexpr size_t HEADER_SIZE = 2 * sizeof(uint64_t);
+/// The size and the CRC of the content of a record
+constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+/// Ranges that are closer than this are logged as one, which costs less than the header of another range
+constexpr size_t MERGE_GAP = 8;
+
+enum class RecordType : uint8_t { PAGE = 1, COMMIT = 2 };
+
+constexpr std::array<uint32_t, 256> CRC_TABLE = [] {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}();
+
+uint32_t crc32(const uint8_t *data, size_t size) {
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < size; i++) {
+    crc = CRC_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+template <typename T> void put(std::vector<uint8_t> &out, T value) {
+  const auto *bytes = reinterpret_cast<const uint8_t *>(&value);
+  out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+//Reads the fields of a record, and fails once the record is exhausted.
+struct Reader {
+  const uint8_t *data;
+  size_t size, pos = 0;
+
+  template <typename T> T get() {
+    T value;
+    bytes(&value, sizeof(T));
+    return value;
+  }
+
+  void bytes(void *out, size_t n) {
+    if (pos + n > size) {
+      throw std::runtime_error("Truncated log record");
+    }
+    std::memcpy(out, data + pos, n);
+    pos += n;
+  }
+};
+
+void writeAll(int fd, const uint8_t *data, size_t size, size_t offset) {
+  while (size > 0) {
+    ssize_t written = pwrite(fd, data, size, static_cast<off_t>(offset));
+    if (written <= 0) {
+      throw std::runtime_error("Cannot write the log");
+    }
+    data += written;
+    size -= written;
+    offset += written;
+  }
+}
+
+//Make the creation or renaming of a file durable.
+void syncDirectory(const std::string &path) {
+  std::string dir = std::filesystem::path(path).parent_path();
+  int fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd == -1) {
+    throw std::runtime_error("Cannot open the directory of " + path);
+  }
+  int synced = fsync(fd);
+  close(fd);
+  if (synced == -1) {
+    throw std::runtime_error("Cannot sync the directory of " + path);
+  }
+}
+
+//A changed byte range of a page, with its bytes before and after the change.
+struct Change {
+  uint16_t offset, length;
+  const uint8_t *before, *after;
+};
+
+//A PAGE record read from the log.
+struct PageRecord {
+  std::string file;
+  uint64_t page;
+  std::vector<uint8_t> data;
+  std::vector<Change> changes;
+};
+} // namespace
+
+WriteAheadLog::WriteAheadLog(const std::string &path) : path(path) {
+  fd = open(path.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (fd == -1) {
+    throw std::runtime_error("open");
+  }
+  struct stat st{};
+  if (fstat(fd, &st) == -1) {
+    throw std::runtime_error("fstat");
+  }
+  if (st.st_size == 0) {
+    writeHeader();
+    return;
+  }
+  uint64_t header[2];
+  if (st.st_size < static_cast<off_t>(HEADER_SIZE) || pread(fd, header, HEADER_SIZE, 0) != HEADER_SIZE ||
+      header[0] != MAGIC) {
+    close(fd);
+    throw std::runtime_error("Not a write-ahead log: " + path);
+  }
+  //The records are not read until recover, which must run before anything is appended.
+  base = end = durable = committed = header[1];
+}
+
+WriteAheadLog::~WriteAheadLog() { close(fd); }
+
+void WriteAheadLog::writeHeader() {
+  uint64_t header[2] = {MAGIC, base};
+  writeAll(fd, reinterpret_cast<const uint8_t *>(header), HEADER_SIZE, 0);
+  if (fdatasync(fd) == -1) {
+    throw std::runtime_error("Cannot sync the log");
+  }
+}
+
+size_t WriteAheadLog::recover() {
+  struct stat st{};
+  if (fstat(fd, &st) == -1) {
+    throw std::runtime_error("fstat");
+  }
+  std::vector<uint8_t> log(st.st_size - HEADER_SIZE);
+  if (!log.empty() && pread(fd, log.data(), log.size(), HEADER_SIZE) != static_cast<ssize_t>(log.size())) {
+    throw std::runtime_error("Cannot read the log");
+  }
+
+//---Analysis: read the records up to the first torn one, and find the last commit.
+  std::vector<PageRecord> pages;
+  size_t committed = 0;
+  size_t pos = 0;
+  while (pos + RECORD_HEADER_SIZE <= log.size()) {
+    uint32_t size, crc;
+    std::memcpy(&size, log.data() + pos, sizeof(size));
+    std::memcpy(&crc, log.data() + pos + sizeof(size), sizeof(crc));
+    const uint8_t *content = log.data() + pos + RECORD_HEADER_SIZE;
+    if (size == 0 || pos + RECORD_HEADER_SIZE + size > log.size() || crc32(content, size) != crc) {
+      break;
+    }
+    pos += RECORD_HEADER_SIZE + size;
+    auto type = static_cast<RecordType>(content[0]);
+    if (type == RecordType::COMMIT) {
+      committed = pages.size();
+      continue;
+    }
+    if (type != RecordType::PAGE) {
+      break;
+    }
+    PageRecord record;
+    record.data.assign(content + 1, content + size);
+    Reader reader{record.data.data(), record.data.size()};
+    record.file.resize(reader.get<uint16_t>());
+    reader.bytes(record.file.data(), record.file.size());
+    record.page = reader.get<uint64_t>();
+    auto count = reader.get<uint16_t>();
+    for (uint16_t i = 0; i < count; i++) {
+      Change change{};
+      change.offset = reader.get<uint16_t>();
+      change.length = reader.get<uint16_t>();
+      if (reader.pos + 2 * change.length > reader.size || change.offset + change.length > DEFAULT_PAGE_SIZE) {
+        throw std::runtime_error("Invalid log record");
+      }
+      change.before = record.data.data() + reader.pos;
+      change.after = change.before + change.length;
+      reader.pos += 2 * change.length;
+      record.changes.push_back(change);
+    }
+    pages.push_back(std::move(record));
+  }
+
+//---Redo the changes up to the last commit, then undo the later ones in reverse order.
+  //The records of a file that no longer exists (e.g. removed after it was logged) are skipped, rather than applied
+  //to a new empty file.
+  std::map<std::string, int> files;
+  std::map<std::pair<std::string, uint64_t>, Page> images;
+  auto image = [&](const PageRecord &record) -> Page * {
+    auto [file, opened] = files.try_emplace(record.file, -1);
+    if (opened) {
+      file->second = open(record.file.c_str(), O_RDWR);
+      if (file->second == -1 && errno != ENOENT) {
+        throw std::runtime_error("Cannot open " + record.file);
+      }
+    }
+    if (file->second == -1) {
+      return nullptr;
+    }
+    auto [it, added] = images.try_emplace({record.file, record.page});
+    if (added) {
+      it->second.fill(0);
+      pread(file->second, it->second.data(), DEFAULT_PAGE_SIZE, record.page * DEFAULT_PAGE_SIZE);
+    }
+    return &it->second;
+  };
+  size_t applied = 0;
+  for (size_t i = 0; i < committed; i++) {
+    Page *page = image(pages[i]);
+    if (page == nullptr) {
+      continue;
+    }
+    for (const auto &change : pages[i].changes) {
+      std::memcpy(page->data() + change.offset, change.after, change.length);
+    }
+    applied++;
+  }
+  for (size_t i = pages.size(); i-- > committed;) {
+    Page *page = image(pages[i]);
+    if (page == nullptr) {
+      continue;
+    }
+    for (const auto &change : pages[i].changes) {
+      std::memcpy(page->data() + change.offset, change.before, change.length);
+    }
+    applied++;
+  }
+  for (const auto &[key, page] : images) {
+    writeAll(files.at(key.first), page.data(), DEFAULT_PAGE_SIZE, key.second * DEFAULT_PAGE_SIZE);
+  }
+  for (const auto &[name, file] : files) {
+    if (file == -1) {
+      continue;
+    }
+    if (fsync(file) == -1) {
+      throw std::runtime_error("Cannot sync " + name);
+    }
+    close(file);
+  }
+
+  //The LSNs continue after the records read, including the torn ones that are dropped.
+  end = durable = base + log.size();
+  truncate();
+  return applied;
+}
+
+Lsn WriteAheadLog::append(const std::vector<uint8_t> &content) {
+  std::lock_guard lock(mutex);
+  put<uint32_t>(buffer, content.size());
+  put<uint32_t>(buffer, crc32(content.data(), content.size()));
+  buffer.insert(buffer.end(), content.begin(), content.end());
+  end += RECORD_HEADER_SIZE + content.size();
+  records.fetch_add(1, std::memory_order_relaxed);
+  return end;
+}
+
+std::optional<Lsn> WriteAheadLog::logPage(const PageId &pid, const Page &before, const Page &after) {
+  //The changed ranges are found 8 bytes at a time, and ranges separated by a few equal bytes are merged.
+  std::vector<std::pair<size_t, size_t>> ranges;
+  for (size_t i = 0; i < DEFAULT_PAGE_SIZE; i += sizeof(uint64_t)) {
+    if (std::memcmp(before.data() + i, after.data() + i, sizeof(uint64_t)) == 0) {
+      continue;
+    }
+    size_t first = i, last = i + sizeof(uint64_t);
+    while (before[first] == after[first]) {
+      first++;
+    }
+    while (before[last - 1] == after[last - 1]) {
+      last--;
+    }
+    if (!ranges.empty() && first - ranges.back().second <= MERGE_GAP) {
+      ranges.back().second = last;
+    } else {
+      ranges.emplace_back(first, last);
+    }
+  }
+  if (ranges.empty()) {
+    return std::nullopt;
+  }
+  std::vector<uint8_t> content;
+  put(content, RecordType::PAGE);
+  put<uint16_t>(content, pid.file.size());
+  content.insert(content.end(), pid.file.begin(), pid.file.end());
+  put<uint64_t>(content, pid.page);
+  put<uint16_t>(content, ranges.size());
+  for (const auto &[first, last] : ranges) {
+    put<uint16_t>(content, first);
+    put<uint16_t>(content, last - first);
+    content.insert(content.end(), before.begin() + first, before.begin() + last);
+    content.insert(content.end(), after.begin() + first, after.begin() + last);
+  }
+  return append(content);
+}
+
+Lsn WriteAheadLog::logCommit() {
+  commits.fetch_add(1, std::memory_order_relaxed);
+  Lsn lsn = append({static_cast<uint8_t>(RecordType::COMMIT)});
+  std::lock_guard lock(mutex);
+  committed = std::max(committed, lsn);
+  return lsn;
+}
+
+void WriteAheadLog::flush(Lsn lsn) {
+  std::unique_lock lock(mutex);
+  while (durable < lsn) {
+    if (flushing) {
+      flushed.wait(lock);
+      continue;
+    }
+    //This caller writes everything appended so far, the others wait for it.
+    flushing = true;
+    std::vector<uint8_t> data;
+    data.swap(buffer);
+    Lsn target = end;
+    size_t offset = HEADER_SIZE + (durable - base);
+    lock.unlock();
+    bool ok = true;
+    try {
+      writeAll(fd, data.data(), data.size(), offset);
+      ok = fdatasync(fd) == 0;
+    } catch (const std::runtime_error &) {
+      ok = false;
+    }
+    lock.lock();
+    flushing = false;
+    flushed.notify_all();
+    if (!ok) {
+      //The records are kept in front of the buffer, so that a later flush writes them again.
+      data.insert(data.end(), buffer.begin(), buffer.end());
+      buffer.swap(data);
+      throw std::runtime_error("Cannot write the log");
+    }
+    durable = target;
+    syncs.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void WriteAheadLog::truncate() {
+  std::lock_guard lock(mutex);
+  base = durable = committed = end;
+  buffer.clear();
+  if (ftruncate(fd, HEADER_SIZE) == -1) {
+    throw std::runtime_error("Cannot truncate the log");
+  }
+  writeHeader();
+}
+
+void WriteAheadLog::truncate(Lsn lsn) {
+  flush(lsn);
+  std::unique_lock lock(mutex);
+  flushed.wait(lock, [&] { return !flushing; });
+  if (lsn <= base) {
+    return;
+  }
+  //Appends go on in the buffer, while flushes wait for the new file.
+  flushing = true;
+  size_t first = HEADER_SIZE + (lsn - base), last = HEADER_SIZE + (durable - base);
+  lock.unlock();
+
+  std::string tmp = path + ".tmp";
+  int new_fd = open(tmp.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  try {
+    if (new_fd == -1) {
+      throw std::runtime_error("Cannot create " + tmp);
+    }
+    uint64_t header[2] = {MAGIC, lsn};
+    writeAll(new_fd, reinterpret_cast<const uint8_t *>(header), HEADER_SIZE, 0);
+    std::vector<uint8_t> records(last - first);
+    if (pread(fd, records.data(), records.size(), first) != static_cast<ssize_t>(records.size())) {
+      throw std::runtime_error("Cannot read the log");
+    }
+    writeAll(new_fd, records.data(), records.size(), HEADER_SIZE);
+    if (fdatasync(new_fd) == -1 || rename(tmp.c_str(), path.c_str()) == -1) {
+      throw std::runtime_error("Cannot replace the log");
+    }
+  } catch (const std::runtime_error &) {
+    if (new_fd != -1) {
+      close(new_fd);
+      unlink(tmp.c_str());
+    }
+    lock.lock();
+    flushing = false;
+    flushed.notify_all();
+    throw;
+  }
+
+  lock.lock();
+  close(fd);
+  fd = new_fd;
+  base = lsn;
+  committed = std::max(committed, lsn);
+  flushing = false;
+  flushed.notify_all();
+  lock.unlock();
+  syncDirectory(path);
+}
+
+Lsn WriteAheadLog::getBaseLsn() const {
+  std::lock_guard lock(mutex);
+  return base;
+}
+
+Lsn WriteAheadLog::getCommitLsn() const {
+  std::lock_guard lock(mutex);
+  return committed;
+}
+
+Lsn WriteAheadLog::getEndLsn() const {
+  std::lock_guard lock(mutex);
+  return end;
+}
+
+Lsn WriteAheadLog::getDurableLsn() const {
+  std::lock_guard lock(mutex);
+  return durable;
+}
+
+uint64_t WriteAheadLog::getRecords() const { return records.load(std::memory_order_relaxed); }
+
+uint64_t WriteAheadLog::getCommits() const { return commits.load(std::memory_order_relaxed); }
+
+uint64_t WriteAheadLog::getSyncs() const { return syncs.load(std::memory_order_relaxed); }
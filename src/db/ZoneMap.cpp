@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <db/ZoneMap.hpp>
+
+using namespace db;
+
+ZoneMap::ZoneMap(const TupleDesc &td) : positions(td.size(), td.size()) {
+  for (size_t i = 0; i < td.size(); i++) {
+    if (td.type_of(i) != type_t::CHAR) {
+      positions[i] = fields.size();
+      fields.push_back(i);
+    }
+  }
+}
+
+size_t ZoneMap::size() const { return known.size(); }
+
+void ZoneMap::resize(size_t pages) {
+  if (pages <= known.size()) {
+    return;
+  }
+  known.resize(pages, false);
+  ranges.resize(pages * fields.size());
+}
+
+void ZoneMap::reset(size_t page) {
+  resize(page + 1);
+  known[page] = true;
+  std::fill(ranges.begin() + page * fields.size(), ranges.begin() + (page + 1) * fields.size(), ZoneRange{});
+}
+
+void ZoneMap::update(size_t page, const Tuple &t) {
+  if (!isKnown(page)) {
+    return;
+  }
+  ZoneRange *zone = ranges.data() + page * fields.size();
+  for (size_t i = 0; i < fields.size(); i++) {
+    const field_t &field = t.get_field(fields[i]);
+    double value = std::holds_alternative<int>(field) ? std::get<int>(field) : std::get<double>(field);
+    zone[i].min = std::min(zone[i].min, value);
+    zone[i].max = std::max(zone[i].max, value);
+  }
+}
+
+bool ZoneMap::isKnown(size_t page) const { return page < known.size() && known[page]; }
+
+const ZoneRange *ZoneMap::range(size_t page, size_t field) const {
+  if (!isKnown(page) || positions.at(field) >= fields.size()) {
+    return nullptr;
+  }
+  return &ranges[page * fields.size() + positions[field]];
+}
@@ -1,32 +1,59 @@
 #pragma once
 
 #include <db/DbFile.hpp>
+#include <functional>
 
 namespace db {
 
 class BTreeFile : public DbFile {
   static constexpr size_t root_id = 0;
   size_t key_index;
+  size_t key_width;
+
+  /**
+   * @brief Get the key whose first field is `key` and whose other fields are `fill`, to bound the keys that start with
+   * `key`.
+   */
+  Key bound(int key, int fill) const;
+
+  /**
+   * @brief Move the iterator forward to the next position that holds a tuple.
+   * @details Follow the leaf chain while the iterator is past the last tuple of its leaf. Deleted tuples may leave
+   * empty leaves behind, which are skipped.
+   * @param it The iterator to be moved.
+   */
+  void seekTuple(Iterator &it) const;
 
 public:
 
   /**
    * @brief Initialize a BTreeFile
-   *
+   * @details The key is made of `key_width` consecutive INT fields from `key_index` on, compared in order: the fields
+   * after the first one order the tuples whose first fields are equal, e.g. the (key, page, slot) entries of a
+   * secondary index (see HeapFile::indexDesc).
    * @param key_index the index of the key in the tuple
+   * @param key_width the number of fields of the key, at most MAX_KEY_WIDTH
+   * @throws std::logic_error if the key width is 0, above MAX_KEY_WIDTH, or the key goes past the last field
    */
-  BTreeFile(const std::string &name, const TupleDesc &td, size_t key_index);
+  BTreeFile(const std::string &name, const TupleDesc &td, size_t key_index, size_t key_width = 1);
 
   /**
    * @brief Insert a tuple into the file
    * @details Insert a tuple into the file. Traverse the BTree from the root to find the leaf node to insert the tuple.
-   * If the leaf node is full, split the node and insert the new key and child to the parent node. This process is repeated
-   * until no more split is needed. If the root node is split, create a create two new nodes with the contents of the root
-   * and set the root to be the parent of the two new nodes.
+   * Tuples with equal keys (all of their key fields equal) are all kept, in insertion order. If the leaf node is full, split the node and insert the
+   * new key and child to the parent node. This process is repeated until no more split is needed. If the root node is
+   * split, create a create two new nodes with the contents of the root and set the root to be the parent of the two
+   * new nodes.
    * @param t the tuple to insert
    */
   void insertTuple(const Tuple &t) override;
 
+  /**
+   * @brief Delete a tuple from the file
+   * @details Remove the tuple from its leaf. Leaves are not merged or redistributed, an emptied leaf stays in the leaf
+   * chain and is skipped by iterators.
+   * @param it The iterator that identifies the tuple to be deleted.
+   */
   void deleteTuple(const Iterator &it) override;
 
   /**
@@ -37,6 +64,13 @@ public:
    */
   Tuple getTuple(const Iterator &it) const override;
 
+  /**
+   * @brief Get some fields of a tuple, decoding only their bytes.
+   */
+  Tuple getTuple(const Iterator &it, const std::vector<size_t> &fields) const override;
+
+  using DbFile::begin;
+
   /**
    * @brief Advance the iterator to the next tuple.
    * @details Advance the iterator to the next tuple by moving to the next slot of the page.
@@ -52,6 +86,70 @@ public:
    */
   Iterator begin() const override;
 
+  /**
+   * @brief Get the iterator to the first tuple whose key (its first field) is not less than the provided key.
+   * @details Traverse the tree from the root to the leftmost leaf that may hold the key. Together with `upperBound`
+   * this gives every tuple with a key in a range, duplicates included, e.g. `[lowerBound(k), upperBound(k))` are all
+   * the tuples with key `k`.
+   * @param key the first field of the key to search for
+   * @return The iterator to the first such tuple, or `end()` if there is none.
+   */
+  Iterator lowerBound(int key) const;
+
+  /**
+   * @brief Get the iterator to the first tuple whose key is not less than the provided key, comparing every key field.
+   * @details With a key of several fields, this seeks a single tuple, e.g. one entry among the duplicates of a key.
+   * @param key the key to search for
+   * @return The iterator to the first such tuple, or `end()` if there is none.
+   */
+  Iterator lowerBound(const Key &key) const;
+
+  /**
+   * @brief Visit the tuples in descending key order until the visitor returns false.
+   * @details The leaves are only linked forward, so they are found from the root by descending into the rightmost child
+   * that has not been visited yet. Only the index pages on the way and the last leaves of the chain are read.
+   * Tuples with the same key are visited in the reverse of their iteration order.
+   * @param visit called with each tuple, returns whether to continue
+   */
+  void reverseScan(const std::function<bool(const Tuple &)> &visit) const;
+
+  /**
+   * @brief Get the iterator to the first tuple whose key (its first field) is greater than the provided key.
+   * @param key the first field of the key to search for
+   * @return The iterator to the first such tuple, or `end()` if there is none.
+   */
+  Iterator upperBound(int key) const;
+
+  /**
+   * @brief Get the iterator to the first tuple whose key is greater than the provided key, comparing every key field.
+   */
+  Iterator upperBound(const Key &key) const;
+
+  /**
+   * @brief Get the key of the tuple the iterator points to without deserializing the whole tuple.
+   * @param it The iterator that identifies the tuple.
+   * @return The first field of the key of the tuple.
+   */
+  int getKey(const Iterator &it) const;
+
+  /**
+   * @brief Get the index of the key in the tuple.
+   */
+  size_t getKeyIndex() const;
+
+  /**
+   * @brief Get the number of fields of the key.
+   */
+  size_t getKeyWidth() const;
+
+  /**
+   * @brief Get the page numbers of the leaves, in key order.
+   * @details Only the index pages are read, one level at a time from the root, so the leaves can be split between
+   * threads without following the leaf chain (see parallelScan).
+   * @return The leaves, or nothing if the tree is empty.
+   */
+  std::vector<size_t> leafPages() const;
+
   /**
    * @brief Get the iterator to the end of the file.
    * @details Return an iterator that points to the end of the file.
@@ -1,28 +1,75 @@
 #pragma once
 
+#include <db/Metrics.hpp>
+#include <db/WriteAheadLog.hpp>
 #include <db/types.hpp>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 namespace db {
+class DbFile;
+
 constexpr size_t DEFAULT_NUM_PAGES = 50;
+
+/**
+ * @brief The logical time of a snapshot: the changes made after it was taken are not visible in it (see Snapshot).
+ */
+using Timestamp = uint64_t;
+
 /**
  * @brief Represents a buffer pool for database pages.
  * @details The BufferPool class is responsible for managing the database pages in memory.
  * It provides functions to get a page, mark a page as dirty, and check the status of pages.
  * The class also supports flushing pages to disk and discarding pages from the buffer pool.
+ * When a WriteAheadLog is set, the changes of a dirty page are logged before the page is written to its file.
+ * While snapshots are open, markDirty keeps the previous version of a page before it changes, for the snapshots that
+ * still see it (see readVersion). Snapshot readers on other threads only use these versions and the files, so they run
+ * concurrently with the threads that use the pages.
  * @note A BufferPool owns the Page objects that are stored in it.
  */
 class BufferPool {
-  std::array<Page, DEFAULT_NUM_PAGES> pages;
+  /// Aligned so that the 8-byte aligned offsets of a page (e.g. the columns of a ColumnPage) are aligned in memory
+  alignas(64) std::array<Page, DEFAULT_NUM_PAGES> pages;
   std::array<PageId, DEFAULT_NUM_PAGES> pos_to_pid;
   std::unordered_map<const PageId, size_t> pid_to_pos;
   std::unordered_set<size_t> dirty;
   std::vector<size_t> available;
   std::list<size_t> lru_list;
   std::unordered_map<size_t, std::list<size_t>::iterator> pos_to_lru;
+  PoolMetrics metrics;
+
+  WriteAheadLog *log = nullptr;
+  /// With a log: the content of each page at its last record, or as read from its file
+  std::array<Page, DEFAULT_NUM_PAGES> logged;
+  /// With a log: the LSN of the last record of each page, which must be durable before the page is written
+  std::array<Lsn, DEFAULT_NUM_PAGES> page_lsn{};
+  /// With a log: the LSN of the first record of each page since it was written to its file, or NO_LSN
+  std::array<Lsn, DEFAULT_NUM_PAGES> rec_lsn;
+
+  void logPage(size_t pos);
+
+  /// A page as it was before the changes made from a time on
+  struct Version {
+    Timestamp time;
+    std::shared_ptr<const Page> page;
+  };
+
+  mutable std::recursive_mutex latch;
+  /// Incremented by every snapshot, so that the versions kept afterwards are later than it
+  Timestamp clock = 0;
+  /// The open snapshots, with the number of pages of every file when they were taken
+  std::map<Timestamp, std::unordered_map<std::string, size_t>> snapshots;
+  /// The versions of the pages changed since the open snapshots were taken, oldest first
+  std::unordered_map<const PageId, std::vector<Version>> versions;
+
+  void keepVersion(size_t pos);
+
+  const Page *findVersion(const PageId &pid, Timestamp time) const;
 
 public:
   /**
@@ -32,6 +79,8 @@ public:
 
   /**
    * @brief: Destructs a BufferPool object after flushing all dirty pages to disk.
+   * @details The pages are written by flushPage, so that with a log their changes are on disk before them. If the log
+   * cannot be written, the remaining dirty pages are dropped.
    */
   ~BufferPool();
 
@@ -54,6 +103,8 @@ public:
   /**
    * @brief: Marks the page with the specified page id as dirty.
    * @param pid: The page id of the page to mark as dirty.
+   * @note Writers must mark a page dirty before they change it, so that its previous version is kept for the open
+   * snapshots.
    */
   void markDirty(const PageId &pid);
 
@@ -83,6 +134,8 @@ public:
    * @brief: Flushes the page with the specified page id to disk.
    * @param pid: The page id of the page to flush.
    * @note This method should remove the page from dirty pages.
+   * @note With a log, the page is logged and the log is flushed past its last record first. The other dirty pages are
+   * logged at the same time, so that a sequence of flushes (e.g. flushFile or evictions) shares one sync of the log.
    */
   void flushPage(const PageId &pid);
   /**
@@ -91,5 +144,76 @@ public:
    * @note This method should call BufferPool::flushPage(pid).
    */
   void flushFile(const std::string &file);
+
+  /**
+   * @brief: Log the changes of the pages to a WriteAheadLog from now on.
+   * @param log The log, or nullptr to stop logging. It must outlive the BufferPool, or be unset first.
+   * @note The pages in the buffer pool must not be dirty.
+   */
+  void setLog(WriteAheadLog *log);
+
+  /**
+   * @brief: Log the changes of every dirty page since its last record.
+   * @return The end of the log, or 0 without a log.
+   */
+  Lsn logChanges();
+
+  /**
+   * @brief: Flushes some dirty pages to disk, the ones with the oldest records first.
+   * @details Checkpoints call this to write the dirty pages a few at a time instead of all at once, e.g. when the
+   * BufferPool is destroyed. Writing the pages with the oldest records moves the recovery LSN the furthest. Without a
+   * log, the least recently used pages are written first.
+   * @param max_pages: The number of pages to flush at most.
+   * @return: The number of pages flushed.
+   */
+  size_t writeBack(size_t max_pages);
+
+  /**
+   * @brief: Returns the LSN from which recovery needs the log to restore the dirty pages: the first record of a page
+   * since it was written to its file, or NO_LSN if there is none.
+   */
+  Lsn getRecoveryLsn() const;
+
+  /**
+   * @brief: Returns the latch of the BufferPool.
+   * @details Writers hold it for a whole change (e.g. HeapFile::insertTuple), and snapshots are taken and read with it,
+   * so that a snapshot is taken between two changes. getPage does not take it, to keep page accesses cheap: threads
+   * that use pages while others change them (e.g. to iterate over a file before deleting tuples) hold it meanwhile.
+   */
+  std::recursive_mutex &getLatch() const;
+
+  /**
+   * @brief: Opens a snapshot of the pages (see Database::snapshot), once the dirty pages are written.
+   * @param num_pages The number of pages of every file, whose later pages are not versioned for the snapshot.
+   * @return The time of the snapshot.
+   */
+  Timestamp openSnapshot(const std::unordered_map<std::string, size_t> &num_pages);
+
+  /**
+   * @brief: Closes a snapshot, and drops the versions that no open snapshot needs anymore.
+   */
+  void closeSnapshot(Timestamp time);
+
+  /**
+   * @brief: Reads a page as it was when a snapshot was taken.
+   * @details The page is the first version kept after the snapshot, if any, or else the page read from its file, which
+   * holds the page as of the snapshot (see Database::snapshot). The latch is not held while the file is read, so
+   * readers do not wait for each other's I/O. The page is not loaded into the pool.
+   * @param file The file of the page.
+   * @param id The page number.
+   * @param time The time of an open snapshot.
+   * @param page The page to read into.
+   */
+  void readVersion(const DbFile &file, size_t id, Timestamp time, Page &page);
+
+  /**
+   * @brief: Returns the number of page versions kept for the open snapshots.
+   */
+  size_t getNumVersions() const;
+
+  /**
+   * @brief: Returns the hits, misses, evictions and dirty page flushes of the buffer pool, and their latencies.
+   */
+  const PoolMetrics &getPoolMetrics() const;
 };
 } // namespace db
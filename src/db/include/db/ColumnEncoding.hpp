@@ -0,0 +1,143 @@
+#pragma once
+
+#include <db/Query.hpp>
+#include <unordered_set>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief How the values of one column are stored in an encoded ColumnPage.
+ * @details
+ *   RAW: the values as serialized (see TupleDesc::serialize), one after the other.
+ *   FOR (frame of reference, INT): the smallest value of the page, and the difference of every value to it packed in
+ *     the fewest bits that hold the largest difference (0 bits if all values are equal).
+ *   RLE (run length, INT): each run of equal consecutive values stored once, with the slot where it ends.
+ *   DICT (dictionary, CHAR): the distinct strings of the page, sorted, and the position of every value in them packed in
+ *     the fewest bits. Codes are ordered like the strings, so comparisons with a constant compare codes.
+ */
+enum class ColumnEncoding : uint8_t { RAW, FOR, RLE, DICT };
+
+/**
+ * @brief The format of a ColumnPage, stored in its first byte.
+ */
+enum class PageFormat : uint8_t { RAW, ENCODED };
+
+/**
+ * @brief The number of bytes at the start of every ColumnPage: its PageFormat, its flags (COLUMN_PAGE_FULL), two unused
+ * bytes and, for an encoded page, its number of slots as a 32-bit integer. The occupancy bitmap follows.
+ */
+constexpr size_t COLUMN_PAGE_HEADER = 8;
+
+/**
+ * @brief The flag of an encoded page that cannot take more tuples.
+ */
+constexpr uint8_t COLUMN_PAGE_FULL = 1;
+
+/**
+ * @brief Encodes tuples into one page, choosing the smallest encoding of each column for these tuples.
+ * @details Tuples are added one at a time for as long as their encoding fits in a page, so a page holds as many tuples as
+ * their encoding allows (see ColumnFile::insertTuple). The size is tracked incrementally: adding a tuple costs a few
+ * operations per column, and the encodings are only chosen and written by write.
+ *
+ * An encoded page starts with the header of every ColumnPage (format, flags and number of slots), followed by the
+ * occupancy bitmap of the slots, one 16-byte descriptor per column (encoding, bit width, offset, frame of reference and
+ * number of entries) and the data of every column, each starting at a multiple of 8 bytes.
+ */
+class ColumnEncoder {
+  struct ColumnState {
+    /// INT: the range of the values and the number of runs
+    int64_t min = 0, max = 0;
+    size_t runs = 0;
+    /// CHAR: the number of distinct strings and their total length
+    size_t distinct = 0, bytes = 0;
+  };
+
+  const TupleDesc &td;
+  std::vector<size_t> widths;
+  std::vector<ColumnState> columns;
+  /// The distinct strings of every CHAR column
+  std::vector<std::unordered_set<std::string>> strings;
+  /// The tuples added, serialized one after the other
+  std::vector<uint8_t> rows;
+  size_t count = 0;
+
+  size_t sizeOf(size_t field, const ColumnState &state, size_t n, ColumnEncoding &encoding) const;
+
+public:
+  explicit ColumnEncoder(const TupleDesc &td);
+
+  /**
+   * @brief Add a tuple if the page still fits with it.
+   * @param data The tuple, serialized with the schema.
+   * @return False if the encoded page would not fit in a page, in which case nothing is added.
+   */
+  bool add(const uint8_t *data);
+
+  /**
+   * @brief Get the number of tuples added.
+   */
+  size_t size() const;
+
+  /**
+   * @brief Write the encoded page.
+   * @param page The page, overwritten. Every slot is occupied.
+   * @param full Whether the page is marked as full, so that no more tuples are encoded into it.
+   */
+  void write(Page &page, bool full) const;
+};
+
+/**
+ * @brief Reads the columns of an encoded page (see ColumnEncoder).
+ */
+class EncodedColumns {
+  const TupleDesc &td;
+  const uint8_t *page;
+  size_t count;
+  const uint8_t *descriptors;
+
+  struct Descriptor {
+    ColumnEncoding encoding;
+    uint8_t bits;
+    uint32_t offset;
+    int32_t base;
+    uint32_t entries;
+  };
+
+  Descriptor descriptor(size_t field) const;
+
+public:
+  EncodedColumns(const uint8_t *page, const TupleDesc &td);
+
+  /**
+   * @brief Get the encoding of a column.
+   */
+  ColumnEncoding encodingOf(size_t field) const;
+
+  /**
+   * @brief Decode the value of a field into the format of TupleDesc::serialize.
+   * @param slot The slot of the tuple.
+   * @param field The index of the field.
+   * @param data Where to write the value.
+   */
+  void decode(size_t slot, size_t field, uint8_t *data) const;
+
+  /**
+   * @brief Get the values of a RAW column, or nullptr if the column is encoded.
+   */
+  const uint8_t *rawColumn(size_t field) const;
+
+  /**
+   * @brief Clear the selection of the slots whose value of a field does not satisfy "value op operand".
+   * @details The comparison is made on the encoded values: dictionary codes, differences to the frame of reference or
+   * runs, without decoding the values. RAW columns are compared by the column kernels (see selectValues).
+   * @param field The index of the field.
+   * @param op The comparison.
+   * @param operand The value to compare with. Only INT columns compared with an int, DOUBLE columns compared with a
+   * double and CHAR columns compared with a string of at most CHAR_SIZE characters are handled.
+   * @param selected One flag per slot, cleared for the slots that do not match.
+   * @return False if the comparison could not be made on this column, in which case the selection is unchanged.
+   */
+  bool match(size_t field, PredicateOp op, const field_t &operand, std::vector<uint8_t> &selected) const;
+};
+} // namespace db
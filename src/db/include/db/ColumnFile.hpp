@@ -0,0 +1,91 @@
+#pragma once
+
+#include <db/ColumnPage.hpp>
+#include <db/Database.hpp>
+
+namespace db {
+
+/**
+ * @brief A database file of ColumnPages: an unordered file like HeapFile, stored column by column within each page.
+ * @details Tuples are appended to the last page and identified by (page, slot) like in a HeapFile, and the Iterator
+ * interface is the same. Scans that only use some fields (see DbFile::begin(fields)) read only the columns of these
+ * fields, so narrow fields of a wide schema are read without the bytes of the wide ones. Query functions that know the
+ * file type read whole columns of a page at a time (see scanPages).
+ * Pages are compressed once they are filled (see insertTuple), so that they hold more tuples and scans read fewer pages.
+ */
+class ColumnFile : public DbFile {
+  ColumnLayout layout;
+
+  //Encode the tuples of the full last page into the page before it, or into itself, and add a page if needed.
+  void seal();
+
+public:
+  ColumnFile(const std::string &name, const TupleDesc &td);
+
+  /**
+   * @brief Get the layout of the pages of the file.
+   */
+  const ColumnLayout &getLayout() const;
+
+  /**
+   * @brief Insert a tuple to the first free slot of the last page.
+   * @details The last page is always a raw page. When it is full, its tuples are encoded (see ColumnEncoder):
+   *   If the page before it is an encoded page that is not full yet, the tuples of both pages are encoded again into the
+   *   page before, as many as fit, and the others stay in the last page. When no tuple fits, that page becomes full.
+   *   Otherwise the tuples of the last page are encoded into the page itself, unless they fit better raw, and a new raw
+   *   page is added.
+   * Every encoding of a page thus adds at least a page of tuples to it, and deleted tuples are dropped when their page
+   * is encoded again. The tuples of the last two pages may move to other slots.
+   * @param t The tuple to be inserted.
+   * @throws std::runtime_error if the tuple does not match the schema of the file.
+   */
+  void insertTuple(const Tuple &t) override;
+
+  /**
+   * @brief Delete a tuple by marking its slot unused.
+   * @param it The iterator that identifies the tuple to be deleted.
+   */
+  void deleteTuple(const Iterator &it) override;
+
+  Tuple getTuple(const Iterator &it) const override;
+
+  /**
+   * @brief Get some fields of a tuple, reading only their minipages.
+   */
+  Tuple getTuple(const Iterator &it, const std::vector<size_t> &fields) const override;
+
+  using DbFile::begin;
+
+  void next(Iterator &it) const override;
+
+  /**
+   * @brief Get the iterator to the first tuple stored in or after a page.
+   * @param page The page to start from.
+   * @return The iterator to the first such tuple, or `end()` if there is none.
+   */
+  Iterator seek(size_t page) const;
+
+  Iterator begin() const override;
+
+  Iterator end() const override;
+
+  /**
+   * @brief Get a page of the file from the buffer pool.
+   * @param page The page number.
+   * @return The page, only valid until the buffer pool evicts it.
+   */
+  ColumnPage getPage(size_t page) const;
+
+  /**
+   * @brief Visit every page of the file, in order.
+   * @param visit Called as visit(page) with a ColumnPage that is only valid during the call. It must not access other
+   * pages through the buffer pool, which may evict the page.
+   */
+  template <typename Visit> void scanPages(Visit visit) const {
+    for (size_t id = 0; id < numPages; id++) {
+      const ColumnPage cp = getPage(id);
+      visit(cp);
+    }
+  }
+};
+} // namespace db
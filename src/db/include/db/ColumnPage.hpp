@@ -0,0 +1,174 @@
+#pragma once
+
+#include <db/ColumnEncoding.hpp>
+#include <db/DbFile.hpp>
+#include <optional>
+
+namespace db {
+
+/**
+ * @brief Where the columns of a schema are stored in a raw ColumnPage.
+ * @details A page starts with a header (see COLUMN_PAGE_HEADER) and the occupancy bitmap of its slots, followed by one
+ * minipage per field holding the values of that field for every slot, one after the other. Each minipage starts at a multiple of 8 bytes, so a column of
+ * INT or DOUBLE values is an aligned array. The capacity is the largest number of slots for which the bitmap, the
+ * minipages and their padding fit in a page.
+ */
+class ColumnLayout {
+  size_t capacity;
+  std::vector<size_t> offsets;
+  std::vector<size_t> widths;
+
+public:
+  explicit ColumnLayout(const TupleDesc &td);
+
+  /**
+   * @brief Get the number of slots of a page.
+   */
+  size_t getCapacity() const;
+
+  /**
+   * @brief Get the offset of the minipage of a field from the start of the page.
+   */
+  size_t offsetOf(size_t field) const;
+
+  /**
+   * @brief Get the number of bytes of a value of a field.
+   */
+  size_t widthOf(size_t field) const;
+};
+
+/**
+ * @brief A page of a ColumnFile, which stores its tuples column by column (PAX).
+ * @details The slots and the occupancy bitmap work as in HeapPage, but the fields of a tuple are spread over the
+ * columns of the page. Reading one field of every tuple of the page reads one column, and the other fields are never
+ * touched. A page has one of two formats (see PageFormat):
+ *   RAW: every column is a minipage of fixed-width values (see ColumnLayout). Tuples are inserted into raw pages.
+ *   ENCODED: every column is compressed with the encoding that makes it smallest (see ColumnEncoder), so the page holds
+ *   more tuples than a raw page. An encoded page is read only, but its tuples can be deleted.
+ */
+class ColumnPage {
+  const TupleDesc &td;
+  const ColumnLayout &layout;
+  uint8_t *header;
+  uint8_t *bitmap;
+  std::optional<EncodedColumns> encoded;
+
+public:
+  /**
+   * @brief Wrap a page with a column page.
+   * @param page The page to be wrapped.
+   * @param td The tuple descriptor of the page.
+   * @param layout The layout of the tuple descriptor.
+   */
+  ColumnPage(Page &page, const TupleDesc &td, const ColumnLayout &layout);
+
+  /**
+   * @brief Get the first occupied slot of the page.
+   */
+  size_t begin() const;
+
+  /**
+   * @brief Get the end of the page, the number of slots.
+   */
+  size_t end() const;
+
+  /**
+   * @brief Check whether the page is encoded.
+   */
+  bool isEncoded() const;
+
+  /**
+   * @brief Check whether the page is encoded and cannot take more tuples (see ColumnFile::insertTuple).
+   */
+  bool isFull() const;
+
+  /**
+   * @brief Get the encoding of a column, RAW for every column of a raw page.
+   */
+  ColumnEncoding encodingOf(size_t field) const;
+
+  /**
+   * @brief Insert a tuple to the first free slot of a raw page.
+   * @param t The tuple to be inserted.
+   * @param slot Set to the slot of the inserted tuple.
+   * @return True if the tuple is inserted successfully, false otherwise if the page is full or encoded.
+   */
+  bool insertTuple(const Tuple &t, size_t &slot);
+
+  /**
+   * @brief Delete a tuple from the page by marking the slot unused.
+   * @param slot The slot of the tuple to be deleted.
+   */
+  void deleteTuple(size_t slot);
+
+  /**
+   * @brief Check if the slot is empty.
+   */
+  bool empty(size_t slot) const;
+
+  /**
+   * @brief Get the tuple at the specified slot.
+   */
+  Tuple getTuple(size_t slot) const;
+
+  /**
+   * @brief Get some fields of the tuple at the specified slot, reading only their minipages.
+   * @param slot The slot of the tuple.
+   * @param fields The indexes of the fields to read, in the order of the result.
+   * @return The fields of the tuple, with the schema `td.project(fields)`.
+   */
+  Tuple getTuple(size_t slot, const std::vector<size_t> &fields) const;
+
+  /**
+   * @brief Copy some fields of a tuple into a buffer in the format of TupleDesc::serialize.
+   * @details Only the bytes of the given fields are written, at their offsets in a serialized tuple, so the buffer can
+   * be given to code that reads serialized tuples (e.g. CompiledPredicate, HashAggregator) as long as it only reads
+   * these fields.
+   * @param slot The slot of the tuple.
+   * @param fields The indexes of the fields to copy.
+   * @param data The buffer, of at least `td.length()` bytes.
+   */
+  void gather(size_t slot, const std::vector<size_t> &fields, uint8_t *data) const;
+
+  /**
+   * @brief Get the minipage of a field, if its values are stored uncompressed.
+   * @details The value of slot i starts at byte `i * layout.widthOf(field)`, in the format of TupleDesc::serialize.
+   * Empty slots hold stale or zeroed values.
+   * @param field The index of the field.
+   * @return A pointer to the values of the field, at a multiple of 8 bytes from the start of the page, or nullptr if
+   * the column is encoded.
+   */
+  const uint8_t *column(size_t field) const;
+
+  /**
+   * @brief Get the values of a field like column does, decoding them into a buffer if the column is encoded.
+   * @param field The index of the field.
+   * @param buffer The buffer the values are decoded into, resized as needed.
+   * @return A pointer to the values of the `end()` slots, either in the page or in the buffer.
+   */
+  const uint8_t *values(size_t field, std::vector<uint8_t> &buffer) const;
+
+  /**
+   * @brief Get a selection of the occupied slots.
+   * @param selected Set to one flag per slot, 1 for the occupied slots and 0 for the empty ones.
+   */
+  void occupancy(std::vector<uint8_t> &selected) const;
+
+  /**
+   * @brief Clear the selection of the slots whose value of a field does not satisfy "value op operand".
+   * @details The comparison is made on the encoded values of an encoded page (see EncodedColumns::match), and by the
+   * column kernels on the uncompressed columns of INT and DOUBLE fields (see selectValues).
+   * @param field The index of the field.
+   * @param op The comparison.
+   * @param operand The value to compare with.
+   * @param selected One flag per slot, cleared for the slots that do not match.
+   * @return False if the comparison could not be made on this column, in which case the selection is unchanged.
+   */
+  bool match(size_t field, PredicateOp op, const field_t &operand, std::vector<uint8_t> &selected) const;
+
+  /**
+   * @brief Advance the slot to the next occupied slot.
+   */
+  void next(size_t &slot) const;
+};
+} // namespace db
@@ -2,7 +2,11 @@
 
 #include <db/BufferPool.hpp>
 #include <db/DbFile.hpp>
+#include <db/Snapshot.hpp>
+#include <db/Statistics.hpp>
+#include <db/WriteAheadLog.hpp>
 #include <memory>
+#include <mutex>
 
 /**
  * @brief A database is a collection of files and a BufferPool.
@@ -12,9 +16,27 @@
  * @note A Database owns the DbFile objects that are added to it.
  */
 namespace db {
+/**
+ * @brief The number of dirty pages written by a checkpoint (see Database::checkpoint).
+ */
+constexpr size_t CHECKPOINT_PAGES = 8;
+
+/**
+ * @brief The size of the log from which every commit runs a checkpoint.
+ */
+constexpr size_t CHECKPOINT_LOG_SIZE = 1 << 20;
+
 class Database {
   std::unordered_map<std::string, std::unique_ptr<DbFile>> files;
 
+  /// The statistics of the files that were analyzed, loaded lazily from their ".stats" files
+  mutable std::unordered_map<std::string, TableStats> stats;
+
+  /// Declared before the BufferPool, which logs to it until it is destroyed
+  std::unique_ptr<WriteAheadLog> log;
+  /// Serializes the commits while they log the dirty pages (but not while they flush the log), and the checkpoints
+  std::mutex commit_mutex;
+
   BufferPool bufferPool;
 
   Database() = default;
@@ -22,6 +44,11 @@ class Database {
 public:
   friend Database &getDatabase();
 
+  /**
+   * @brief Closes the log (see close), ignoring the errors: the log is then recovered by the next openLog.
+   */
+  ~Database();
+
   Database(Database const &) = delete;
   void operator=(Database const &) = delete;
   Database(Database &&) = delete;
@@ -48,6 +75,7 @@ public:
    * @throws std::logic_error if the name does not exist.
    * @note This method should call BufferPool::flushFile(name)
    * @note This method moves the DbFile ownership to the caller.
+   * @note The statistics of the file are forgotten and its ".stats" file is deleted.
    */
   std::unique_ptr<DbFile> remove(const std::string &name);
 
@@ -58,6 +86,80 @@ public:
    * @throws std::logic_error if the name does not exist.
    */
   DbFile &get(const std::string &name) const;
+
+  /**
+   * @brief Collects the statistics of a file (see db::analyze).
+   * @details The statistics are kept in memory and written next to the file, as name + ".stats", so that they survive
+   * the Database. They are not updated when the file changes: analyze the file again to refresh them.
+   * @param name The name of the file.
+   * @return The statistics.
+   * @throws std::logic_error if the name does not exist.
+   */
+  const TableStats &analyze(const std::string &name);
+
+  /**
+   * @brief Returns the statistics of a file.
+   * @param name The name of the file.
+   * @return The last statistics collected by analyze, or nullptr if the file was never analyzed.
+   * @throws std::logic_error if the name does not exist.
+   * @throws std::runtime_error if the ".stats" file of the file is not valid.
+   */
+  const TableStats *getStats(const std::string &name) const;
+
+  /**
+   * @brief Opens a write-ahead log, recovers the files from it, and logs every change to the pages from now on.
+   * @details The files are brought back to their state at the last commit of the log (see WriteAheadLog::recover), so
+   * this must be called before they are added. Dirty pages can then be written lazily, e.g. when they are evicted:
+   * changes that reach a file before they are committed are undone by the next recovery.
+   * @param path The path of the log, created if it does not exist.
+   * @throws std::logic_error if a log is already open or files were added.
+   * @throws std::runtime_error if the log cannot be opened or recovered.
+   */
+  void openLog(const std::string &path);
+
+  /**
+   * @brief Returns the write-ahead log, or nullptr if none is open.
+   */
+  WriteAheadLog *getLog() const;
+
+  /**
+   * @brief Makes every change to the pages so far durable.
+   * @details The dirty pages are logged, followed by a COMMIT record, and the log is flushed; the pages themselves stay
+   * in the BufferPool. Several threads may commit at once, as long as they do not use the BufferPool concurrently
+   * otherwise: their commits then share the syncs of the log (group commit).
+   * Once the log reaches CHECKPOINT_LOG_SIZE, the commit also runs a checkpoint.
+   * @throws std::logic_error if no log is open.
+   */
+  void commit();
+
+  /**
+   * @brief With a log, commits the changes, writes every dirty page and empties the log, which is then closed.
+   * @details The changes made afterwards are not logged, as when no log was opened. Without a log, nothing is done.
+   * @throws std::runtime_error if the log or the files cannot be written, in which case the log stays open.
+   */
+  void close();
+
+  /**
+   * @brief Runs a fuzzy checkpoint: writes a few dirty pages, and drops the log that recovery no longer needs.
+   * @details The dirty pages with the oldest records are written (see BufferPool::writeBack) and the files are synced.
+   * The log then only has to start at the first record of a dirty page since it was written, and at the last commit at
+   * the latest (the changes after it may have to be undone). The checkpoint does not wait for the other dirty pages to
+   * be written, so the dirty pages are written a few at a time by successive checkpoints, and the log is cut as they
+   * are. The log is only rewritten once this drops at least half of it.
+   * Without a log, the dirty pages are just written.
+   * @param max_pages The number of dirty pages to write at most.
+   * @return The number of pages written.
+   */
+  size_t checkpoint(size_t max_pages = CHECKPOINT_PAGES);
+
+  /**
+   * @brief Takes a snapshot of the files, e.g. for a long scan that must not stop the writers (see SnapshotFile).
+   * @details The snapshot is taken between two changes of the writers, which hold the latch of the BufferPool while
+   * they change pages. The dirty pages are written first, so that the snapshot reads the pages that do not change
+   * afterwards from the files. The versions it needs are kept until the last copy of the pointer is destroyed.
+   * @return The snapshot.
+   */
+  std::shared_ptr<const Snapshot> snapshot();
 };
 
 /**
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <db/Iterator.hpp>
+#include <db/Metrics.hpp>
 #include <db/types.hpp>
 #include <vector>
 
@@ -13,8 +14,10 @@ namespace db {
  * @note A `DbFile` object owns the `TupleDesc` object that describes the schema of the tuples in the file.
  */
 class DbFile {
-  mutable std::vector<size_t> reads;
-  mutable std::vector<size_t> writes;
+  mutable FileMetrics metrics{&getMetrics().files};
+  /// The pages read and written, which several threads may record at once
+  mutable PageTrace reads;
+  mutable PageTrace writes;
 
   int fd;
 
@@ -41,12 +44,36 @@ public:
 
   const std::string &getName() const;
 
-  const std::vector<size_t> &getReads() const;
+  /**
+   * @brief Get a copy of the ids of the pages read, oldest first.
+   * @details Only the last DEFAULT_TRACE_CAPACITY ids are kept, unless setTraceCapacity changed it: tests that check
+   * every page read set it to FULL_TRACE first.
+   */
+  std::vector<size_t> getReads() const;
+
+  /**
+   * @brief Get a copy of the ids of the pages written, oldest first (see getReads).
+   */
+  std::vector<size_t> getWrites() const;
 
-  const std::vector<size_t> &getWrites() const;
+  /**
+   * @brief Clear the traces of the pages read and written, and change the number of page ids they keep.
+   * @details A bounded trace keeps the last ids in a ring without a lock, so that long scans record their pages
+   * without growing the trace. A full trace appends every id under a lock. The number of pages read and written is
+   * counted by getIoMetrics either way.
+   * @param capacity The number of page ids kept by each trace, FULL_TRACE to keep all of them, 0 to disable tracing.
+   * @note No page of the file may be read or written concurrently.
+   */
+  void setTraceCapacity(size_t capacity);
+
+  /**
+   * @brief Get the number of pages read and written and the latencies of these calls.
+   */
+  const FileMetrics &getIoMetrics() const;
 
   /**
    * @brief Read a page from the file.
+   * @details Pages may be read concurrently by several threads, into different buffers.
    * @param page The page to read into.
    * @param id The page number of the page to be read. It determines the offset within the file.
    */
@@ -60,16 +87,39 @@ public:
    */
   void writePage(const Page &page, size_t id) const;
 
+  /**
+   * @brief Wait until the pages written to the file are on disk.
+   * @throws std::runtime_error if the file cannot be synced.
+   */
+  void sync() const;
+
   virtual void insertTuple(const Tuple &t);
 
   virtual void deleteTuple(const Iterator &it);
 
   virtual Tuple getTuple(const Iterator &it) const;
 
+  /**
+   * @brief Get some fields of a tuple.
+   * @details Files override this to decode only the requested fields. By default the whole tuple is read.
+   * @param it The iterator that identifies the tuple to be read.
+   * @param fields The indexes of the fields to read, in the order of the result.
+   * @return The fields of the tuple, with the schema `getTupleDesc().project(fields)`.
+   */
+  virtual Tuple getTuple(const Iterator &it, const std::vector<size_t> &fields) const;
+
   virtual void next(Iterator &it) const;
 
   virtual Iterator begin() const;
 
+  /**
+   * @brief Get an iterator to the first tuple that only produces some of its fields.
+   * @details Scans that use a few fields of a wide schema skip decoding the others (see getTuple).
+   * @param fields The indexes of the fields to produce, in order. The vector must outlive the iterator.
+   * @return The iterator to the first tuple, which compares equal to `begin()`.
+   */
+  Iterator begin(const std::vector<size_t> &fields) const;
+
   virtual Iterator end() const;
 
   size_t getNumPages() const;
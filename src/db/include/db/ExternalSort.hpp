@@ -0,0 +1,154 @@
+#pragma once
+
+#include <db/SpillFile.hpp>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <queue>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief Sorts a stream of tuples using a bounded amount of memory.
+ * @details Tuples are added one at a time and read back in sorted order once the input is finished.
+ * Sorted runs are generated with replacement selection: a heap holds as many tuples as fit in the memory budget, and
+ * every added tuple pushes the smallest one out to the current run. A tuple smaller than the last one written is kept
+ * for the next run, so runs are about twice the budget on random input and a sorted input produces a single run.
+ * The runs are stored in SpillFiles and combined with a k-way merge that keeps one page per run in memory. If there
+ * are more runs than the budget has pages, groups of runs are merged into longer runs first.
+ * When the whole input fits in the budget nothing is written to disk.
+ */
+class ExternalSort {
+public:
+  /// Strict weak ordering of the tuples
+  using Less = std::function<bool(const Tuple &, const Tuple &)>;
+
+private:
+  struct Entry {
+    size_t run;
+    Tuple tuple;
+  };
+
+  /// Orders a priority queue so that the top is the smallest (run, tuple) pair
+  struct EntryGreater {
+    const Less *less;
+    bool operator()(const Entry &a, const Entry &b) const {
+      return a.run != b.run ? a.run > b.run : (*less)(b.tuple, a.tuple);
+    }
+  };
+
+  /// The position of a run in the final merge, ordered so that the top has the smallest head
+  struct CursorGreater {
+    const ExternalSort *sort;
+    bool operator()(size_t a, size_t b) const { return sort->less(*sort->heads[b], *sort->heads[a]); }
+  };
+
+  TupleDesc td;
+  Less less;
+  size_t memory_pages;
+  size_t capacity;
+
+  std::priority_queue<Entry, std::vector<Entry>, EntryGreater> heap;
+  std::vector<std::unique_ptr<SpillFile>> runs;
+  size_t generated_runs = 0;
+
+  std::vector<std::unique_ptr<SpillFile::Cursor>> cursors;
+  std::vector<std::optional<Tuple>> heads;
+  std::priority_queue<size_t, std::vector<size_t>, CursorGreater> merge;
+  bool finished = false;
+
+  void write(size_t run, const Tuple &t);
+
+  /// Merge the runs [first, last) into one run
+  std::unique_ptr<SpillFile> mergeRuns(size_t first, size_t last);
+
+public:
+  /**
+   * @brief Create an empty sort.
+   * @param td the tuple descriptor of the tuples to sort
+   * @param less the order of the tuples
+   * @param memory_pages the number of pages of tuples the sort may hold in memory
+   */
+  ExternalSort(const TupleDesc &td, Less less, size_t memory_pages);
+
+  /**
+   * @brief Order tuples by a list of fields, the first one being the most significant.
+   * @param order the (field index, descending) pairs to compare
+   * @return the order of the tuples
+   */
+  static Less byFields(const std::vector<std::pair<size_t, bool>> &order);
+
+  ExternalSort(const ExternalSort &) = delete;
+
+  ExternalSort &operator=(const ExternalSort &) = delete;
+
+  /**
+   * @brief Add a tuple to sort.
+   * @throws std::logic_error if the input is already finished
+   */
+  void add(const Tuple &t);
+
+  /**
+   * @brief End the input and prepare the final merge.
+   */
+  void finish();
+
+  /**
+   * @brief Read the next tuple in sorted order.
+   * @return The next tuple, or nothing once every tuple has been read.
+   * @note finish() is called on the first call if needed.
+   */
+  std::optional<Tuple> next();
+
+  /**
+   * @brief Get the number of runs written to disk (0 if the input fit in memory).
+   */
+  size_t getNumRuns() const;
+};
+
+/**
+ * @brief Keeps the K smallest tuples of a stream.
+ * @details The tuples are kept in a max-heap of at most K tuples, so that a tuple that is not smaller than the largest
+ * kept one is rejected with a single comparison.
+ */
+class TopKHeap {
+  ExternalSort::Less less;
+  size_t k;
+  std::vector<Tuple> heap;
+
+public:
+  /**
+   * @param less the order of the tuples
+   * @param k the number of tuples to keep
+   */
+  TopKHeap(ExternalSort::Less less, size_t k);
+
+  /**
+   * @brief Offer a tuple.
+   * @return true if the tuple is kept (for now).
+   */
+  bool add(const Tuple &t);
+
+  /**
+   * @brief Check whether K tuples are kept, i.e. whether a tuple must beat the largest one to be kept.
+   */
+  bool full() const;
+
+  /**
+   * @brief Get the largest kept tuple.
+   * @note The heap must not be empty.
+   */
+  const Tuple &largest() const;
+
+  /**
+   * @brief Offer every tuple kept by another heap.
+   */
+  void merge(const TopKHeap &other);
+
+  /**
+   * @brief Get the kept tuples in ascending order and empty the heap.
+   */
+  std::vector<Tuple> finish();
+};
+} // namespace db
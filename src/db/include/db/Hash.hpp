@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+namespace db {
+
+/**
+ * @brief A 64-bit hash finalizer: every bit of the input affects every bit of the output.
+ * @details Hashes that are used to pick slots, partitions or sketch registers are passed through it, since std::hash of
+ * an integer is the identity and nearby keys would otherwise collide in the low (or high) bits.
+ */
+inline uint64_t mix(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+} // namespace db
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <db/Query.hpp>
+#include <memory>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief Computes several aggregates over composite group keys (see the multi-aggregate db::aggregate).
+ * @details The group key of a tuple is stored inline as the fixed-width bytes of its group fields, in an open
+ * addressing hash table that maps it to a dense group number. The accumulators of a group are stored next to each other
+ * in one fixed-width record, with their own types: INT sums and counts are 64-bit integers, MIN and MAX keep the raw
+ * field value (including CHAR fields). COUNT_DISTINCT keeps a hash set of (group, value) pairs per term.
+ * Tuples are read in their serialized form, so a heap page can be aggregated without deserializing it.
+ * Aggregators of the same terms can be merged, e.g. the partial aggregators of threads that each scanned part of a file.
+ */
+class HashAggregator {
+  class KeyTable;
+
+  /// How a term is accumulated, from the operation and the type of the field
+  enum class Kind : uint8_t {
+    COUNT,
+    SUM_INT,
+    SUM_DOUBLE,
+    AVG_INT,
+    AVG_DOUBLE,
+    MIN_INT,
+    MAX_INT,
+    MIN_DOUBLE,
+    MAX_DOUBLE,
+    MIN_CHAR,
+    MAX_CHAR,
+    COUNT_DISTINCT
+  };
+
+  struct Accumulator {
+    Kind kind;
+    type_t type;
+    /// The offset of the field in a serialized input tuple
+    size_t input_offset;
+    /// The width of the field
+    size_t width;
+    /// The offset of the accumulator in the state of a group
+    size_t offset;
+    /// The position of the distinct set of a COUNT_DISTINCT term
+    size_t distinct;
+  };
+
+  struct GroupField {
+    /// The offset of the field in a serialized input tuple
+    size_t input_offset;
+    size_t width;
+    type_t type;
+  };
+
+  TupleDesc input_td, group_td, td;
+  std::vector<GroupField> group_fields;
+  std::vector<Accumulator> accumulators;
+  size_t key_width = 0, state_width = 0;
+
+  std::unique_ptr<KeyTable> groups;
+  std::vector<std::unique_ptr<KeyTable>> distinct;
+  /// The accumulators of group g are stored at `states[g * state_width]` onwards
+  std::vector<uint8_t> states;
+
+  /// Scratch buffers for the key of the current tuple and for serializing tuples
+  std::vector<uint8_t> key, buffer;
+
+public:
+  /**
+   * @brief Prepare to aggregate tuples of a schema.
+   * @param input The schema of the input tuples.
+   * @param group_by The fields to group by.
+   * @param terms The aggregates to compute.
+   * @throws std::logic_error if a term cannot be computed on its field (e.g. SUM of a CHAR field).
+   */
+  HashAggregator(const TupleDesc &input, const std::vector<std::string> &group_by,
+                 const std::vector<AggregateTerm> &terms);
+
+  ~HashAggregator();
+
+  /**
+   * @brief Get the name of the output field of a term, e.g. "SUM(price)".
+   */
+  static std::string nameOf(const AggregateTerm &term);
+
+  /**
+   * @brief Get the schema of the results (see db::aggregateDesc).
+   */
+  const TupleDesc &getTupleDesc() const;
+
+  /**
+   * @brief Add a serialized tuple to its group.
+   * @param data The tuple serialized with the input schema (see TupleDesc::serialize).
+   */
+  void add(const uint8_t *data);
+
+  /**
+   * @brief Add a tuple to its group.
+   */
+  void add(const Tuple &t);
+
+  /**
+   * @brief Check if batches of columns can be added, which requires no groups and terms that the column kernels
+   * compute: COUNT of any field, and SUM, AVG, MIN and MAX of INT and DOUBLE fields.
+   */
+  bool canAddColumns() const;
+
+  /**
+   * @brief Add a batch of tuples given by the values of the fields of the terms.
+   * @details Each term is reduced over the whole batch by a column kernel (see summarizeInt) instead of one tuple at a
+   * time. DOUBLE sums are thus added in another order than by add.
+   * @param values For each term, the values of its field one after the other, as in a ColumnPage column. Not read for
+   * COUNT terms.
+   * @param selected One flag per tuple of the batch, set for the tuples to add.
+   * @param n The number of tuples in the batch.
+   * @throws std::logic_error if canAddColumns does not hold.
+   */
+  void addColumns(const std::vector<const uint8_t *> &values, const uint8_t *selected, size_t n);
+
+  /**
+   * @brief Combine the groups of another aggregator of the same schema and terms into this one.
+   * @details Only the groups whose key hash falls in the given partition are merged, so that the partitions of a set of
+   * partial aggregators can be merged concurrently into separate aggregators.
+   * @param other The aggregator to merge, which is not modified.
+   * @param partition The partition to merge, less than num_partitions.
+   * @param num_partitions The number of partitions the groups are split into.
+   */
+  void merge(const HashAggregator &other, size_t partition = 0, size_t num_partitions = 1);
+
+  /**
+   * @brief Get the number of groups seen so far.
+   */
+  size_t size() const;
+
+  /**
+   * @brief Get one tuple per group, in the order the groups first appeared.
+   * @throws std::overflow_error if a 64-bit count or INT sum does not fit in its INT result field.
+   */
+  std::vector<Tuple> results() const;
+};
+} // namespace db
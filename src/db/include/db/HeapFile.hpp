@@ -1,22 +1,68 @@
 #pragma once
 
 #include <db/DbFile.hpp>
+#include <db/ZoneMap.hpp>
 
 namespace db {
+class BTreeFile;
+
 class HeapFile : public DbFile {
+  /// Secondary indexes as (indexed field, index file) pairs
+  std::vector<std::pair<size_t, BTreeFile *>> indexes;
+
+  /// Per-page ranges of the numeric fields. Pages that existed when the file was opened are filled in on first use.
+  mutable ZoneMap zone_map;
+
 public:
   HeapFile(const std::string &name, const TupleDesc &td);
 
+  /**
+   * @brief The tuple descriptor of a secondary index file.
+   * @details An index entry holds the value of the indexed field ("key") followed by the location of the tuple in the
+   * heap file ("page" and "slot"). Index files are BTreeFiles with this tuple descriptor, key index 0 and key width 3:
+   * the entries of equal keys are ordered by location, so the entry of a tuple is found directly.
+   * @return The tuple descriptor of a secondary index file.
+   */
+  static TupleDesc indexDesc();
+
+  /**
+   * @brief Add a secondary index on a field.
+   * @details The existing tuples are added to the index, and insertTuple/deleteTuple keep it up to date afterwards.
+   * @param field The name of the indexed field. The field must be of type INT.
+   * @param index An empty BTreeFile with the `indexDesc()` schema, key index 0 and key width 3.
+   * @throws std::logic_error if the field is not an INT, already has an index, or the index has the wrong schema.
+   * @note The index file must be added to the Database and outlive the heap file.
+   */
+  void addIndex(const std::string &field, BTreeFile &index);
+
+  /**
+   * @brief Get the secondary index of a field.
+   * @param field The index of the field.
+   * @return The index file, or nullptr if the field is not indexed.
+   */
+  const BTreeFile *getIndex(size_t field) const;
+
+  /**
+   * @brief Get the zone map of the file.
+   * @details The zone map holds the range of every numeric field in every page, so that scans can skip pages that
+   * cannot hold matching tuples. Inserts widen the ranges of the page they write to. Pages whose ranges are unknown
+   * (e.g. pages written before the file was opened) are read once to compute them.
+   * @return The zone map covering every page of the file.
+   */
+  const ZoneMap &getZoneMap() const;
+
   /**
    * @brief Insert a tuple to the database file.
    * @details Insert a tuple to the first available slot of the last page. If the last page is full, create a new page.
+   * An entry for the tuple is added to every secondary index and the zone map of the page is widened.
    * @param t The tuple to be inserted.
    */
   void insertTuple(const Tuple &t) override;
 
   /**
    * @brief Delete a tuple from the database file.
-   * @details Delete a tuple from the database file by marking the slot unused.
+   * @details Delete a tuple from the database file by marking the slot unused. The entries of the tuple are removed
+   * from every secondary index.
    * @param it The iterator that identifies the tuple to be deleted.
    */
   void deleteTuple(const Iterator &it) override;
@@ -29,6 +75,13 @@ public:
    */
   Tuple getTuple(const Iterator &it) const override;
 
+  /**
+   * @brief Get some fields of a tuple, decoding only their bytes.
+   */
+  Tuple getTuple(const Iterator &it, const std::vector<size_t> &fields) const override;
+
+  using DbFile::begin;
+
   /**
    * @brief Advance the iterator to the next tuple.
    * @details Advance the iterator to the next tuple by moving to the next slot of the page.
@@ -37,6 +90,13 @@ public:
    */
   void next(Iterator &it) const override;
 
+  /**
+   * @brief Get the iterator to the first tuple stored in or after a page.
+   * @param page The page to start from.
+   * @return The iterator to the first such tuple, or `end()` if there is none.
+   */
+  Iterator seek(size_t page) const;
+
   /**
    * @brief Get the iterator to the first tuple.
    * @details Get the iterator to the first tuple by finding the first occupied slot.
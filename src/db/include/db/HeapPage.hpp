@@ -40,6 +40,14 @@ public:
    */
   bool insertTuple(const Tuple &t);
 
+  /**
+   * @brief Insert a tuple to the page and report where it was stored.
+   * @param t The tuple to be inserted.
+   * @param slot Set to the slot of the inserted tuple.
+   * @return True if the tuple is inserted successfully, false otherwise if the page is full.
+   */
+  bool insertTuple(const Tuple &t, size_t &slot);
+
   /**
    * @brief Delete a tuple from the page.
    * @details Delete a tuple from the page by marking the slot unused.
@@ -63,6 +71,14 @@ public:
    */
   Tuple getTuple(size_t slot) const;
 
+  /**
+   * @brief Get the serialized tuple at the specified slot.
+   * @details The bytes are in the format of TupleDesc::serialize and are only valid while the page is in the buffer pool.
+   * @param slot The slot of the tuple.
+   * @return A pointer to the first byte of the tuple in the page.
+   */
+  const uint8_t *getData(size_t slot) const;
+
   /**
    * @brief Advance the slot to the next occupied slot.
    * @details Advance the slot to the next occupied slot by scanning the header.
@@ -15,6 +15,9 @@ struct IndexPageHeader {
 struct IndexPage {
   uint16_t capacity;
 
+  /// The number of ints of each key (see BTreeFile::getKeyWidth)
+  size_t key_width;
+
   IndexPageHeader *header;
   int *keys;
   size_t *children;
@@ -22,22 +25,45 @@ struct IndexPage {
   /**
    * @brief Initialize a leaf page
    *
-   * @details The provided page has a header of type IndexPageHeader, followed by `IndexPageHeader::size` keys and
-   * `IndexPageHeader::size + 1` page numbers. The keys are sorted in ascending order.
+   * @details The provided page has a header of type IndexPageHeader, followed by `IndexPageHeader::size` keys of
+   * `key_width` ints and `IndexPageHeader::size + 1` page numbers. The keys are sorted in ascending order.
    * The capacity of the page is calculated based on the remaining size of the page.
    *
    * @param page the page contents
-   * @param key_index the index of the key in the tuple
+   * @param key_width the number of ints of each key
+   */
+  explicit IndexPage(Page &page, size_t key_width = 1);
+
+  /**
+   * @brief Get the key at a position
+   * @param slot the position of the key
+   * @return the key, with its unused fields set to 0
+   */
+  Key getKey(size_t slot) const;
+
+  /**
+   * @brief Find the first position whose key is not less than the provided key
+   * @return the position, or `header->size` if every key is smaller
+   */
+  size_t lowerBound(const Key &key) const;
+
+  /**
+   * @brief Find the first position whose key is greater than the provided key
+   * @return the position, or `header->size` if no key is greater
    */
-  explicit IndexPage(Page &page);
+  size_t upperBound(const Key &key) const;
 
   /**
    * @brief Insert a new key with a corresponding child page number
+   * @details The key is placed at position `slot` and the child becomes its right neighbor. The position is given by
+   * the caller (the slot of the child that was split) because with duplicate keys several positions are sorted, but
+   * only the one right after the split child keeps the children in leaf order.
+   * @param slot the position of the split child in `children`
    * @param key the key to insert
    * @param child the child page number
    * @return true if the page is full and needs to be split
    */
-  bool insert(int key, size_t child);
+  bool insert(size_t slot, const Key &key, size_t child);
 
   /**
    * @brief Split the index page
@@ -45,7 +71,7 @@ struct IndexPage {
    * @param new_page a new empty page
    * @return the split key (this key is moved to the parent page)
    */
-  int split(IndexPage &new_page);
+  Key split(IndexPage &new_page);
 };
 
 } // namespace db
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <db/Tuple.hpp>
+#include <vector>
 
 namespace db {
 class DbFile;
@@ -9,6 +10,8 @@ struct Iterator {
   const DbFile &file;
   size_t page;
   size_t slot;
+  /// The fields produced by dereferencing, or nullptr for every field (see DbFile::begin)
+  const std::vector<size_t> *fields = nullptr;
 
 public:
   Iterator(const DbFile &file, const size_t &page, size_t slot);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <db/Query.hpp>
+#include <cstdint>
+#include <limits>
+
+namespace db {
+
+/**
+ * @brief The instruction sets the column kernels can be run with.
+ * @details
+ *   SCALAR: one value at a time, on any processor.
+ *   AVX2: eight INT or four DOUBLE values at a time, on x86 processors that support AVX2.
+ */
+enum class SimdLevel { SCALAR, AVX2 };
+
+/**
+ * @brief Get the instruction set used by the kernels.
+ * @details It is the best one the processor supports, detected on first use, unless changed by setSimdLevel.
+ */
+SimdLevel getSimdLevel();
+
+/**
+ * @brief Run the kernels with another instruction set, e.g. to compare the results of the scalar kernels.
+ * @throws std::logic_error if the processor does not support the instruction set.
+ */
+void setSimdLevel(SimdLevel level);
+
+/**
+ * @brief The SUM, MIN, MAX and COUNT of the selected values of an INT column.
+ * @details MIN and MAX are the limits of int when no value is selected.
+ */
+struct IntSummary {
+  int64_t sum = 0;
+  int min = std::numeric_limits<int>::max();
+  int max = std::numeric_limits<int>::min();
+  size_t count = 0;
+};
+
+/**
+ * @brief The SUM, MIN, MAX and COUNT of the selected values of a DOUBLE column.
+ * @details MIN and MAX are infinite when no value is selected.
+ */
+struct DoubleSummary {
+  double sum = 0;
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+  size_t count = 0;
+};
+
+/**
+ * @brief Clear the selection of the values of an INT column that do not satisfy "value op operand".
+ * @param values The values, one after the other in the format of TupleDesc::serialize (e.g. ColumnPage::column). They
+ * do not need to be aligned.
+ * @param n The number of values.
+ * @param op The comparison.
+ * @param operand The value to compare with.
+ * @param selected One flag per value, 0 or 1, cleared for the values that do not match.
+ */
+void selectInt(const uint8_t *values, size_t n, PredicateOp op, int operand, uint8_t *selected);
+
+/**
+ * @brief Clear the selection of the values of a DOUBLE column that do not satisfy "value op operand" (see selectInt).
+ * @note Like the comparison operators, NaN values only satisfy NE.
+ */
+void selectDouble(const uint8_t *values, size_t n, PredicateOp op, double operand, uint8_t *selected);
+
+/**
+ * @brief Clear the selection of the values of a column that do not satisfy "value op operand", if a kernel handles it.
+ * @details INT columns compared with an int and DOUBLE columns compared with a double are handled (see selectInt).
+ * @return False if no kernel handles the comparison, in which case the selection is unchanged.
+ */
+bool selectValues(type_t type, const uint8_t *values, size_t n, PredicateOp op, const field_t &operand,
+                  uint8_t *selected);
+
+/**
+ * @brief Count the set flags of a selection.
+ */
+size_t countSelected(const uint8_t *selected, size_t n);
+
+/**
+ * @brief Compute the SUM, MIN, MAX and COUNT of the selected values of an INT column.
+ * @param values The values, as for selectInt.
+ * @param selected One flag per value, 0 or 1, or nullptr to select every value.
+ * @param n The number of values.
+ */
+IntSummary summarizeInt(const uint8_t *values, const uint8_t *selected, size_t n);
+
+/**
+ * @brief Compute the SUM, MIN, MAX and COUNT of the selected values of a DOUBLE column (see summarizeInt).
+ * @details The values are summed in four interleaved partial sums, value i into sum i % 4, whatever the instruction
+ * set, so the result does not depend on the processor but may differ from a sequential sum in the last bits.
+ */
+DoubleSummary summarizeDouble(const uint8_t *values, const uint8_t *selected, size_t n);
+} // namespace db
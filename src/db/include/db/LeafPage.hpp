@@ -12,12 +12,23 @@ struct LeafPageHeader {
   uint16_t size;
 };
 
+/**
+ * @brief Get the key of a tuple in a BTreeFile.
+ * @param t the tuple
+ * @param key_index the index of the first field of the key
+ * @param key_width the number of fields of the key
+ */
+Key keyOf(const Tuple &t, size_t key_index, size_t key_width);
+
 struct LeafPage {
   const TupleDesc &td;
 
   /// The index of the key in a tuple (the key field should be of type int)
   const size_t key_index;
 
+  /// The number of INT fields of the key, from key_index on (see BTreeFile::getKeyWidth)
+  const size_t key_width;
+
   uint16_t capacity;
 
   LeafPageHeader *header;
@@ -32,23 +43,59 @@ struct LeafPage {
    * @param page the page contents
    * @param td the tuple descriptor
    * @param key_index the index of the key in the tuple
+   * @param key_width the number of fields of the key
    */
-  LeafPage(Page &page, const TupleDesc &td, size_t key_index);
+  LeafPage(Page &page, const TupleDesc &td, size_t key_index, size_t key_width = 1);
 
   /**
    * @brief Insert a tuple into the page
-   * @details The tuple is inserted in sorted order based on the key. If the key already exists, the previous tuple is replaced.
+   * @details The tuple is inserted in sorted order based on the key. Duplicate keys are allowed: the tuple is placed
+   * after every tuple with an equal key, so equal keys keep their insertion order.
    * @return true if the leaf is full and needs to be split.
    */
   bool insertTuple(const Tuple &t);
 
+  /**
+   * @brief Delete a tuple from the page
+   * @details The following tuples are shifted to keep the page sorted and dense. The page is never merged with its
+   * siblings, so it may become empty.
+   * @param slot the slot of the tuple to delete
+   */
+  void deleteTuple(size_t slot);
+
   /**
    * @brief Split the leaf page
    * @details The page is split into two pages. The old page contains the first half of the tuples, and the new page contains the second half.
    * @param new_page a new empty page
    * @return the split key (the first key of the new page)
    */
-  int split(LeafPage &new_page);
+  Key split(LeafPage &new_page);
+
+  /**
+   * @brief Get the key of the tuple at the specified slot without deserializing the tuple
+   * @param slot the slot of the tuple
+   * @return the first field of the key of the tuple
+   */
+  int getKey(size_t slot) const;
+
+  /**
+   * @brief Get every field of the key of the tuple at the specified slot
+   */
+  Key getFullKey(size_t slot) const;
+
+  /**
+   * @brief Find the first slot whose key is not less than the provided key
+   * @param key the key to search for
+   * @return the slot of the first such tuple, or `header->size` if every key is smaller
+   */
+  size_t lowerBound(const Key &key) const;
+
+  /**
+   * @brief Find the first slot whose key is greater than the provided key
+   * @param key the key to search for
+   * @return the slot of the first such tuple, or `header->size` if no key is greater
+   */
+  size_t upperBound(const Key &key) const;
 
   /**
    * @brief Get a tuple from the database file.
@@ -57,6 +104,11 @@ struct LeafPage {
    * @return The tuple read from the page.
    */
   Tuple getTuple(size_t slot) const;
+
+  /**
+   * @brief Get some fields of the tuple at a slot (see TupleDesc::deserialize).
+   */
+  Tuple getTuple(size_t slot, const std::vector<size_t> &fields) const;
 };
 
 } // namespace db
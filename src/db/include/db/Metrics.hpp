@@ -0,0 +1,181 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief The number of buckets of a LatencyHistogram.
+ */
+constexpr size_t HISTOGRAM_BUCKETS = 64;
+
+/**
+ * @brief A histogram of durations in nanoseconds, with buckets of exponentially growing width.
+ * @details Bucket 0 counts the durations of 0ns and bucket b > 0 the durations in [2^(b-1), 2^b), the last bucket
+ * also counts everything longer. Recording is one relaxed atomic increment, so any thread may record at any time, and
+ * the memory used is fixed however many durations are recorded.
+ */
+class LatencyHistogram {
+  std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> buckets{};
+  std::atomic<uint64_t> total_ns{0};
+
+public:
+  /**
+   * @brief The contents of a histogram at one point in time.
+   */
+  struct Snapshot {
+    std::array<uint64_t, HISTOGRAM_BUCKETS> buckets{};
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+
+    /**
+     * @brief Get the mean duration in nanoseconds, or 0 if nothing was recorded.
+     */
+    double mean() const;
+
+    /**
+     * @brief Get an upper bound of a percentile of the durations.
+     * @param p The percentile, between 0 and 100.
+     * @return The upper bound in nanoseconds of the bucket holding the percentile, or 0 if nothing was recorded.
+     */
+    uint64_t percentile(double p) const;
+  };
+
+  /**
+   * @brief Record a duration.
+   * @param ns The duration in nanoseconds.
+   */
+  void record(uint64_t ns);
+
+  /**
+   * @brief Copy the contents of the histogram.
+   * @note Durations recorded during the copy may be missing from some of its fields.
+   */
+  Snapshot snapshot() const;
+};
+
+/**
+ * @brief The page I/O of one file (see DbFile::getIoMetrics).
+ * @details Every read and write is also recorded in the metrics of all the files, if any, so that those are the sum of
+ * the metrics of the files (see Metrics::files).
+ */
+struct FileMetrics {
+  std::atomic<size_t> reads{0}, writes{0};
+  LatencyHistogram read_latency, write_latency;
+  FileMetrics *const total;
+
+  /**
+   * @param total The metrics of all the files, or nullptr for those metrics themselves.
+   */
+  explicit FileMetrics(FileMetrics *total = nullptr);
+
+  /**
+   * @brief Count a page read.
+   * @param ns The duration of the read in nanoseconds.
+   */
+  void recordRead(uint64_t ns);
+
+  /**
+   * @brief Count a page written.
+   * @param ns The duration of the write in nanoseconds.
+   */
+  void recordWrite(uint64_t ns);
+
+  struct Snapshot {
+    size_t reads = 0, writes = 0;
+    LatencyHistogram::Snapshot read_latency, write_latency;
+  };
+
+  Snapshot snapshot() const;
+};
+
+/**
+ * @brief The activity of one buffer pool (see BufferPool::getPoolMetrics).
+ */
+struct PoolMetrics {
+  /// Calls to getPage that found the page in the pool, and that had to read it from its file
+  std::atomic<size_t> hits{0}, misses{0};
+  /// Pages removed from the pool to make room for another one
+  std::atomic<size_t> evictions{0};
+  /// Dirty pages written back to their file
+  std::atomic<size_t> flushes{0};
+  /// The time taken by a miss, including the eviction and the read, and by a flush
+  LatencyHistogram miss_latency, flush_latency;
+
+  struct Snapshot {
+    size_t hits = 0, misses = 0, evictions = 0, flushes = 0;
+    LatencyHistogram::Snapshot miss_latency, flush_latency;
+  };
+
+  Snapshot snapshot() const;
+};
+
+/**
+ * @brief Process-wide counters of the page activity of the storage layer.
+ * @details The counters only grow and are updated atomically, so threads that scan in parallel can share them. A
+ * profiler reads them before and after a step and reports the difference (see ProfileOperator).
+ */
+struct Metrics {
+  /// The pages read from and written to database files and spill files, the sum of their FileMetrics
+  FileMetrics files;
+  /// Calls to BufferPool::getPage that found the page in the pool, and that had to read it from its file
+  std::atomic<size_t> pool_hits{0}, pool_misses{0};
+};
+
+/**
+ * @brief Returns the counters of the process.
+ */
+Metrics &getMetrics();
+
+/**
+ * @brief The number of page ids a PageTrace keeps by default.
+ */
+constexpr size_t DEFAULT_TRACE_CAPACITY = 1024;
+
+/**
+ * @brief The capacity of a PageTrace that keeps every page id.
+ */
+constexpr size_t FULL_TRACE = SIZE_MAX;
+
+/**
+ * @brief Keeps the page ids read or written: the last ones in a ring of fixed capacity, or all of them.
+ * @details A bounded trace takes a slot of the ring with an atomic increment, so threads record concurrently without a
+ * lock and the memory used is fixed. A full trace appends under a lock and grows with every page, so it is meant for
+ * tests that check the pages of a short run.
+ */
+class PageTrace {
+  size_t capacity;
+  /// The page ids of a full trace
+  mutable std::mutex mutex;
+  std::vector<size_t> ids;
+  /// The ring of a bounded trace
+  std::unique_ptr<std::atomic<size_t>[]> slots;
+  std::atomic<size_t> total{0};
+
+public:
+  /**
+   * @param capacity The number of page ids kept, FULL_TRACE to keep all of them, 0 to keep none.
+   */
+  explicit PageTrace(size_t capacity = DEFAULT_TRACE_CAPACITY);
+
+  /**
+   * @brief Clear the trace and change its capacity.
+   * @note Nothing may be recorded concurrently.
+   */
+  void reset(size_t capacity);
+
+  void record(size_t id);
+
+  /**
+   * @brief Get a copy of the page ids recorded, oldest first: the last capacity ones, or all of them.
+   * @details Ids recorded concurrently may or may not be included, and a ring may be overwritten while it is copied.
+   */
+  std::vector<size_t> get() const;
+};
+} // namespace db
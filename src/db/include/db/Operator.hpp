@@ -0,0 +1,289 @@
+#pragma once
+
+#include <db/ExternalSort.hpp>
+#include <db/Predicate.hpp>
+#include <db/Query.hpp>
+#include <memory>
+#include <optional>
+
+namespace db {
+
+/**
+ * @brief A query operator that produces its output one tuple at a time.
+ * @details Operators form a tree: each operator pulls tuples from its children with next(), so a pipeline such as
+ * scan -> filter -> join -> aggregate runs without writing intermediate tables. Only blocking operators (the build
+ * side of a hash join, aggregates and sorts) keep state, and only in memory or in temporary files.
+ * An operator must be opened before next() is called and closed after use. It may be opened again to restart it.
+ */
+class Operator {
+public:
+  virtual ~Operator() = default;
+
+  /**
+   * @brief Get the schema of the tuples produced by the operator.
+   */
+  virtual const TupleDesc &getTupleDesc() const = 0;
+
+  /**
+   * @brief Prepare the operator (and its children) to produce tuples from the start.
+   */
+  virtual void open() = 0;
+
+  /**
+   * @brief Produce the next tuple.
+   * @return The next tuple, or nothing once the operator is exhausted.
+   */
+  virtual std::optional<Tuple> next() = 0;
+
+  /**
+   * @brief Release the state of the operator (and its children).
+   */
+  virtual void close() = 0;
+};
+
+/**
+ * @brief Produces the tuples of a DbFile in iteration order.
+ * @details A scan may produce only some fields of the tuples, in which case the other fields are not decoded.
+ */
+class ScanOperator : public Operator {
+  const DbFile &file;
+  /// The fields produced, if not every field
+  std::optional<std::vector<size_t>> fields;
+  TupleDesc td;
+  std::optional<Iterator> it;
+
+public:
+  explicit ScanOperator(const DbFile &file);
+  ScanOperator(const DbFile &file, const std::vector<std::string> &field_names);
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Produces the tuples of a file whose INT field satisfies a comparison, found through an index (see findIndex).
+ * @details A BTreeFile keyed on the field produces the matching range of its leaves, in key order. A HeapFile with a
+ * secondary index on the field looks up the locations of the matching tuples when opened, and produces them in file
+ * order so that every page is read once. As for ScanOperator, only some fields of the tuples may be produced.
+ */
+class IndexScanOperator : public Operator {
+  const DbFile &file;
+  const BTreeFile *index;
+  FilterPredicate pred;
+  std::optional<std::vector<size_t>> fields;
+  TupleDesc td;
+  std::optional<Iterator> it, last;
+  /// The (page, slot) locations of the matching tuples of a heap file
+  std::vector<std::pair<size_t, size_t>> locations;
+  size_t pos = 0;
+
+public:
+  /**
+   * @param file The file to scan.
+   * @param pred The comparison, with an INT value and any operation but NE.
+   * @throws std::logic_error if the field is not indexed or the comparison cannot use an index.
+   */
+  IndexScanOperator(const DbFile &file, const FilterPredicate &pred);
+  IndexScanOperator(const DbFile &file, const FilterPredicate &pred, const std::vector<std::string> &field_names);
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Produces the tuples of its child that satisfy a predicate (or every predicate of a list).
+ */
+class FilterOperator : public Operator {
+  std::unique_ptr<Operator> child;
+  CompiledPredicate predicate;
+
+public:
+  FilterOperator(std::unique_ptr<Operator> child, const Predicate &pred);
+  FilterOperator(std::unique_ptr<Operator> child, const std::vector<FilterPredicate> &pred);
+  FilterOperator(std::unique_ptr<Operator> child, std::initializer_list<FilterPredicate> pred);
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Produces a subset of the fields of the tuples of its child, in the given order.
+ */
+class ProjectOperator : public Operator {
+  std::unique_ptr<Operator> child;
+  std::vector<size_t> fields;
+  TupleDesc td;
+
+public:
+  ProjectOperator(std::unique_ptr<Operator> child, const std::vector<std::string> &field_names);
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Combines the tuples of two children that satisfy a join predicate.
+ * @details The output has the fields of the left child followed by the fields of the right child, without the right
+ * join field for equality joins (as db::join). The field names of the children must be distinct.
+ * HASH builds an in-memory hash table on the right child when opened and streams the left child through it (equality
+ * joins only). NESTED_LOOP reopens the right child for every left tuple. AUTO uses HASH for equality joins.
+ */
+class JoinOperator : public Operator {
+  class HashTable;
+
+  std::unique_ptr<Operator> left, right;
+  JoinPredicate pred;
+  bool hash;
+  size_t left_idx, right_idx;
+  TupleDesc td;
+
+  std::unique_ptr<HashTable> table;
+  std::optional<Tuple> left_record;
+  /// The hash table records matching left_record that are not produced yet
+  std::vector<const Tuple *> matches;
+  size_t match = 0;
+
+  Tuple combine(const Tuple &left_record, const Tuple &right_record) const;
+
+public:
+  /**
+   * @throws std::logic_error if the algorithm is not AUTO, HASH or NESTED_LOOP, or is HASH for another predicate than EQ.
+   */
+  JoinOperator(std::unique_ptr<Operator> left, std::unique_ptr<Operator> right, const JoinPredicate &pred,
+               JoinAlgorithm algorithm = JoinAlgorithm::AUTO);
+  ~JoinOperator() override;
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Joins the tuples of a child with the tuples of a file found through an index (index nested loop join).
+ * @details For each tuple of the child, the tuples of the file whose join field satisfies the predicate are looked up
+ * in the index on that field (see findIndex), so the file is never scanned. The output has the schema of JoinOperator
+ * with the child on the left.
+ */
+class IndexJoinOperator : public Operator {
+  std::unique_ptr<Operator> outer;
+  const DbFile &inner;
+  const BTreeFile *index;
+  JoinPredicate pred;
+  std::optional<CompiledPredicate> inner_filter;
+  size_t outer_idx, inner_idx;
+  TupleDesc td;
+
+  std::optional<Tuple> outer_record;
+  /// The tuples of the file matching outer_record that are not produced yet
+  std::vector<Tuple> matches;
+  size_t match = 0;
+
+public:
+  /**
+   * @param outer The child, on the left of the predicate.
+   * @param inner The file, on the right of the predicate.
+   * @param pred The join predicate. Both join fields must be INTs.
+   * @param inner_filter Only the tuples of the file that satisfy this predicate are joined.
+   * @throws std::logic_error if the join field of the file is not indexed or the left join field is not an INT.
+   */
+  IndexJoinOperator(std::unique_ptr<Operator> outer, const DbFile &inner, const JoinPredicate &pred,
+                    const std::optional<Predicate> &inner_filter = std::nullopt);
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Computes an aggregate over the tuples of its child (see db::aggregate).
+ * @details The whole input is consumed when the operator is opened, then one tuple per group is produced.
+ * The output fields are the group field (if any) followed by the aggregate, named after the operation and the field,
+ * e.g. "SUM(price)".
+ */
+class AggregateOperator : public Operator {
+  std::unique_ptr<Operator> child;
+  Aggregate agg;
+  TupleDesc td;
+  std::vector<Tuple> results;
+  size_t pos = 0;
+
+public:
+  AggregateOperator(std::unique_ptr<Operator> child, const Aggregate &agg);
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Computes several aggregates over composite group keys (see the multi-aggregate db::aggregate).
+ * @details The whole input is consumed when the operator is opened, then one tuple per group is produced with the
+ * schema of db::aggregateDesc.
+ */
+class HashAggregateOperator : public Operator {
+  std::unique_ptr<Operator> child;
+  std::vector<std::string> group_by;
+  std::vector<AggregateTerm> terms;
+  TupleDesc td;
+  std::vector<Tuple> results;
+  size_t pos = 0;
+
+public:
+  HashAggregateOperator(std::unique_ptr<Operator> child, const std::vector<std::string> &group_by,
+                        const std::vector<AggregateTerm> &terms);
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Produces the tuples of its child sorted by a list of keys (see db::sort).
+ * @details The whole input is consumed into an external sort when the operator is opened.
+ */
+class SortOperator : public Operator {
+  std::unique_ptr<Operator> child;
+  std::vector<std::pair<size_t, bool>> order;
+  size_t memory_pages;
+  std::unique_ptr<ExternalSort> sorter;
+
+public:
+  SortOperator(std::unique_ptr<Operator> child, const std::vector<SortKey> &keys,
+               size_t memory_pages = DEFAULT_MEMORY_PAGES);
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Produces the first k tuples of its child in the order of a list of keys (see db::topk).
+ * @details The whole input is consumed into a heap of at most k tuples when the operator is opened.
+ */
+class TopKOperator : public Operator {
+  std::unique_ptr<Operator> child;
+  std::vector<std::pair<size_t, bool>> order;
+  size_t k;
+  std::vector<Tuple> results;
+  size_t pos = 0;
+
+public:
+  TopKOperator(std::unique_ptr<Operator> child, const std::vector<SortKey> &keys, size_t k);
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Run an operator tree and insert every tuple it produces into a file.
+ * @param op The root of the operator tree.
+ * @param out The output table.
+ */
+void materialize(Operator &op, DbFile &out);
+
+} // namespace db
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <db/BTreeFile.hpp>
+#include <db/Database.hpp>
+#include <db/HeapFile.hpp>
+#include <db/HeapPage.hpp>
+#include <db/LeafPage.hpp>
+#include <db/Scheduler.hpp>
+#include <db/Snapshot.hpp>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief Choose the number of threads of a parallel scan.
+ * @param pages The number of pages to scan.
+ * @param num_threads The requested number of threads, 0 for one per core.
+ * @return The number of threads, such that each thread reads at least PARALLEL_MIN_PAGES pages (at least 1).
+ */
+inline size_t parallelism(size_t pages, size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  return std::clamp<size_t>(pages / PARALLEL_MIN_PAGES, 1, num_threads);
+}
+
+/**
+ * @brief Visit the serialized records of a HeapFile with several threads.
+ * @details The buffer pool is not shared between threads, so the dirty pages of the file are flushed first and every
+ * worker reads its pages from the file into its own buffer. The pages are cut into morsels of MORSEL_PAGES pages that
+ * the workers of the scheduler take and steal from each other (see Scheduler), so workers that read faster get more.
+ * @param heap The file to scan.
+ * @param num_threads The number of threads.
+ * @param visit Called as visit(thread, data) with the number of the thread and a serialized record. Calls from the same
+ * thread are sequential; the data is only valid during the call.
+ * @return The number of records visited.
+ */
+template <typename Visit> size_t parallelScan(const HeapFile &heap, size_t num_threads, Visit visit) {
+  getDatabase().getBufferPool().flushFile(heap.getName());
+  const TupleDesc &td = heap.getTupleDesc();
+  std::atomic<size_t> records{0};
+  getScheduler().run(heap.getNumPages(), MORSEL_PAGES, num_threads, [&](size_t thread, Morsel morsel) {
+    Page page;
+    size_t visited = 0;
+    for (size_t id = morsel.first; id < morsel.last; id++) {
+      heap.readPage(page, id);
+      const HeapPage hp(page, td);
+      for (size_t slot = hp.begin(); slot != hp.end(); hp.next(slot)) {
+        visit(thread, hp.getData(slot));
+        visited++;
+      }
+    }
+    records.fetch_add(visited, std::memory_order_relaxed);
+  });
+  return records;
+}
+
+/**
+ * @brief Visit the serialized records of a BTreeFile with several threads, in no particular order.
+ * @details The leaves are found from the index pages (see BTreeFile::leafPages) and cut into morsels like the pages of
+ * a HeapFile.
+ */
+template <typename Visit> size_t parallelScan(const BTreeFile &btree, size_t num_threads, Visit visit) {
+  std::vector<size_t> leaves = btree.leafPages();
+  getDatabase().getBufferPool().flushFile(btree.getName());
+  const TupleDesc &td = btree.getTupleDesc();
+  std::atomic<size_t> records{0};
+  getScheduler().run(leaves.size(), MORSEL_PAGES, num_threads, [&](size_t thread, Morsel morsel) {
+    Page page;
+    size_t visited = 0;
+    for (size_t i = morsel.first; i < morsel.last; i++) {
+      btree.readPage(page, leaves[i]);
+      const LeafPage leaf(page, td, btree.getKeyIndex());
+      for (size_t slot = 0; slot < leaf.header->size; slot++) {
+        visit(thread, leaf.data + slot * td.length());
+      }
+      visited += leaf.header->size;
+    }
+    records.fetch_add(visited, std::memory_order_relaxed);
+  });
+  return records;
+}
+
+/**
+ * @brief Visit the serialized records of a snapshot of a HeapFile or a BTreeFile with several threads.
+ * @details The pages are read as of the snapshot (see SnapshotFile::readVersion), so nothing is flushed and writers may
+ * change the file meanwhile. They are cut into morsels like the pages of a HeapFile.
+ */
+template <typename Visit> size_t parallelScan(const SnapshotFile &snapshot, size_t num_threads, Visit visit) {
+  std::vector<size_t> pages = snapshot.dataPages();
+  const TupleDesc &td = snapshot.getTupleDesc();
+  const auto &key_index = snapshot.getKeyIndex();
+  std::atomic<size_t> records{0};
+  getScheduler().run(pages.size(), MORSEL_PAGES, num_threads, [&](size_t thread, Morsel morsel) {
+    Page page;
+    size_t visited = 0;
+    for (size_t i = morsel.first; i < morsel.last; i++) {
+      snapshot.readVersion(page, pages[i]);
+      if (key_index) {
+        const LeafPage leaf(page, td, *key_index);
+        for (size_t slot = 0; slot < leaf.header->size; slot++) {
+          visit(thread, leaf.data + slot * td.length());
+        }
+        visited += leaf.header->size;
+      } else {
+        const HeapPage hp(page, td);
+        for (size_t slot = hp.begin(); slot != hp.end(); hp.next(slot)) {
+          visit(thread, hp.getData(slot));
+          visited++;
+        }
+      }
+    }
+    records.fetch_add(visited, std::memory_order_relaxed);
+  });
+  return records;
+}
+
+/**
+ * @brief Check if parallelScan can read a file: a HeapFile, a BTreeFile, or a snapshot of one.
+ */
+inline bool parallelScannable(const DbFile &file) {
+  return dynamic_cast<const HeapFile *>(&file) != nullptr || dynamic_cast<const BTreeFile *>(&file) != nullptr ||
+         dynamic_cast<const SnapshotFile *>(&file) != nullptr;
+}
+
+/**
+ * @brief Visit the serialized records of a HeapFile, a BTreeFile or a SnapshotFile with several threads (see
+ * parallelScannable).
+ * @throws std::logic_error if the file cannot be scanned in parallel.
+ */
+template <typename Visit> size_t parallelScan(const DbFile &file, size_t num_threads, Visit visit) {
+  if (const auto *heap = dynamic_cast<const HeapFile *>(&file)) {
+    return parallelScan(*heap, num_threads, visit);
+  }
+  if (const auto *btree = dynamic_cast<const BTreeFile *>(&file)) {
+    return parallelScan(*btree, num_threads, visit);
+  }
+  if (const auto *snapshot = dynamic_cast<const SnapshotFile *>(&file)) {
+    return parallelScan(*snapshot, num_threads, visit);
+  }
+  throw std::logic_error("File cannot be scanned in parallel");
+}
+} // namespace db
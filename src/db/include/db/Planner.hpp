@@ -0,0 +1,101 @@
+#pragma once
+
+#include <db/Operator.hpp>
+#include <db/Predicate.hpp>
+#include <db/Profile.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief A declarative description of a query over files of the Database.
+ * @details The field names of the tables must be distinct, so that a field name designates one table.
+ *   The tables are the names of the files to read.
+ *   The filters are predicates that each refer to the fields of one table.
+ *   The joins are predicates between a field of one table and a field of another table. They must connect every table
+ *   without forming a cycle (one predicate less than there are tables).
+ *   If there are group_by fields or aggregates, the joined tuples are aggregated (see the multi-aggregate db::aggregate).
+ *   Otherwise the output has the given fields, or every field of the joined tuples if there are none.
+ */
+struct QuerySpec {
+  std::vector<std::string> tables;
+  std::vector<Predicate> filters;
+  std::vector<JoinPredicate> joins;
+  std::vector<std::string> group_by;
+  std::vector<AggregateTerm> aggregates;
+  std::vector<std::string> fields;
+};
+
+/**
+ * @brief A step of a query plan with its estimates.
+ */
+struct PlanNode {
+  /// The operation, e.g. "HashJoin(a = b)"
+  std::string description;
+  /// The estimated number of tuples produced
+  double rows = 0;
+  /// The estimated number of pages read by the step and its inputs
+  double cost = 0;
+  std::vector<PlanNode> children;
+  /// What the step did when the plan ran, if it was planned with profiling
+  std::shared_ptr<const ProfileNode> profile;
+
+  /**
+   * @brief Describe the plan with one step per line, followed by its inputs indented by two more spaces.
+   * @details The steps that were profiled are followed by what they did (see ProfileNode::describe).
+   */
+  std::string toString() const;
+
+  /**
+   * @brief Serialize the plan to a JSON object.
+   * @details The object has the fields "step", "rows", "cost", "inputs" (an array of the same objects) and, if the
+   * step was profiled, "actual" (see ProfileNode::toJson).
+   */
+  std::string toJson() const;
+};
+
+/**
+ * @brief A query plan ready to run.
+ */
+struct QueryPlan {
+  /// The operator tree that computes the query
+  std::unique_ptr<Operator> root;
+  /// The steps of the operator tree, in the same shape
+  PlanNode explain;
+};
+
+/**
+ * @brief The maximum number of tables of a query given to db::plan.
+ */
+constexpr size_t MAX_PLANNED_TABLES = 10;
+
+/**
+ * @brief Choose the cheapest way to compute a query, estimated in pages read.
+ * @details The estimates come from the statistics of the tables (see Database::analyze). A table that was never analyzed
+ * is assumed to have full pages, and its predicates to select 1/10 of the rows for equalities and 1/3 for ranges.
+ * The tuples produced by each join are also counted as the pages they would fill, so that the orders with the smallest
+ * intermediate results are preferred.
+ *   Each table is read by a full scan, or by an index scan (see IndexScanOperator) for one comparison of its filters when
+ *   the index reads fewer pages. The filters are then applied to the tuples read.
+ *   Join orders are enumerated bottom up: the best plan of every connected subset of tables is the cheapest join of the
+ *   best plans of two connected subsets that partition it, so every tree of joins is considered, not only left-deep
+ *   ones, and tables are never combined without a join predicate. Each join is one of:
+ *     HashJoin (equality only): both inputs are read once. The right input must fit in memory_pages.
+ *     NestedLoopJoin: the right input is computed again for every tuple of the left input, unless it is a full scan of a
+ *       table that fits in the buffer pool.
+ *     IndexJoin: the right input is a table with an index on its join field (see IndexJoinOperator), looked up once
+ *       per tuple of the left input. Its filters are checked on the tuples found.
+ * @param query The query.
+ * @param memory_pages The number of pages of tuples a hash join may hold in memory.
+ * @param profile Whether to measure every step of the plan when it runs (EXPLAIN ANALYZE). Each operator is wrapped in
+ * a ProfileOperator whose profile is the profile of its PlanNode, so the explain tree shows the estimates next to the
+ * actual rows, times and pages once the root has been run.
+ * @return The plan, whose operator tree reads the files of the Database.
+ * @throws std::logic_error if the query is not valid, e.g. its tables are not connected by its joins.
+ * @note An equality join drops its right join field (see JoinOperator). Fields of the query that were dropped are
+ * replaced by the field they were equal to, which is also the name used in the output.
+ */
+QueryPlan plan(const QuerySpec &query, size_t memory_pages = DEFAULT_MEMORY_PAGES, bool profile = false);
+} // namespace db
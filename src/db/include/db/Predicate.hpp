@@ -0,0 +1,146 @@
+#pragma once
+
+#include <db/Query.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief A boolean expression over the fields of a tuple.
+ * @details A predicate is a comparison between a field and a value (as a FilterPredicate), a test whether a field is
+ * one of a list of values (IN), or a combination of predicates with AND, OR and NOT.
+ * An empty AND is always true and an empty OR is always false.
+ */
+class Predicate {
+public:
+  enum class Kind { COMPARE, IN, AND, OR, NOT };
+
+private:
+  Kind kind;
+  std::string field;
+  PredicateOp op = PredicateOp::EQ;
+  /// The value of a comparison, or the list of an IN predicate
+  std::vector<field_t> values;
+  std::vector<Predicate> children;
+
+  Predicate(Kind kind, std::vector<Predicate> children);
+
+public:
+  /**
+   * @brief A comparison "field op value".
+   * @note The conversion is implicit so that a list of FilterPredicates can be combined directly.
+   */
+  Predicate(const FilterPredicate &pred);
+
+  /**
+   * @brief A comparison "field op value".
+   */
+  static Predicate compare(const std::string &field, PredicateOp op, const field_t &value);
+
+  /**
+   * @brief Test whether a field is equal to one of the values.
+   */
+  static Predicate in(const std::string &field, const std::vector<field_t> &values);
+
+  /**
+   * @brief Hold if every predicate holds.
+   */
+  static Predicate all(std::vector<Predicate> preds);
+
+  /**
+   * @brief Hold if any predicate holds.
+   */
+  static Predicate any(std::vector<Predicate> preds);
+
+  /**
+   * @brief Hold if the predicate does not hold.
+   */
+  static Predicate negate(Predicate pred);
+
+  Kind getKind() const;
+
+  const std::string &getField() const;
+
+  PredicateOp getOp() const;
+
+  const std::vector<field_t> &getValues() const;
+
+  const std::vector<Predicate> &getChildren() const;
+
+  /**
+   * @brief Get the comparisons that every matching tuple satisfies.
+   * @details These are the predicate itself if it is a comparison, or the comparisons directly under a top-level AND.
+   * They can be used to choose an index or skip pages, but the whole predicate must still be checked.
+   */
+  std::vector<FilterPredicate> conjuncts() const;
+
+  /**
+   * @brief Get the names of the fields the predicate refers to, each once, in order of appearance.
+   */
+  std::vector<std::string> fields() const;
+};
+
+/**
+ * @brief Get any value of a type, e.g. 0 for INT.
+ * @details By evaluateCondition, comparing a field with a value of another type only depends on the two types, so the
+ * result for a sample of the field type is the result for every value of the field.
+ */
+field_t sampleOf(type_t type);
+
+/**
+ * @brief A predicate bound to a tuple descriptor and compiled for fast evaluation.
+ * @details Field names are resolved to field offsets once, and the predicate is translated into a small program of
+ * typed instructions (e.g. "the INT at offset 8 is less than 5"). AND and OR jump over the rest of their operands as
+ * soon as the result is known. The program can run directly on the serialized bytes of a tuple, so a scan only has to
+ * deserialize the tuples that match.
+ * Comparisons between a field and a value of another type have the result of evaluateCondition, and are folded into
+ * constants at compile time.
+ */
+class CompiledPredicate {
+  enum class Code : uint8_t;
+
+  struct Instruction {
+    Code code;
+    /// The index of the field, used when running on a Tuple
+    uint32_t field;
+    /// The offset of the field, used when running on serialized bytes
+    uint32_t offset;
+    /// The target of a jump, or the position of the values of an IN list
+    uint32_t arg;
+    int int_value;
+    double double_value;
+    std::string string_value;
+  };
+
+  std::vector<Instruction> program;
+  std::vector<std::vector<int>> int_sets;
+  std::vector<std::vector<double>> double_sets;
+  std::vector<std::vector<std::string>> string_sets;
+
+  void compile(const Predicate &pred, const TupleDesc &td);
+
+  Instruction &emit(Code code, uint32_t arg = 0);
+
+  template <typename Fields> bool run(const Fields &fields) const;
+
+public:
+  /**
+   * @brief Compile a predicate for tuples of a schema.
+   * @throws std::out_of_range if a field of the predicate is not in the schema.
+   */
+  CompiledPredicate(const Predicate &pred, const TupleDesc &td);
+
+  /**
+   * @brief Evaluate the predicate on a tuple serialized with the schema.
+   * @param data The serialized tuple (see TupleDesc::serialize).
+   */
+  bool operator()(const uint8_t *data) const;
+
+  /**
+   * @brief Evaluate the predicate on a tuple of the schema.
+   */
+  bool operator()(const Tuple &t) const;
+};
+} // namespace db
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <db/DbFile.hpp>
+#include <db/Operator.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief What a query step did while it ran.
+ */
+struct OperatorMetrics {
+  /// The number of tuples produced
+  size_t rows = 0;
+  /// Elapsed time and CPU time of the calling thread, in milliseconds
+  double wall_ms = 0, cpu_ms = 0;
+  /// Calls to BufferPool::getPage that found the page in the pool, and that had to read it
+  size_t pool_hits = 0, pool_misses = 0;
+  /// Pages read from and written to database files and spill files
+  size_t page_reads = 0, page_writes = 0;
+};
+
+/**
+ * @brief The profile of a query step and of its inputs, in the shape of the operator tree.
+ */
+struct ProfileNode {
+  std::string name;
+  /// Measured around the calls to the operator, so it includes the work done by its inputs
+  OperatorMetrics total;
+  std::vector<std::shared_ptr<const ProfileNode>> inputs;
+
+  /**
+   * @brief Get the number of tuples the step received from its inputs.
+   */
+  size_t rowsIn() const;
+
+  /**
+   * @brief Get the work done by the step itself: the total minus the totals of its inputs.
+   * @details Each metric is at least zero, since the totals of the inputs may be estimated higher than the total.
+   */
+  OperatorMetrics self() const;
+
+  /**
+   * @brief Describe the metrics of the step on one line, e.g. "rows=10 in=100 time=1.20ms (self 0.40ms) ...".
+   */
+  std::string describe() const;
+
+  /**
+   * @brief Describe the step and its inputs, one step per line with its inputs indented by two more spaces.
+   */
+  std::string toString() const;
+
+  /**
+   * @brief Serialize the profile to a JSON object.
+   * @details The object has the fields "operator", "rows_in", "rows_out", "total" and "self" (each with "wall_ms",
+   * "cpu_ms", "pool_hits", "pool_misses", "page_reads" and "page_writes") and "inputs", an array of the same objects.
+   * @param inputs Whether to include the inputs.
+   */
+  std::string toJson(bool inputs = true) const;
+};
+
+/**
+ * @brief Quote a string for JSON, escaping quotes, backslashes and control characters.
+ */
+std::string jsonString(const std::string &s);
+
+/// The average number of calls to ProfileOperator::next between two measured calls
+constexpr size_t PROFILE_SAMPLE_INTERVAL = 64;
+/// One measured call to ProfileOperator::next in this many also reads the CPU time
+constexpr size_t PROFILE_CPU_SAMPLE_INTERVAL = 16;
+
+/**
+ * @brief Measures an operator while it runs (EXPLAIN ANALYZE).
+ * @details The calls to open and close of the operator are timed, and the page counters of the process (see Metrics)
+ * are sampled before and after them. Reading the clocks costs more than a cheap operator does per tuple, so only about
+ * one call to next in PROFILE_SAMPLE_INTERVAL is measured, at random intervals so that they do not line up with the
+ * pages, and the measures are scaled to all the calls. Reading the CPU time slows down the call around it, so only
+ * one measured call in PROFILE_CPU_SAMPLE_INTERVAL reads it, and the CPU time is the elapsed time times the share of it
+ * those calls spent on the CPU. The number of tuples is counted exactly. The profiles of the
+ * inputs are given by the ProfileOperators wrapping them, so the work done by the step itself can be told apart from
+ * the work of its inputs.
+ * @note Work done by other threads (e.g. a parallel scan) is included in the elapsed time and page counts, but not in
+ * the CPU time.
+ */
+class ProfileOperator : public Operator {
+  std::unique_ptr<Operator> child;
+  std::shared_ptr<ProfileNode> profile;
+  /// The work done by open and close
+  OperatorMetrics opened;
+  /// The work done by the measured calls to next that did not read the CPU time, and by those that did
+  OperatorMetrics sampled, timed;
+  size_t calls = 0, sampled_calls = 0, timed_calls = 0;
+  /// The number of calls to next until the next measured one
+  size_t until_sample = 1;
+  uint64_t random = 0x9e3779b97f4a7c15ULL;
+
+  template <typename Call> auto measure(OperatorMetrics &metrics, Call call, bool with_cpu = true);
+
+  /// Set the total of the profile to the work of open and close plus the scaled work of the calls to next.
+  void update();
+
+public:
+  /**
+   * @param child The operator to measure.
+   * @param name The name of the step in the profile.
+   * @param inputs The profiles of the inputs of the operator.
+   */
+  ProfileOperator(std::unique_ptr<Operator> child, const std::string &name,
+                  std::vector<std::shared_ptr<const ProfileNode>> inputs = {});
+
+  /**
+   * @brief Get the profile, which is updated while the operator runs and stays valid after it is destroyed.
+   */
+  std::shared_ptr<const ProfileNode> getProfile() const;
+
+  const TupleDesc &getTupleDesc() const override;
+  void open() override;
+  std::optional<Tuple> next() override;
+  void close() override;
+};
+
+/**
+ * @brief Profiles the query functions (db::projection, db::filter, db::join, db::sort, db::topk and db::aggregate)
+ * called by the current thread while it exists, the way ProfileOperator profiles an operator tree.
+ * @details Each call gives one ProfileNode, e.g. "Filter(orders)", whose rows are the tuples written to the output. Its
+ * inputs are the tables it read, e.g. "Table(orders)", with the number of tuples read from each (pages skipped with an
+ * index or a zone map are not read). Profilers may be nested: only the innermost one records.
+ */
+class QueryProfiler {
+  QueryProfiler *outer;
+  std::vector<std::shared_ptr<const ProfileNode>> profiles;
+
+  friend class QueryStep;
+
+public:
+  QueryProfiler();
+
+  ~QueryProfiler();
+
+  QueryProfiler(const QueryProfiler &) = delete;
+
+  QueryProfiler &operator=(const QueryProfiler &) = delete;
+
+  /**
+   * @brief Get the profiles of the calls so far, in the order they were made.
+   */
+  const std::vector<std::shared_ptr<const ProfileNode>> &getProfiles() const;
+
+  /**
+   * @brief Describe the calls one after the other (see ProfileNode::toString).
+   */
+  std::string toString() const;
+
+  /**
+   * @brief Serialize the calls to a JSON array of ProfileNode::toJson objects.
+   */
+  std::string toJson() const;
+};
+
+/**
+ * @brief Measures a call of a query function for the QueryProfiler of the thread, from its construction to its
+ * destruction. Without a profiler, nothing is measured.
+ * @details The query function counts the tuples it reads from its inputs and writes to its output, from the thread
+ * that created the step.
+ */
+class QueryStep {
+  struct Start;
+
+  QueryProfiler *profiler;
+  std::shared_ptr<ProfileNode> profile;
+  std::vector<size_t> rows_read;
+  std::unique_ptr<Start> start;
+
+public:
+  /**
+   * @param name The name of the call, e.g. "Filter(orders)".
+   * @param inputs The tables the call reads.
+   */
+  QueryStep(const std::string &name, const std::vector<const DbFile *> &inputs);
+
+  ~QueryStep();
+
+  QueryStep(const QueryStep &) = delete;
+
+  QueryStep &operator=(const QueryStep &) = delete;
+
+  /**
+   * @brief Check if the call is measured, e.g. to skip counting tuples that are not otherwise counted.
+   */
+  bool active() const { return profile != nullptr; }
+
+  /**
+   * @brief Count tuples read from an input.
+   * @param input The position of the input in the list given to the constructor.
+   */
+  void read(size_t input, size_t rows = 1) {
+    if (profile) {
+      rows_read[input] += rows;
+    }
+  }
+
+  /**
+   * @brief Count tuples written to the output.
+   */
+  void wrote(size_t rows = 1) {
+    if (profile) {
+      profile->total.rows += rows;
+    }
+  }
+};
+} // namespace db
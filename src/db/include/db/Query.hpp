@@ -1,10 +1,13 @@
 #pragma once
 
 #include <db/DbFile.hpp>
+#include <initializer_list>
 #include <optional>
 #include <vector>
 
 namespace db {
+class BTreeFile;
+class Predicate;
 
 /**
  * @brief The operation of a predicate.
@@ -44,12 +47,49 @@ struct JoinPredicate {
   std::string right;
 };
 
+/**
+ * @brief The algorithm used to perform a join.
+ * @details The supported algorithms are:
+ *   AUTO (chosen from the predicate and the inputs: HASH for EQ, NESTED_LOOP otherwise),
+ *   NESTED_LOOP (compare every pair of rows, any predicate),
+ *   HASH (build a hash table on the smaller input and probe it with the other, EQ only).
+ *     If the smaller input exceeds the memory budget, both inputs are hash partitioned into temporary files and joined
+ *     partition by partition (hybrid hash join: the first partition is kept in memory).
+ *   SORT_MERGE (sort both inputs on the join field and merge them, EQ only). A BTreeFile whose key is the join field is
+ *     already sorted and is read in order instead.
+ *   INDEX (index nested loop: for each record of one input, look up the matching records of the other input, which
+ *     must be a BTreeFile keyed on its INT join field or a HeapFile with a secondary index on it; the right input is
+ *     preferred as the inner one).
+ *   RADIX_HASH (parallel in-memory hash join, EQ only). Both inputs are radix partitioned on the hash of the key into
+ *     partitions whose build side fits in the CPU cache, then the partitions are joined by the workers of the
+ *     scheduler (see Scheduler). Each worker writes its output to a temporary file, and the files are copied to the
+ *     output table at the end.
+ * AUTO uses SORT_MERGE for EQ when both inputs are BTreeFiles keyed on the join fields, and INDEX when one input has an
+ * index on its join field and the lookups read fewer pages: for EQ, when the other input has fewer records than the
+ * indexed one has pages; for a range, when the estimated lookups (see indexLookupCost) read fewer pages than a nested
+ * loop. NE never uses INDEX.
+ * Otherwise it uses RADIX_HASH for EQ when both inputs fit in the memory budget together and are large enough to be
+ * scanned by several threads (see PARALLEL_MIN_PAGES).
+ */
+enum class JoinAlgorithm { AUTO, NESTED_LOOP, HASH, SORT_MERGE, INDEX, RADIX_HASH };
+
+/**
+ * @brief The default number of pages an operator may hold in memory before spilling to temporary files.
+ */
+constexpr size_t DEFAULT_MEMORY_PAGES = 1024;
+
+/**
+ * @brief The minimum number of pages each thread of a parallel scan should read.
+ */
+constexpr size_t PARALLEL_MIN_PAGES = 64;
+
 /**
  * @brief The operation of an aggregate.
  * @details The supported aggregate operations are:
- *   sum, average, minimum, maximum, and count.
+ *   sum, average, minimum, maximum, count, and count of distinct values.
+ * COUNT_DISTINCT is only supported by the multi-aggregate form of db::aggregate.
  */
-enum class AggregateOp { SUM, AVG, MIN, MAX, COUNT };
+enum class AggregateOp { SUM, AVG, MIN, MAX, COUNT, COUNT_DISTINCT };
 
 /**
  * @brief An aggregate operation to group and summarize rows.
@@ -64,6 +104,80 @@ struct Aggregate {
   std::string field;
 };
 
+/**
+ * @brief One of the aggregates computed by a multi-aggregate operation.
+ * @details The op is the operation to perform.
+ *   The field is the field to summarize.
+ */
+struct AggregateTerm {
+  AggregateOp op;
+  std::string field;
+};
+
+/**
+ * @brief Evaluate a comparison between two fields.
+ * @param field The left operand.
+ * @param op The comparison to perform.
+ * @param value The right operand.
+ * @return true if "field op value" holds.
+ */
+bool evaluateCondition(const field_t &field, PredicateOp op, const field_t &value);
+
+/**
+ * @brief Find the tuples of a BTreeFile whose key satisfies a comparison.
+ * @param index The BTreeFile to search.
+ * @param op The comparison "key op value" to satisfy.
+ * @param value The value to compare the keys with.
+ * @return The iterators [first, last) to the tuples that satisfy the comparison.
+ * @throws std::logic_error if op is NE, which does not select a single range.
+ */
+std::pair<Iterator, Iterator> indexRange(const BTreeFile &index, PredicateOp op, int value);
+
+/**
+ * @brief Find an index on a field of a file.
+ * @param file The file.
+ * @param field The index of the field, which must be an INT to be indexed.
+ * @return The file itself if it is a BTreeFile keyed on the field, the secondary index on the field if it is a HeapFile,
+ * or nullptr if the field is not indexed. Entries of a secondary index locate tuples (see HeapFile::indexDesc).
+ */
+const BTreeFile *findIndex(const DbFile &file, size_t field);
+
+/**
+ * @brief The fraction of the rows assumed to satisfy an equality, for a table that was never analyzed.
+ */
+constexpr double DEFAULT_EQ_SELECTIVITY = 0.1;
+
+/**
+ * @brief The fraction of the rows assumed to satisfy a range comparison, for a table that was never analyzed.
+ */
+constexpr double DEFAULT_RANGE_SELECTIVITY = 1.0 / 3;
+
+/**
+ * @brief Estimate the depth of a B+tree from its number of pages.
+ */
+double indexDepth(const BTreeFile &index);
+
+/**
+ * @brief Estimate the pages read by one lookup of an index that finds some tuples of a file.
+ * @details The lookup descends the index, then reads the pages of the matches: a BTreeFile keyed on the field stores
+ * them together, while a secondary index reads the pages of its entries and then one page of the file per match.
+ * @param file The file searched.
+ * @param index The index found by findIndex for the field.
+ * @param matches The number of tuples found.
+ * @return The number of pages read.
+ */
+double indexLookupCost(const DbFile &file, const BTreeFile &index, double matches);
+
+/**
+ * @brief A field to sort rows by.
+ * @details The field is specified by the field name.
+ *   Rows are sorted in ascending order unless descending is set.
+ */
+struct SortKey {
+  std::string field;
+  bool descending = false;
+};
+
 /**
  * @brief Perform a projection operation.
  * @details A projection operation selects a subset of fields from the input table.
@@ -83,9 +197,29 @@ void projection(const DbFile &in, DbFile &out, const std::vector<std::string> &f
  * @param in The input table.
  * @param out The output table.
  * @param pred The predicates to filter rows.
+ * @note If the input is a HeapFile with a secondary index on a predicate field, the index is used to read only the
+ *   records that can match. Equality predicates are preferred over range predicates. NE predicates never use an index.
+ * @note Otherwise the pages of a HeapFile whose zone map shows that a numeric predicate cannot hold are skipped.
  */
 void filter(const DbFile &in, DbFile &out, const std::vector<FilterPredicate> &pred);
 
+/**
+ * @brief Perform a filter operation with a braced list of predicates, e.g. `filter(in, out, {{"id", PredicateOp::EQ, 1}})`.
+ * @note A braced list could otherwise initialize both a list of predicates and a Predicate.
+ */
+void filter(const DbFile &in, DbFile &out, std::initializer_list<FilterPredicate> pred);
+
+/**
+ * @brief Perform a filter operation with an arbitrary predicate (see Predicate).
+ * @details The predicate is compiled once for the schema of the input (see CompiledPredicate). The records of a
+ *   HeapFile are tested on their serialized bytes and only the matching ones are deserialized.
+ * @param in The input table.
+ * @param out The output table.
+ * @param pred The predicate to filter rows.
+ * @note The comparisons under a top-level AND can use a secondary index or the zone map, as for a list of predicates.
+ */
+void filter(const DbFile &in, DbFile &out, const Predicate &pred);
+
 /**
  * @brief Perform a join operation.
  * @details A join operation combines rows from two tables that satisfy the join predicates.
@@ -94,10 +228,48 @@ void filter(const DbFile &in, DbFile &out, const std::vector<FilterPredicate> &p
  * @param right The right table.
  * @param out The output table.
  * @param pred The join predicates.
+ * @param algorithm The join algorithm, chosen automatically by default.
+ * @param memory_pages The number of pages of records the join may hold in memory.
+ * @param num_threads The number of threads of a RADIX_HASH join, 0 for one per core.
  * @note When performing an equality join do not keep the join field of the right table in the output.
  * @note Keep in mind that the bufferpool has a limited size.
+ * @note The order of the output rows depends on the algorithm.
+ * @throws std::logic_error if the algorithm does not support the predicate.
+ */
+void join(const DbFile &left, const DbFile &right, DbFile &out, const JoinPredicate &pred,
+          JoinAlgorithm algorithm = JoinAlgorithm::AUTO, size_t memory_pages = DEFAULT_MEMORY_PAGES,
+          size_t num_threads = 0);
+
+/**
+ * @brief Perform a sort operation.
+ * @details A sort operation orders the rows of the input table by a list of keys, the first key being the most
+ *   significant. The rows are inserted into the out table in sorted order.
+ *   The sort is an external merge sort: inputs larger than the memory budget are sorted in runs stored in temporary
+ *   files, which are then merged.
+ * @param in The input table.
+ * @param out The output table.
+ * @param keys The fields to sort by.
+ * @param memory_pages The number of pages of records the sort may hold in memory.
+ * @note A BTreeFile sorted ascending on its key is copied in order without sorting.
+ */
+void sort(const DbFile &in, DbFile &out, const std::vector<SortKey> &keys, size_t memory_pages = DEFAULT_MEMORY_PAGES);
+
+/**
+ * @brief Perform a top-k operation (ORDER BY keys LIMIT k).
+ * @details The first k rows of the input in the order of the keys are inserted into the out table in sorted order.
+ *   The input is scanned once, keeping the best k rows seen so far in a bounded heap.
+ * @param in The input table.
+ * @param out The output table.
+ * @param keys The fields to sort by.
+ * @param k The number of rows to keep.
+ * @param num_threads The number of threads that scan a HeapFile or BTreeFile input, 0 for one per core. Each thread
+ *   keeps its own heap, and the heaps are merged at the end.
+ * @note If the first key is the key of a BTreeFile, the leaves are read in the order of that key (from the first leaf
+ *   when ascending, from the last one when descending) and the scan stops at the first row whose key is worse than the
+ *   key of all k kept rows, so only about k rows are read.
+ * @note Which of several rows with equal keys are kept is unspecified.
  */
-void join(const DbFile &left, const DbFile &right, DbFile &out, const JoinPredicate &pred);
+void topk(const DbFile &in, DbFile &out, const std::vector<SortKey> &keys, size_t k, size_t num_threads = 0);
 
 /**
  * @brief Perform an aggregate operation.
@@ -109,7 +281,47 @@ void join(const DbFile &left, const DbFile &right, DbFile &out, const JoinPredic
  * @param out The output table.
  * @param agg The aggregate operation.
  * @note The computed value should have the same type as the field being aggregated with the exception of AVG which should return a double.
+ * @note A MIN or MAX without a group over a HeapFile only reads the pages whose zone map range can change the result.
  */
 void aggregate(const DbFile &in, DbFile &out, const Aggregate &agg);
 
+/**
+ * @brief Compute several aggregates over groups of rows in a single pass.
+ * @details Rows are grouped by the values of all the group_by fields (no group field means a single group of all rows,
+ *   which produces one tuple even if the input is empty). Each output tuple has the group fields followed by one field
+ *   per term, in order:
+ *   COUNT and COUNT_DISTINCT are INT,
+ *   SUM is INT for an INT field and DOUBLE for a DOUBLE field,
+ *   AVG is DOUBLE,
+ *   MIN and MAX have the type of the field (CHAR fields are compared as strings).
+ *   See aggregateDesc for the schema of the output table.
+ * @param in The input table.
+ * @param out The output table.
+ * @param group_by The fields to group by.
+ * @param terms The aggregates to compute.
+ * @param num_threads The number of threads that scan a HeapFile or BTreeFile input, 0 for one per core. Each thread
+ *   aggregates the pages it reads into its own table, then the tables are merged by partitions of the groups, one per
+ *   thread. The threads are the workers of the scheduler (see Scheduler), which share the pages in small morsels.
+ *   Small files (fewer than PARALLEL_MIN_PAGES pages per thread) use fewer threads.
+ * @note Integer sums are accumulated in 64 bits and AVG of an INT field divides the exact sum.
+ * @note With one thread, groups are produced in the order they first appear in the input. Otherwise the order of the
+ *   groups is unspecified.
+ * @note The input pages are read from the file by every thread, after the dirty pages of the file are flushed.
+ * @throws std::overflow_error if a sum of an INT field (or a count) does not fit in an INT, rather than truncating it.
+ */
+void aggregate(const DbFile &in, DbFile &out, const std::vector<std::string> &group_by,
+               const std::vector<AggregateTerm> &terms, size_t num_threads = 0);
+
+/**
+ * @brief Get the schema of the output of a multi-aggregate operation.
+ * @details The group fields keep their names, and the terms are named after the operation and the field, e.g.
+ *   "SUM(price)" or "COUNT(DISTINCT id)".
+ * @param in The schema of the input table.
+ * @param group_by The fields to group by.
+ * @param terms The aggregates to compute.
+ * @throws std::logic_error if a term cannot be computed on its field (e.g. SUM of a CHAR field).
+ */
+TupleDesc aggregateDesc(const TupleDesc &in, const std::vector<std::string> &group_by,
+                        const std::vector<AggregateTerm> &terms);
+
 } // namespace db
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief A range [first, last) of the items of a parallel job, e.g. of the pages of a file.
+ */
+struct Morsel {
+  size_t first;
+  size_t last;
+};
+
+/**
+ * @brief The number of pages of the morsels of a parallel scan (see parallelScan).
+ */
+constexpr size_t MORSEL_PAGES = 16;
+
+/**
+ * @brief A fixed pool of worker threads that run parallel jobs morsel by morsel, with work stealing.
+ * @details A job cuts its items into morsels and deals them to the deques of its workers in contiguous blocks, so each
+ * worker starts on adjacent pages, in memory it allocated itself. A worker takes the morsels of its own deque from the
+ * front; once its deque is empty, it steals from the back of the deques of the other workers, i.e. the morsels their
+ * owners would reach last. Every worker thus stays busy until the last morsel is taken, however skewed the work per
+ * item is.
+ * Threads are created when a job first needs them and kept until the end of the process. Jobs run one at a time: a job
+ * submitted while another runs waits for it, and a job submitted from a task runs on the calling worker alone.
+ */
+class Scheduler {
+  class Queue;
+
+  std::vector<std::thread> threads;
+  std::vector<std::unique_ptr<Queue>> queues;
+
+  /// Held by the job that is running, so that jobs run one at a time
+  std::mutex job_mutex;
+  /// Protects the threads and the state of the job below
+  mutable std::mutex mutex;
+  std::condition_variable wake, done;
+  const std::function<void(size_t, Morsel)> *task = nullptr;
+  size_t job_workers = 0;
+  /// Incremented for every job, so that a worker knows when a new one starts
+  size_t generation = 0;
+  /// The number of workers of the job that have not finished
+  size_t active = 0;
+  std::exception_ptr error;
+  bool stopping = false;
+
+  void work(size_t worker);
+
+  //Take a morsel from the deque of a worker, or steal one from another worker of the job.
+  bool take(size_t worker, Morsel &morsel);
+
+public:
+  Scheduler();
+
+  ~Scheduler();
+
+  Scheduler(const Scheduler &) = delete;
+
+  Scheduler &operator=(const Scheduler &) = delete;
+
+  /**
+   * @brief Run a task on every morsel of a range of items with several workers, and wait for all of them.
+   * @param items The number of items, cut into morsels [i, i + morsel_size) (the last one may be shorter).
+   * @param morsel_size The number of items of a morsel.
+   * @param num_workers The number of workers to use.
+   * @param task Called as task(worker, morsel) with the number of the worker, from 0 to num_workers - 1. Calls from the
+   * same worker are sequential.
+   * @throws The first exception thrown by the task, once every worker has stopped. The morsels that were not started
+   * are dropped.
+   */
+  void run(size_t items, size_t morsel_size, size_t num_workers, const std::function<void(size_t, Morsel)> &task);
+
+  /**
+   * @brief Get the number of worker threads created so far.
+   */
+  size_t size() const;
+};
+
+/**
+ * @brief Get the scheduler of the process.
+ */
+Scheduler &getScheduler();
+} // namespace db
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <db/BufferPool.hpp>
+#include <db/DbFile.hpp>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+namespace db {
+
+/**
+ * @brief A consistent view of the pages of the database files at the time it was taken (see Database::snapshot).
+ * @details Taking a snapshot copies nothing. Afterwards, the first time a page changes, the BufferPool keeps its
+ * previous version for the snapshot (a per-page chain of versions), until the snapshot is destroyed. A snapshot thus
+ * sees every change made before it was taken and none made after, while writers keep changing the pages: each
+ * insertTuple or deleteTuple is atomic for the snapshots.
+ * @note Pages added to a file after the snapshot are not visible in it, and neither are the files added to the
+ * Database afterwards.
+ */
+class Snapshot {
+  Timestamp time;
+  std::unordered_map<std::string, size_t> num_pages;
+
+public:
+  /**
+   * @brief Opens a snapshot in the BufferPool of the Database. Use Database::snapshot instead.
+   * @param num_pages The number of pages of every file of the Database, once their dirty pages are written, read
+   * with the latch of the BufferPool held.
+   */
+  explicit Snapshot(std::unordered_map<std::string, size_t> num_pages);
+
+  /**
+   * @brief Closes the snapshot, so that the versions kept for it are dropped.
+   */
+  ~Snapshot();
+
+  Snapshot(const Snapshot &) = delete;
+
+  Snapshot &operator=(const Snapshot &) = delete;
+
+  Timestamp getTime() const;
+
+  /**
+   * @brief Get the number of pages a file had when the snapshot was taken.
+   * @throws std::logic_error if the file was not in the Database then.
+   */
+  size_t getNumPages(const std::string &file) const;
+
+  /**
+   * @brief Read a page of a file as it was when the snapshot was taken (see BufferPool::readVersion).
+   * @details Pages may be read concurrently by several threads, into different buffers, while other threads write.
+   */
+  void readPage(const DbFile &file, Page &page, size_t id) const;
+};
+
+/**
+ * @brief A read-only view of a HeapFile or a BTreeFile as of a snapshot, for long scans that run next to writers.
+ * @details The view is a DbFile with the name and schema of the file, e.g. the input of db::aggregate or db::join, which
+ * see the tuples of the snapshot while other threads insert and delete tuples in the file. Its pages are read through
+ * the snapshot and never loaded into the BufferPool, and parallelScan reads them with several threads.
+ * @note The view is not added to the Database: it is used directly and must not outlive it.
+ */
+class SnapshotFile : public DbFile {
+  std::shared_ptr<const Snapshot> snapshot;
+  /// The key index of a BTreeFile, or nothing for a HeapFile
+  std::optional<size_t> key_index;
+  /// The key width of a BTreeFile, which sets the layout of its index pages
+  size_t key_width = 1;
+
+  /// The last page read by the iterators, so that a scan reads every page once
+  mutable std::mutex cache_mutex;
+  mutable std::optional<size_t> cached_id;
+  mutable Page cached;
+
+  //Run f on a page of the snapshot, with the cache locked.
+  template <typename F> auto withPage(size_t id, F f) const;
+
+  void seekTuple(Iterator &it) const;
+
+public:
+  /**
+   * @brief Open a view of a file as of a snapshot.
+   * @param file A HeapFile or a BTreeFile of the Database.
+   * @param snapshot A snapshot taken when the file was in the Database.
+   * @throws std::logic_error if the file is neither a HeapFile nor a BTreeFile, or was not in the snapshot.
+   */
+  SnapshotFile(const DbFile &file, std::shared_ptr<const Snapshot> snapshot);
+
+  const Snapshot &getSnapshot() const;
+
+  /**
+   * @brief Get the key index of a view of a BTreeFile, or nothing for a view of a HeapFile.
+   */
+  const std::optional<size_t> &getKeyIndex() const;
+
+  /**
+   * @brief Read a page of the file as of the snapshot.
+   */
+  void readVersion(Page &page, size_t id) const;
+
+  /**
+   * @brief Get the pages that hold the tuples, in iteration order: every page of a HeapFile, or the leaves of a
+   * BTreeFile (found from the index pages of the snapshot, see BTreeFile::leafPages).
+   */
+  std::vector<size_t> dataPages() const;
+
+  /**
+   * @throws std::logic_error since the view is read-only.
+   */
+  void insertTuple(const Tuple &t) override;
+
+  /**
+   * @throws std::logic_error since the view is read-only.
+   */
+  void deleteTuple(const Iterator &it) override;
+
+  Tuple getTuple(const Iterator &it) const override;
+
+  Tuple getTuple(const Iterator &it, const std::vector<size_t> &fields) const override;
+
+  using DbFile::begin;
+
+  void next(Iterator &it) const override;
+
+  Iterator begin() const override;
+
+  Iterator end() const override;
+};
+} // namespace db
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <db/Metrics.hpp>
+#include <db/Tuple.hpp>
+
+namespace db {
+
+/**
+ * @brief A temporary file of tuples written by operators that run out of memory.
+ * @details Tuples are appended through a one page buffer and read back sequentially in insertion order. The file is
+ * created in the temporary directory, unlinked right away and closed when the object is destroyed.
+ * @note Spill files do not go through the BufferPool, so spilling never evicts the pages of the database files.
+ */
+class SpillFile {
+  TupleDesc td;
+  int fd;
+  size_t per_page;
+
+  /// The tuples that do not fill a whole page yet
+  Page buffer;
+  size_t buffered = 0;
+
+  /// The number of pages written to the file
+  size_t pages = 0;
+
+  /// The number of tuples in the file, including the buffered ones
+  size_t count = 0;
+
+  mutable FileMetrics metrics{&getMetrics().files};
+
+  void readPage(Page &page, size_t id) const;
+
+  /// Count the tuple just added to the buffer and write the buffer to the file once it is full
+  void flushIfFull();
+
+public:
+  /**
+   * @brief Create an empty spill file.
+   * @param td the tuple descriptor of the tuples in the file
+   * @throws std::runtime_error if the file cannot be created
+   */
+  explicit SpillFile(const TupleDesc &td);
+
+  /**
+   * @brief closes the file descriptor.
+   */
+  ~SpillFile();
+
+  SpillFile(const SpillFile &) = delete;
+
+  SpillFile &operator=(const SpillFile &) = delete;
+
+  /**
+   * @brief Append a tuple to the file.
+   * @details The tuple is serialized to the page buffer, which is written to the file once it is full.
+   * @param t the tuple to append
+   */
+  void append(const Tuple &t);
+
+  /**
+   * @brief Append a serialized tuple to the file.
+   * @param data the tuple serialized with the schema of the file (see TupleDesc::serialize)
+   */
+  void append(const uint8_t *data);
+
+  /**
+   * @brief Get the number of tuples in the file.
+   */
+  size_t size() const;
+
+  /**
+   * @brief Get the number of pages in the file, counting a partially filled buffer as one page.
+   */
+  size_t getNumPages() const;
+
+  const TupleDesc &getTupleDesc() const;
+
+  /**
+   * @brief Get the number of pages read and written and the latencies of these calls.
+   */
+  const FileMetrics &getIoMetrics() const;
+
+  /**
+   * @brief Reads the tuples of a spill file one at a time, in insertion order.
+   * @details A cursor holds one page of the file in memory.
+   * @note The file must not be appended to while a cursor is reading it.
+   */
+  class Cursor {
+    const SpillFile &file;
+    Page page;
+    size_t index = 0;
+
+  public:
+    explicit Cursor(const SpillFile &file);
+
+    /**
+     * @brief Check whether every tuple has been read.
+     */
+    bool done() const;
+
+    /**
+     * @brief Read the next tuple.
+     * @return The next tuple of the file.
+     */
+    Tuple next();
+  };
+
+  /**
+   * @brief Visit every tuple of the file in insertion order.
+   * @param f called with each tuple
+   */
+  template <typename F> void scan(F f) const {
+    const size_t length = td.length();
+    Page page;
+    for (size_t id = 0; id < pages; id++) {
+      readPage(page, id);
+      for (size_t i = 0; i < per_page; i++) {
+        f(td.deserialize(page.data() + i * length));
+      }
+    }
+    for (size_t i = 0; i < buffered; i++) {
+      f(td.deserialize(buffer.data() + i * length));
+    }
+  }
+};
+} // namespace db
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <db/Query.hpp>
+#include <string>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief Estimates the number of distinct values of a stream.
+ * @details A HyperLogLog sketch with 2^12 one-byte registers: each value is hashed, the top bits of the hash select a
+ * register, and the register keeps the longest run of leading zeros seen in the other bits. The standard error of the
+ * estimate is about 1.6%, and small counts are corrected with linear counting.
+ */
+class HyperLogLog {
+  static constexpr size_t BITS = 12;
+  std::array<uint8_t, size_t{1} << BITS> registers{};
+
+public:
+  /**
+   * @brief Add a value.
+   */
+  void add(const field_t &value);
+
+  /**
+   * @brief Add the values of another sketch.
+   */
+  void merge(const HyperLogLog &other);
+
+  /**
+   * @brief Estimate the number of distinct values added.
+   */
+  double estimate() const;
+};
+
+/**
+ * @brief The distribution of the values of one column.
+ */
+struct ColumnStats {
+  /// The number of values
+  size_t count = 0;
+  /// The number of nulls, always 0 since fields cannot be null
+  size_t nulls = 0;
+  /// The smallest and largest values, only meaningful if count > 0
+  field_t min, max;
+  /// The estimated number of distinct values
+  double distinct = 0;
+  /// Equi-depth histogram: the upper bounds of buckets holding about the same number of values, in ascending order.
+  /// The first bucket starts at min and the last bound is max. A value that fills several buckets is repeated.
+  std::vector<field_t> bounds;
+
+  /**
+   * @brief Estimate the fraction of the values that satisfy "value op operand".
+   * @param op The comparison.
+   * @param operand The value to compare with.
+   * @return A fraction between 0 and 1.
+   */
+  double selectivity(PredicateOp op, const field_t &operand) const;
+};
+
+/**
+ * @brief The statistics of a table, collected by db::analyze.
+ */
+struct TableStats {
+  size_t rows = 0;
+  size_t pages = 0;
+  /// The statistics of each field, in the order of the tuple descriptor
+  std::vector<ColumnStats> columns;
+
+  /**
+   * @brief Estimate the fraction of the rows that satisfy a predicate.
+   * @param td The schema of the table.
+   * @param pred The predicate.
+   * @return A fraction between 0 and 1.
+   * @note AND assumes independent operands, OR and NOT are derived from it, and IN adds up the equalities.
+   */
+  double selectivity(const TupleDesc &td, const Predicate &pred) const;
+
+  /**
+   * @brief Write the statistics to a file.
+   * @param path The path of the file.
+   * @param td The schema of the table.
+   * @throws std::runtime_error if the file cannot be written.
+   */
+  void save(const std::string &path, const TupleDesc &td) const;
+
+  /**
+   * @brief Read statistics written by save.
+   * @param path The path of the file.
+   * @param td The schema of the table.
+   * @return false if there is no such file.
+   * @throws std::runtime_error if the file is not valid for the schema.
+   */
+  bool load(const std::string &path, const TupleDesc &td);
+};
+
+/**
+ * @brief The number of buckets of the histograms built by db::analyze by default.
+ */
+constexpr size_t DEFAULT_HISTOGRAM_BUCKETS = 64;
+
+/**
+ * @brief The maximum number of rows sampled by db::analyze to build histograms.
+ */
+constexpr size_t ANALYZE_SAMPLE_SIZE = 30000;
+
+/**
+ * @brief Collect the statistics of a table.
+ * @details The table is scanned once. Row counts, minimums, maximums and distinct counts (see HyperLogLog) use every
+ * value; the histograms are built from a uniform sample of at most ANALYZE_SAMPLE_SIZE rows.
+ * @param in The table.
+ * @param buckets The number of buckets of each histogram.
+ * @return The statistics.
+ * @note Database::analyze also stores the statistics next to the file.
+ */
+TableStats analyze(const DbFile &in, size_t buckets = DEFAULT_HISTOGRAM_BUCKETS);
+} // namespace db
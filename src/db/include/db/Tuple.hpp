@@ -20,6 +20,7 @@ public:
 class TupleDesc {
   std::vector<type_t> types;
   std::vector<size_t> offsets;
+  std::vector<std::string> names;
   std::unordered_map<std::string, size_t> name_to_index;
 
 public:
@@ -51,6 +52,20 @@ public:
    */
   size_t offset_of(const size_t &index) const;
 
+  /**
+   * @brief Get type of the field
+   * @param index the index of the field
+   * @return the type of the field
+   */
+  type_t type_of(const size_t &index) const;
+
+  /**
+   * @brief Get name of the field
+   * @param index the index of the field
+   * @return the name of the field
+   */
+  const std::string &name_of(const size_t &index) const;
+
   /**
    * @brief Get the index of the field
    * @details The index of the field is the position of the field in the Tuple
@@ -85,6 +100,22 @@ public:
    */
   Tuple deserialize(const uint8_t *data) const;
 
+  /**
+   * @brief Deserialize some fields of a Tuple
+   * @details Only the bytes of the requested fields are read, so the other fields (e.g. wide CHAR fields) cost nothing
+   * @param data the buffer to deserialize the Tuple from
+   * @param fields the indexes of the fields to deserialize, in the order of the result
+   * @return a Tuple of the requested fields, with the schema `project(fields)`
+   */
+  Tuple deserialize(const uint8_t *data, const std::vector<size_t> &fields) const;
+
+  /**
+   * @brief Get the TupleDesc of some fields
+   * @param fields the indexes of the fields, in the order of the result
+   * @return the TupleDesc of the fields, with their names and types
+   */
+  TupleDesc project(const std::vector<size_t> &fields) const;
+
   /**
    * @brief Merge two TupleDescs
    * @details The merged TupleDesc has all the fields of the two TupleDescs
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <db/types.hpp>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief A log sequence number: the position of the end of a record in the log.
+ * @details Positions keep increasing when the log is truncated, so a larger LSN is always a later record.
+ */
+using Lsn = uint64_t;
+
+/**
+ * @brief An LSN after every record, e.g. the recovery LSN of a page without records (see BufferPool::getRecoveryLsn).
+ */
+constexpr Lsn NO_LSN = std::numeric_limits<Lsn>::max();
+
+/**
+ * @brief A sequential log of the changes to the pages of the database files, written ahead of the pages.
+ * @details The log starts with a header (a magic number and the LSN of its first byte), followed by records. Every
+ * record has its size and the CRC-32 of its content, so a record torn by a crash ends the log. The records are:
+ *   PAGE: the byte ranges of a page (of any file type: HeapPage, LeafPage, IndexPage, ColumnPage...) that changed since
+ *     its previous record, each with the bytes before and after the change.
+ *   COMMIT: the changes logged before it are durable.
+ * Records are appended to a buffer in memory, and written and synced to the disk by flush. Concurrent flushes are
+ * grouped: one caller writes and syncs everything appended so far, while the callers that arrive in the meantime wait
+ * for the next sync, which covers all of their records at once.
+ * The log must be on disk before the pages it describes (see BufferPool::flushPage). Recovery then redoes the changes
+ * up to the last commit and undoes the ones after it, which may have reached the files when their pages were evicted.
+ * Checkpoints drop the records that recovery no longer needs from the front of the log (see truncate(Lsn)), and the
+ * header then holds the LSN of the checkpoint.
+ */
+class WriteAheadLog {
+  std::string path;
+  int fd;
+
+  mutable std::mutex mutex;
+  std::condition_variable flushed;
+  /// The records appended and not written yet
+  std::vector<uint8_t> buffer;
+  /// The LSN of the first byte of the log, the end of the records appended, and the end of the records synced
+  Lsn base = 0, end = 0, durable = 0;
+  /// The LSN of the last COMMIT record, or base if there is none
+  Lsn committed = 0;
+  /// Whether a caller of flush is writing the buffer, or truncate is replacing the file
+  bool flushing = false;
+
+  std::atomic<uint64_t> records = 0, commits = 0, syncs = 0;
+
+  Lsn append(const std::vector<uint8_t> &record);
+
+  void writeHeader();
+
+public:
+  /**
+   * @brief Open or create a log file, without recovering from it (see recover).
+   * @throws std::runtime_error if the file cannot be opened or is not a log.
+   */
+  explicit WriteAheadLog(const std::string &path);
+
+  ~WriteAheadLog();
+
+  WriteAheadLog(const WriteAheadLog &) = delete;
+
+  WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+  /**
+   * @brief Bring the database files back to their state at the last commit of the log, then empty the log.
+   * @details The records are read up to the first one that is torn or invalid. The PAGE records before the last COMMIT
+   * are applied, then the ones after it are undone from the last to the first. The pages are read from and written to
+   * the files by name, outside of the BufferPool, and the files are synced before the log is emptied. The records of
+   * files that do not exist are skipped: recovery never creates a file.
+   * @return The number of PAGE records redone and undone.
+   * @note The files must not be open in the Database (see Database::openLog).
+   */
+  size_t recover();
+
+  /**
+   * @brief Log the changes of a page, if any.
+   * @param pid The page.
+   * @param before The content of the page at its previous record, or as read from its file.
+   * @param after The content of the page now.
+   * @return The LSN of the record, or nothing if the contents are equal.
+   */
+  std::optional<Lsn> logPage(const PageId &pid, const Page &before, const Page &after);
+
+  /**
+   * @brief Log a commit, which makes every change logged before it durable once the log is flushed past it.
+   * @return The LSN of the record.
+   */
+  Lsn logCommit();
+
+  /**
+   * @brief Write and sync the log up to an LSN, if it is not on disk already.
+   * @details Callers may flush concurrently, and share their syncs (group commit).
+   * @throws std::runtime_error if the log cannot be written.
+   */
+  void flush(Lsn lsn);
+
+  /**
+   * @brief Drop every record, once the pages they describe are on disk.
+   * @details The LSNs continue from the end of the dropped records. Must not run concurrently with the other methods.
+   */
+  void truncate();
+
+  /**
+   * @brief Drop the records before an LSN, once the pages they describe are on disk and none of them is after the last
+   * commit (so that recovery neither redoes nor undoes them).
+   * @details The log is flushed up to the LSN, and the records after it are copied to a new file that replaces the log
+   * atomically: a crash leaves either log. Records may be appended meanwhile, and flushes wait for the new file.
+   * @param lsn The start of a record (e.g. the LSN of the record before it), or the end of the log.
+   * @throws std::runtime_error if the new log cannot be written.
+   */
+  void truncate(Lsn lsn);
+
+  /**
+   * @brief Get the LSN of the first record of the log, i.e. of the last checkpoint.
+   */
+  Lsn getBaseLsn() const;
+
+  /**
+   * @brief Get the LSN of the last commit, or the base of the log if it has none.
+   */
+  Lsn getCommitLsn() const;
+
+  /**
+   * @brief Get the end of the records appended so far.
+   */
+  Lsn getEndLsn() const;
+
+  /**
+   * @brief Get the end of the records on disk.
+   */
+  Lsn getDurableLsn() const;
+
+  /**
+   * @brief Get the number of records, commits and syncs of the log so far, e.g. to see how many commits share a sync.
+   */
+  uint64_t getRecords() const;
+
+  uint64_t getCommits() const;
+
+  uint64_t getSyncs() const;
+};
+} // namespace db
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <db/Tuple.hpp>
+#include <limits>
+#include <vector>
+
+namespace db {
+
+/**
+ * @brief The range of values of a field within a page.
+ * @details A range with `min > max` means that the page holds no tuples.
+ */
+struct ZoneRange {
+  double min = std::numeric_limits<double>::infinity();
+  double max = -std::numeric_limits<double>::infinity();
+
+  bool empty() const { return min > max; }
+};
+
+/**
+ * @brief Per-page minimum and maximum values of the numeric fields of a file.
+ * @details The zone map is a side structure kept in memory next to a file. It is widened as tuples are inserted and
+ * never narrowed, so after deletes the ranges are still valid bounds (possibly loose ones).
+ * A page is unknown until all of its tuples have been observed; unknown pages have no ranges and cannot be skipped.
+ */
+class ZoneMap {
+  /// The numeric (INT and DOUBLE) fields of the tuple descriptor
+  std::vector<size_t> fields;
+
+  /// Position of each field in `fields`, or the number of fields of the tuple descriptor for fields without ranges
+  std::vector<size_t> positions;
+
+  /// Whether all the tuples of a page have been observed
+  std::vector<bool> known;
+
+  /// The ranges of page `p` are stored at `ranges[p * fields.size()]` onwards
+  std::vector<ZoneRange> ranges;
+
+public:
+  explicit ZoneMap(const TupleDesc &td);
+
+  /**
+   * @brief Get the number of pages tracked by the zone map.
+   */
+  size_t size() const;
+
+  /**
+   * @brief Track more pages.
+   * @details New pages are unknown.
+   * @param pages The new number of pages.
+   */
+  void resize(size_t pages);
+
+  /**
+   * @brief Start observing a page from scratch.
+   * @details The page becomes known with empty ranges; every tuple of the page must then be passed to `update`.
+   * @param page The page number.
+   */
+  void reset(size_t page);
+
+  /**
+   * @brief Widen the ranges of a page to include a tuple.
+   * @details Updates of unknown pages are ignored.
+   * @param page The page number.
+   * @param t The tuple stored in the page.
+   */
+  void update(size_t page, const Tuple &t);
+
+  /**
+   * @brief Check whether the ranges of a page are known.
+   * @param page The page number.
+   */
+  bool isKnown(size_t page) const;
+
+  /**
+   * @brief Get the range of a field within a page.
+   * @param page The page number.
+   * @param field The index of the field.
+   * @return The range, or nullptr if the page is unknown or the field is not numeric.
+   */
+  const ZoneRange *range(size_t page, size_t field) const;
+};
+} // namespace db
@@ -25,6 +25,16 @@ public:
 
 constexpr size_t DEFAULT_PAGE_SIZE = 4096;
 
+/**
+ * @brief The most INT fields the key of a BTreeFile is made of (see BTreeFile::getKeyWidth).
+ */
+constexpr size_t MAX_KEY_WIDTH = 3;
+
+/**
+ * @brief The key of a tuple in a BTreeFile: its key fields, compared in order. The unused fields are 0.
+ */
+using Key = std::array<int, MAX_KEY_WIDTH>;
+
 using Page = std::array<uint8_t, DEFAULT_PAGE_SIZE>;
 } // namespace db
 